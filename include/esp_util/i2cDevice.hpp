@@ -4,7 +4,9 @@
 #pragma once
 
 #include "driver/i2c.h"
+#include "esp_timer.h"
 
+#include <atomic>
 #include <cstdint>
 #include <span>
 
@@ -12,45 +14,88 @@ namespace esp
 {
 	using byte = uint8_t;
 
+	// Failed transfers of all I2C devices. They are counted instead of aborting, so a glitch doesn't reset the board.
+	inline std::atomic<std::uint32_t> i2cErrorCount{0};
+
+	inline esp_err_t countI2CError(esp_err_t error)
+	{
+		if(error != ESP_OK)
+		{
+			i2cErrorCount.fetch_add(1, std::memory_order_relaxed);
+		}
+		return error;
+	}
+
+	// Time spent in the transfers of all I2C devices (in us), including the driver. Its rate is the bus occupancy.
+	inline std::atomic<std::uint32_t> i2cBusyTimeUs{0};
+
+	template<typename Transfer>
+	esp_err_t timeI2CTransfer(Transfer transfer)
+	{
+		const int64_t   start = esp_timer_get_time();
+		const esp_err_t error = transfer();
+		i2cBusyTimeUs.fetch_add(static_cast<std::uint32_t>(esp_timer_get_time() - start), std::memory_order_relaxed);
+		return countI2CError(error);
+	}
+
 	template<typename I2CConfig, std::uint8_t deviceAddress>
 	struct i2cDevice
 	{
-		void read(
+		esp_err_t read(
 			byte const         registerAddress,
 			std::size_t const          length,
 			std::uint8_t* data)
 		{
 			std::uint8_t tempRegisterAddress = registerAddress;
-			ESP_ERROR_CHECK(i2c_master_write_read_device(
+			return timeI2CTransfer([&] { return i2c_master_write_read_device(
 				I2CConfig::Number,
 				deviceAddress,
 				&tempRegisterAddress,
 				1,
 				data,
 				length,
-				I2CConfig::TimeoutMS / portTICK_PERIOD_MS));
+				I2CConfig::TimeoutMS / portTICK_PERIOD_MS); });
 		}
 
-		void readOnly(
+		esp_err_t readOnly(
 			std::size_t const          length,
 			std::uint8_t* data)
 		{
-			ESP_ERROR_CHECK(i2c_master_read_from_device(
+			return timeI2CTransfer([&] { return i2c_master_read_from_device(
 				I2CConfig::Number,
 				deviceAddress,
 				data,
 				length,
-				I2CConfig::TimeoutMS / portTICK_PERIOD_MS));
+				I2CConfig::TimeoutMS / portTICK_PERIOD_MS); });
 		}
 
-		void write(std::span<byte const> dataToWrite)
+		esp_err_t write(std::span<byte const> dataToWrite)
 		{
-			ESP_ERROR_CHECK(i2c_master_write_to_device(
+			return timeI2CTransfer([&] { return i2c_master_write_to_device(
 				I2CConfig::Number,
 				deviceAddress,
 				reinterpret_cast<const std::uint8_t*>(dataToWrite.data()),
 				dataToWrite.size(),
-				I2CConfig::TimeoutMS / portTICK_PERIOD_MS));
+				I2CConfig::TimeoutMS / portTICK_PERIOD_MS); });
+		}
+
+		// Writes 'data' to 'registerAddress' in one transfer, without copying it behind the address first. The driver
+		// refills the hardware FIFO from 'data', so the length is only limited by the timeout.
+		esp_err_t writeRegister(byte const registerAddress, std::span<byte const> data)
+		{
+			return timeI2CTransfer([&]
+			{
+				std::uint8_t     link[I2C_LINK_RECOMMENDED_SIZE(2)] = {};
+				i2c_cmd_handle_t command = i2c_cmd_link_create_static(link, sizeof(link));
+				esp_err_t        error   = i2c_master_start(command);
+				if(error == ESP_OK) error = i2c_master_write_byte(command, deviceAddress << 1 | I2C_MASTER_WRITE, true);
+				if(error == ESP_OK) error = i2c_master_write_byte(command, registerAddress, true);
+				if(error == ESP_OK) error = i2c_master_write(command, data.data(), data.size(), true);
+				if(error == ESP_OK) error = i2c_master_stop(command);
+				if(error == ESP_OK) error = i2c_master_cmd_begin(I2CConfig::Number, command, I2CConfig::TimeoutMS / portTICK_PERIOD_MS);
+				i2c_cmd_link_delete_static(command);
+				return error;
+			});
 		}
 	};
 }   // namespace esp
\ No newline at end of file
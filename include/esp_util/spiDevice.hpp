@@ -8,6 +8,7 @@
 #include "spiHost.hpp"
 #include "transactionManager.hpp"
 
+#include <atomic>
 #include <cstdint>
 #include <cstring>
 #include <span>
@@ -17,6 +18,19 @@ namespace esp
 {
 	using byte = uint8_t;
 
+	// Failed transactions of all SPI devices. They are counted instead of asserted, so the transfers aren't compiled out
+	// with NDEBUG and a glitch doesn't reset the board.
+	inline std::atomic<std::uint32_t> spiErrorCount{0};
+
+	inline esp_err_t countSPIError(esp_err_t error)
+	{
+		if(error != ESP_OK)
+		{
+			spiErrorCount.fetch_add(1, std::memory_order_relaxed);
+		}
+		return error;
+	}
+
 	template<typename SPIConfig, std::size_t MaxTransactions>
 	struct spiDevice
 	{
@@ -49,7 +63,7 @@ namespace esp
 			t.user = &callback;
 			t.length = package.size_bytes() * 8;
 			t.tx_buffer = package.data();
-			assert(spi_device_polling_transmit(spiDeviceHandle, &t) == ESP_OK);
+			countSPIError(spi_device_polling_transmit(spiDeviceHandle, &t));
 		}
 
 		void sendBlocking(std::span<byte const> package)
@@ -57,7 +71,7 @@ namespace esp
 			spi_transaction_t t{};
 			t.length = package.size_bytes() * 8;
 			t.tx_buffer = package.data();
-			assert(spi_device_polling_transmit(spiDeviceHandle, &t) == ESP_OK);
+			countSPIError(spi_device_polling_transmit(spiDeviceHandle, &t));
 		}
 
 		template<typename F, std::size_t arraySize>
@@ -68,7 +82,7 @@ namespace esp
 			t.length = package.size_bytes() * 8;
 			t.rx_buffer = returnData.data();
 			t.tx_buffer = package.data();
-			assert(spi_device_polling_transmit(spiDeviceHandle, &t) == ESP_OK);
+			countSPIError(spi_device_polling_transmit(spiDeviceHandle, &t));
 			assert(package.size_bytes() == returnData.size());
 		}
 
@@ -79,7 +93,7 @@ namespace esp
 			t.length = package.size_bytes() * 8;
 			t.tx_buffer = package.data();
 			t.rx_buffer = returnData.data();
-			assert(spi_device_polling_transmit(spiDeviceHandle, &t) == ESP_OK);
+			countSPIError(spi_device_polling_transmit(spiDeviceHandle, &t));
 			assert(package.size_bytes() == returnData.size());
 		}
 
@@ -91,7 +105,7 @@ namespace esp
 			t.length = package.size_bytes() * 8;
 			t.tx_buffer = package.data();
 			//fmt::print("RX:{}\tTX:{}\tFlags: {}\tCMD:{}\n", t.length, t.rxlength, t.flags, t.cmd);
-			assert(spi_device_queue_trans(spiDeviceHandle, &t, portMAX_DELAY) == ESP_OK);
+			countSPIError(spi_device_queue_trans(spiDeviceHandle, &t, portMAX_DELAY));
 		}
 
 		template<typename F>
@@ -106,7 +120,22 @@ namespace esp
 			t.user = reinterpret_cast<void*>(CallbackType{callback});
 			t.length = package.size_bytes() * 8;
 			//fmt::print("RX:{}\tTX:{}\tFlags: {}\tCMD:{}\n", t.length, t.rxlength, t.flags, t.cmd);
-			assert(spi_device_queue_trans(spiDeviceHandle, &t, portMAX_DELAY) == ESP_OK);
+			countSPIError(spi_device_queue_trans(spiDeviceHandle, &t, portMAX_DELAY));
+		}
+
+		/**
+		 * Queues a transaction, which is owned by the caller. It can be built once and queued again for every frame,
+		 * after its result was collected with waitTransaction(). Don't mix it with sendDMA() on the same device.
+		 */
+		esp_err_t queueTransaction(spi_transaction_t& t)
+		{
+			return countSPIError(spi_device_queue_trans(spiDeviceHandle, &t, portMAX_DELAY));
+		}
+
+		esp_err_t waitTransaction()
+		{
+			spi_transaction_t* rtrans;
+			return countSPIError(spi_device_get_trans_result(spiDeviceHandle, &rtrans, portMAX_DELAY));
 		}
 
 		void waitDMA(std::size_t messages)
@@ -114,7 +143,7 @@ namespace esp
 			for(std::size_t i = 0; i < messages; ++i)
 			{
 				spi_transaction_t* rtrans;
-				assert(spi_device_get_trans_result(spiDeviceHandle, &rtrans, portMAX_DELAY) == ESP_OK);
+				if(countSPIError(spi_device_get_trans_result(spiDeviceHandle, &rtrans, portMAX_DELAY)) != ESP_OK) continue;
 				transactions.releaseTransaction(rtrans);
 			}
 		}
@@ -19,20 +19,93 @@
 
 #include "i2c.h"
 #include "spi.h"
+#include "sdkconfig.h"
+#include "../util/defines.h"
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <initializer_list>
+#include <span>
 
 #define INT24_MAX 8'388'607
 #define INT24_MIN -8'388'608
 
+#define USE_SYNTHETIC_SENSORS false // Replaces the ADS1299, MAX30102, BHI160 and MCP3561 by waveform generators (see config::Synthetic).
+#define ADS1299_HIGH_RATES    false // Makes the ADS1299 data rates above 2 kSPS selectable, also synthetic ones. Their ring buffer needs more RAM than the ESP32 has.
+#define ECG_FILTERING         false // Filters the ADS1299 channels before they are sent (see config::ECGFilter).
+#define QRS_DETECTION         false // Detects the heartbeats in an ADS1299 channel and sends the heart rate (see config::HeartRate).
+#define SPO2_ESTIMATION       false // Estimates SpO2 and the pulse rate from the MAX30102 and sends them (see config::Oximetry).
+
 using address_t = unsigned char;
 
 namespace config
 {
 	using ascii_t = char;
 
-	static constexpr float DURATION_OF_MEASUREMENT = 0.2f; // in seconds
-	static constexpr float OVERFLOW_SAFETY_FACTOR = 4.0f;
+	/**
+	 * \brief Sample rates of all sensors which are streamed in BDF records. A session can select any of the selectable
+	 * rates of a sensor (see net::SessionConfig), so all of them determine the record duration and the buffers are sized
+	 * for the highest one.
+	 */
+	struct SampleRates
+	{
+		// Defaults (in SPS)
+		static constexpr size_t ADS1299  = 250;
+		static constexpr size_t BHI160   = 50;
+		static constexpr size_t MAX30102 = 100;
+		// Selectable (in SPS)
+#if ADS1299_HIGH_RATES // Also for synthetic builds: Their buffers are sized like the ones of the real sensors.
+		static constexpr size_t ADS1299_SELECTABLE[]  = {250, 500, 1'000, 2'000, 4'000, 8'000, 16'000}; // All data rates of CONFIG1
+#else
+		static constexpr size_t ADS1299_SELECTABLE[]  = {250, 500, 1'000, 2'000}; // Data rates of CONFIG1 whose ring buffer fits into RAM
+#endif
+		static constexpr size_t BHI160_SELECTABLE[]   = {25, 50, 100, 200}; // Rates of the accelerometer
+		static constexpr size_t MAX30102_SELECTABLE[] = {50, 100, 200, 400}; // SpO2 rates with the 411 us pulse width
+		static constexpr size_t HEART_RATE_SELECTABLE[] = {25}; // Derived from the ADS1299 (QRS_DETECTION)
+		static constexpr size_t OXIMETRY_SELECTABLE[]   = {5};  // Derived from the MAX30102 (SPO2_ESTIMATION)
+	};
+
+	static constexpr uint32_t TARGET_RECORD_DURATION_MS = 200;   // Shortest acceptable duration of a data record
+	static constexpr uint32_t MAX_RECORD_DURATION_MS    = 1'000; // Latency limit
+	static constexpr float    OVERFLOW_SAFETY_FACTOR    = 4.0f;
+
+	/**
+	 * \brief Returns the shortest record duration in [target, limit] ms in which every sample rate yields a whole number
+	 * of samples, or 0 if there is none.
+	 */
+	consteval uint32_t solve_record_duration_ms(std::initializer_list<std::span<const size_t>> sampleRates, uint32_t target, uint32_t limit)
+	{
+		for(uint32_t duration = target; duration <= limit; duration++)
+		{
+			if(std::ranges::all_of(sampleRates, [duration](std::span<const size_t> rates)
+			{
+				return std::ranges::all_of(rates, [duration](size_t rate) { return rate * duration % 1'000 == 0; });
+			}))
+			{
+				return duration;
+			}
+		}
+		return 0;
+	}
+
+	static constexpr uint32_t RECORD_DURATION_MS = solve_record_duration_ms({SampleRates::ADS1299_SELECTABLE, SampleRates::BHI160_SELECTABLE, SampleRates::MAX30102_SELECTABLE, SampleRates::HEART_RATE_SELECTABLE,
+																			 SampleRates::OXIMETRY_SELECTABLE},
+																			TARGET_RECORD_DURATION_MS,
+																			MAX_RECORD_DURATION_MS);
+	static_assert(RECORD_DURATION_MS, "No record duration within the latency limit holds a whole number of samples of every sensor.");
+
+	static constexpr float DURATION_OF_MEASUREMENT = RECORD_DURATION_MS / 1'000.f; // in seconds
+
+	constexpr size_t nodes_in_bdf_record(size_t sampleRate)
+	{
+		return sampleRate * RECORD_DURATION_MS / 1'000; // Exact for selectable rates, see solve_record_duration_ms
+	}
+
+	consteval bool is_selectable(std::span<const size_t> selectable, size_t sampleRate)
+	{
+		return std::ranges::find(selectable, sampleRate) != selectable.end();
+	}
 
 	template<typename T>
 	consteval size_t ceil_to_power_2(T value)
@@ -50,28 +123,192 @@ namespace config
 	{
 		return static_cast<uint32_t>(1'000.f / sampleRate);
 	}
-	
+
+	/**
+	 * \brief Text of a BDF header field, which is built at compile time. Converts to the string create_signal_header expects.
+	 */
+	template<size_t Length>
+	struct header_text
+	{
+		ascii_t text[Length + 1];
+
+		constexpr operator const ascii_t*() const { return text; }
+	};
+
+	using channel_label = header_text<16>; // BDF labels have 16 characters.
+
+	/**
+	 * \brief Labels "<prefix>1" to "<prefix><Count>", e.g. for every channel of a daisy chain.
+	 */
+	template<size_t Count>
+	consteval std::array<channel_label, Count> numbered_labels(const ascii_t* prefix)
+	{
+		static_assert(Count < 100);
+		std::array<channel_label, Count> labels{};
+		for(size_t channel = 0; channel < Count; channel++)
+		{
+			ascii_t* text   = labels[channel].text;
+			size_t   length = 0;
+			for(; prefix[length]; length++) text[length] = prefix[length];
+			if(channel + 1 >= 10) text[length++] = static_cast<ascii_t>('0' + (channel + 1) / 10);
+			text[length] = static_cast<ascii_t>('0' + (channel + 1) % 10);
+		}
+		return labels;
+	}
+
+	template<size_t Count>
+	consteval std::array<const ascii_t*, Count> same_for_all(const ascii_t* text)
+	{
+		std::array<const ascii_t*, Count> texts{};
+		texts.fill(text);
+		return texts;
+	}
+
+	/**
+	 * \brief Fixed-point filters of the ADS1299 channels, enabled by ECG_FILTERING (see dsp::ECGFilter). Each stage is a
+	 * biquad, a frequency of 0 disables it. All stages have to work at every selectable sample rate.
+	 */
+	struct ECGFilter
+	{
+		static constexpr float HIGH_PASS_HZ = 0.5f;  // Baseline wander
+		static constexpr float NOTCH_HZ     = 50.f;  // Mains, 50 or 60
+		static constexpr float NOTCH_Q      = 30.f;  // Center frequency / bandwidth
+		static constexpr float LOW_PASS_HZ  = 100.f;
+		static constexpr float HIGHEST_HZ   = std::max({HIGH_PASS_HZ, NOTCH_HZ, LOW_PASS_HZ});
+		static_assert(HIGHEST_HZ < std::ranges::min(SampleRates::ADS1299_SELECTABLE) * 0.45f, "A stage is too close to the Nyquist frequency.");
+
+		/**
+		 * \brief Prefiltering field of the BDF header in the usual notation, e.g. "HP:0.5Hz LP:100Hz N:50Hz".
+		 */
+		static consteval header_text<80> Describe()
+		{
+			header_text<80> description{};
+			size_t          length = 0;
+			auto append = [&description, &length](const ascii_t* text)
+			{
+				for(; *text; text++) description.text[length++] = *text;
+			};
+			auto appendStage = [&](const ascii_t* prefix, float frequency)
+			{
+				if(frequency <= 0.f) return;
+				if(length) append(" ");
+				append(prefix);
+				const auto tenths  = static_cast<uint32_t>(frequency * 10.f + 0.5f);
+				ascii_t    digits[12]{};
+				size_t     count   = 0;
+				for(uint32_t integer = tenths / 10; count == 0 || integer; integer /= 10) digits[count++] = static_cast<ascii_t>('0' + integer % 10);
+				while(count) description.text[length++] = digits[--count];
+				if(tenths % 10)
+				{
+					description.text[length++] = '.';
+					description.text[length++] = static_cast<ascii_t>('0' + tenths % 10);
+				}
+				append("Hz");
+			};
+			appendStage("HP:", HIGH_PASS_HZ);
+			appendStage("LP:", LOW_PASS_HZ);
+			appendStage("N:", NOTCH_HZ);
+			if(!length) append("None");
+			return description;
+		}
+	};
+
 	struct ADS1299
 	{
 		using Config = BoardSPIConfig;
 
-		static constexpr size_t  SAMPLE_RATE         = 250; // in SPS
+		static constexpr size_t  SAMPLE_RATE         = SampleRates::ADS1299;
+		static constexpr size_t  MAX_SAMPLE_RATE     = std::ranges::max(SampleRates::ADS1299_SELECTABLE);
+		static_assert(is_selectable(SampleRates::ADS1299_SELECTABLE, SAMPLE_RATE));
+		// Daisy chain: The chips share CS, DRDY, SCLK and DIN. Every frame holds the status word and the channels of all of
+		// them. Register writes reach all chips at once, so they share one register image.
+		static constexpr size_t CHIP_COUNT        = 1; // Chips in the chain. Fewer are detected at Init.
+		static constexpr size_t CHANNELS_PER_CHIP = 4; // Variant: ADS1299-4, ADS1299-6 or ADS1299 (8 channels)
+		static_assert(CHANNELS_PER_CHIP == 4 || CHANNELS_PER_CHIP == 6 || CHANNELS_PER_CHIP == 8);
 		// BDF Info
-		static constexpr size_t      CHANNEL_COUNT                      = 4;
-		inline static const ascii_t* LABELS[CHANNEL_COUNT]              = {"ECG Ch1", "ECG Ch2", "ECG Ch3", "ECG Ch4"};
+		static constexpr size_t      CHANNEL_COUNT                      = CHIP_COUNT * CHANNELS_PER_CHIP;
+		static_assert(CHANNEL_COUNT <= 32, "Channel masks have 32 bits.");
+		static constexpr auto        LABELS                             = numbered_labels<CHANNEL_COUNT>("ECG Ch");
 		static constexpr ascii_t     TRANSDUCER_TYPE[]                  = "ADC";
-		inline static const ascii_t* PHYSICAL_DIMENSIONS[CHANNEL_COUNT] = {"uV", "uV", "uV", "uV"};
+		static constexpr auto        PHYSICAL_DIMENSIONS                = same_for_all<CHANNEL_COUNT>("uV");
 		static constexpr int32_t     PHYSICAL_MINIMUM                   = INT24_MIN;
 		static constexpr int32_t     PHYSICAL_MAXIMUM                   = INT24_MAX;
 		static constexpr int32_t     DIGITAL_MINIMUM                    = INT24_MIN;
 		static constexpr int32_t     DIGITAL_MAXIMUM                    = INT24_MAX;
-		static constexpr ascii_t     PRE_FILTERING[]                    = "None";
-		static constexpr size_t      NODES_IN_BDF_RECORD                = SAMPLE_RATE * DURATION_OF_MEASUREMENT;
+		static constexpr auto        PRE_FILTERING                      = ECG_FILTERING ? ECGFilter::Describe() : header_text<80>{"None"};
+		static constexpr size_t      NODES_IN_BDF_RECORD                = nodes_in_bdf_record(SAMPLE_RATE);
+		static constexpr size_t      MAX_NODES_IN_BDF_RECORD            = nodes_in_bdf_record(MAX_SAMPLE_RATE);
 
-		static constexpr size_t     ECG_SAMPLES_IN_RING_BUFFER   = ceil_to_power_2(NODES_IN_BDF_RECORD * OVERFLOW_SAFETY_FACTOR);
+		// Front end of every channel (CHnSET, BIAS_SENSP/N, LOFF_SENSP/N). device::ADS1299 compiles it into one register
+		// image per mode.
+		enum class Gain : uint8_t { X1, X2, X4, X6, X8, X12, X24 };
+		static constexpr uint8_t GAIN_FACTORS[]    = {1, 2, 4, 6, 8, 12, 24}; // Of Gain
+		static constexpr float   REFERENCE_VOLTAGE = 4.5f; // Internal reference buffer. One LSB is 2 VREF / gain / 2^24.
+		enum class Input : uint8_t { Normal, Shorted, BiasMeasurement, Supply, Temperature, TestSignal, BiasDriveP, BiasDriveN };
+		struct channel_settings
+		{
+			Gain  gain;
+			Input input;   // Replaced by the test signal or the shorted input in the corresponding modes
+			bool  srb2;    // Connects the negative input to SRB2.
+			bool  bias;    // Both inputs contribute to the bias drive.
+			bool  leadOff; // Both inputs are checked for a detached electrode (only with the configured inputs).
+		};
+		static constexpr channel_settings CHANNELS[CHANNELS_PER_CHIP] = // Same on every chip of the chain
+		{
+			{.gain = Gain::X1, .input = Input::Normal,  .srb2 = false, .bias = false, .leadOff = true},
+			{.gain = Gain::X1, .input = Input::Shorted, .srb2 = false, .bias = false, .leadOff = false},
+			{.gain = Gain::X1, .input = Input::Shorted, .srb2 = false, .bias = false, .leadOff = false},
+			{.gain = Gain::X1, .input = Input::Shorted, .srb2 = false, .bias = false, .leadOff = false},
+		};
+		static constexpr bool START_WITH_TEST_SIGNAL = true; // Init selects the internal test signal instead of the inputs above.
 
-		static constexpr size_t     CLOCK_SPEED                  = 1 * 100 * 1000;
-		static constexpr size_t     NOISE_SAMPLES_IN_RING_BUFFER = 1;
+		// DC lead-off detection: A current source pulls a detached input beyond the comparator threshold. The comparators
+		// report in the status word of every frame, so detection costs no extra transfer.
+		enum class LeadOffCurrent : uint8_t { nA6, nA24, uA6, uA24 };
+		enum class LeadOffThreshold : uint8_t { P95, P92_5, P90, P87_5, P85, P80, P75, P70 }; // Of the positive side
+		static constexpr LeadOffCurrent   LEAD_OFF_CURRENT   = LeadOffCurrent::nA6;
+		static constexpr LeadOffThreshold LEAD_OFF_THRESHOLD = LeadOffThreshold::P95;
+		static constexpr uint32_t         LEAD_OFF_HOLD_MS   = 500; // A change is annotated, once it lasted this long.
+
+		static constexpr size_t     ECG_SAMPLES_IN_RING_BUFFER   = ceil_to_power_2(MAX_NODES_IN_BDF_RECORD * OVERFLOW_SAFETY_FACTOR);
+
+		// Continuous read (RDATAC): Every chip sends its 24 bit status word followed by its channels.
+		static constexpr size_t STATUS_BYTES     = 3;
+		static constexpr size_t CHIP_FRAME_BYTES = STATUS_BYTES + CHANNELS_PER_CHIP * 3;
+		static constexpr size_t FRAME_BYTES      = CHIP_COUNT * CHIP_FRAME_BYTES;
+		// A frame is one transaction. The bus runs on DMA, which allows transferSize bytes instead of the 64 bytes of the
+		// controller FIFO, so the longest chain (4 x 8 channels, 108 bytes) fits.
+		static_assert(FRAME_BYTES <= Config::transferSize, "A frame has to fit into one transaction of the bus.");
+		// SCLK: At most 4 MHz, so one byte lasts at least the 4 tCLK (2 us) a multi-byte command needs to decode each
+		// byte. So register writes need no gaps between the bytes.
+		static constexpr size_t CLOCK_SPEED = 4'000'000;
+		// Highest data rate of CONFIG1, whose frames take at most half a period on the bus. The other half is left for
+		// the interrupt latency and the processing. E.g. 16 kSPS for one chip, 4 kSPS for 2 x 8 and 2 kSPS for 4 x 8 channels.
+		static constexpr size_t MAX_BUS_SAMPLE_RATE = []
+		{
+			size_t rate = 16'000;
+			while(rate > 250 && FRAME_BYTES * 8 * 1'000'000 / CLOCK_SPEED > 1'000'000 / rate / 2) rate /= 2;
+			return rate;
+		}();
+		// Oversampling: The chips convert DECIMATION times faster than the selected rate and device::ADS1299 decimates
+		// the frames with a polyphase FIR filter (dsp::Decimator). Costs DECIMATION_TAPS_PER_PHASE multiply-accumulates
+		// per channel and frame. The synthetic ADS1299 generates the selected rate directly.
+		static constexpr size_t OVERSAMPLING              = 1; // Power of 2 up to 64. 1 disables the decimation.
+		static constexpr size_t DECIMATION                = USE_SYNTHETIC_SENSORS ? 1 : OVERSAMPLING;
+		static constexpr size_t DECIMATION_TAPS_PER_PHASE = 16;
+		static constexpr bool   BENCHMARK_DECIMATION      = false; // Logs the CPU cycles of every ratio at boot.
+		static_assert(OVERSAMPLING >= 1 && OVERSAMPLING <= 64 && (OVERSAMPLING & (OVERSAMPLING - 1)) == 0);
+		static_assert(MAX_SAMPLE_RATE * DECIMATION <= MAX_BUS_SAMPLE_RATE, "The chain can't be read at the highest selectable sample rate.");
+
+		// Noise capture: Every NOISE_PERIOD_MS the inputs are shorted for NOISE_CAPTURE_FRAMES frames, which go into a
+		// separate ring buffer. The ECG is padded meanwhile. Switching the inputs restarts the conversions, each switch costs
+		// the settling time of the digital filter. So the whole gap stays below one record at the lowest rate.
+		static constexpr size_t   NOISE_CAPTURE_FRAMES         = 32;
+		static constexpr size_t   NOISE_SAMPLES_IN_RING_BUFFER = ceil_to_power_2(NOISE_CAPTURE_FRAMES + 1); // Holds a whole capture
+		static constexpr uint32_t NOISE_PERIOD_MS              = 60'000;
+		static constexpr size_t   SETTLING_FRAMES              = 5; // tSETTLE after START: 4 tDR + 136 tCLK
+		static_assert(NOISE_CAPTURE_FRAMES + 2 * SETTLING_FRAMES <= nodes_in_bdf_record(std::ranges::min(SampleRates::ADS1299_SELECTABLE)),
+		              "A noise capture has to fit into one record.");
 		static constexpr size_t     SPI_MAX_TRANSACTION_LENGTH   = 20;          // Maximum length of one spi transaction in bytes.
 		static constexpr gpio_num_t CS_PIN                       = GPIO_NUM_5;  // Chip select
 		static constexpr gpio_num_t RESET_PIN                    = GPIO_NUM_4;  // System reset
@@ -80,60 +317,153 @@ namespace config
 		static constexpr uint8_t    SPI_MODE                     = 0x01;
 	};
 
+	/**
+	 * \brief Heartbeat detection in one ADS1299 channel, enabled by QRS_DETECTION (see dsp::QRSDetector). Every beat is
+	 * annotated and the instantaneous heart rate is sent as a signal of its own. With the ECG channels disabled by the
+	 * session, only these features are sent.
+	 */
+	struct HeartRate
+	{
+		static constexpr size_t   SAMPLE_RATE     = SampleRates::HEART_RATE_SELECTABLE[0];
+		static constexpr size_t   MAX_SAMPLE_RATE = SAMPLE_RATE;
+		static constexpr size_t   CHANNEL         = 0;     // ADS1299 channel of the detection. Detects in the filtered signal with ECG_FILTERING.
+		static constexpr uint32_t TIMEOUT_MS      = 3'000; // Without a beat for this long, the heart rate drops to 0.
+		static_assert(CHANNEL < ADS1299::CHANNEL_COUNT);
+		static_assert(std::ranges::all_of(SampleRates::ADS1299_SELECTABLE, [](size_t rate) { return rate % 250 == 0 && rate % SAMPLE_RATE == 0; }),
+		              "The detection runs at 250 SPS and every rate has to be a multiple of it.");
+
+		// BDF Info
+		static constexpr size_t      CHANNEL_COUNT         = 1;
+		inline static const ascii_t* LABELS[]              = {"Heart rate"};
+		static constexpr ascii_t     TRANSDUCER_TYPE[]     = "QRS detector";
+		inline static const ascii_t* PHYSICAL_DIMENSIONS[] = {"bpm"};
+		static constexpr uint32_t    HELD_CHANNELS         = 0b1; // An estimate, 0 is none. Not interpolated (see mem::Resampler).
+		static constexpr int32_t     PHYSICAL_MINIMUM      = 0;
+		static constexpr int32_t     PHYSICAL_MAXIMUM      = 300;
+		static constexpr int32_t     DIGITAL_MINIMUM       = 0;
+		static constexpr int32_t     DIGITAL_MAXIMUM       = 30'000; // 0.01 bpm per digit
+		static constexpr ascii_t     PRE_FILTERING[]       = "Pan-Tompkins RR";
+		static constexpr size_t      NODES_IN_BDF_RECORD     = nodes_in_bdf_record(SAMPLE_RATE);
+		static constexpr size_t      MAX_NODES_IN_BDF_RECORD = NODES_IN_BDF_RECORD;
+
+		static constexpr size_t SAMPLES_IN_RING_BUFFER = ceil_to_power_2(MAX_NODES_IN_BDF_RECORD * OVERFLOW_SAFETY_FACTOR);
+	};
+
 	struct TSC2003
 	{
 		using Config = I2C0_Config;
 
-		static constexpr address_t  ADDRESS  = 0x48;
-		static constexpr gpio_num_t NIRQ_PIN = GPIO_NUM_2;
+		static constexpr address_t  ADDRESS        = 0x48;
+		static constexpr gpio_num_t NIRQ_PIN       = GPIO_NUM_2;
+		static constexpr int64_t    POLL_PERIOD_US = 10'000;
 	};
 
 	struct BHI160
 	{
 		using Config = I2C0_Config;
 
-		static constexpr uint16_t SAMPLE_RATE = 50; // in SPS
+		static constexpr uint16_t SAMPLE_RATE     = SampleRates::BHI160;
+		static constexpr size_t   MAX_SAMPLE_RATE = std::ranges::max(SampleRates::BHI160_SELECTABLE);
+		static_assert(is_selectable(SampleRates::BHI160_SELECTABLE, SAMPLE_RATE));
 
 		// BDF Info
 		static constexpr size_t		 CHANNEL_COUNT                      = 4; // X, Y, Z, Status
 		inline static const ascii_t* LABELS[CHANNEL_COUNT]              = {"Acceleration X", "Acceleration Y", "Acceleration Z", "Acceleration Status"};
 		static constexpr ascii_t	 TRANSDUCER_TYPE[]                  = "Accelerometer";
 		inline static const ascii_t* PHYSICAL_DIMENSIONS[CHANNEL_COUNT] = {"m/s^2", "m/s^2", "m/s^2", "Accuracy"};
+		static constexpr uint32_t    HELD_CHANNELS                      = 0b1000; // The status is a state. Not interpolated (see mem::Resampler).
 		static constexpr int32_t	 PHYSICAL_MINIMUM                   = INT24_MIN;
 		static constexpr int32_t	 PHYSICAL_MAXIMUM                   = INT24_MAX;
 		static constexpr int32_t	 DIGITAL_MINIMUM                    = INT24_MIN;
 		static constexpr int32_t	 DIGITAL_MAXIMUM                    = INT24_MAX;
 		static constexpr ascii_t	 PRE_FILTERING[]                    = "None";
-		static constexpr size_t		 NODES_IN_BDF_RECORD                = SAMPLE_RATE * DURATION_OF_MEASUREMENT;
+		static constexpr size_t		 NODES_IN_BDF_RECORD                = nodes_in_bdf_record(SAMPLE_RATE);
+		static constexpr size_t		 MAX_NODES_IN_BDF_RECORD            = nodes_in_bdf_record(MAX_SAMPLE_RATE);
 
 		static constexpr uint16_t   LATENCY                = 40; // in ms
 		static constexpr uint16_t   DYNAMIC_RANGE          = 0;  // (Default = 0)
 		static constexpr uint16_t   SENSITIVITY            = 0;  // (Default = 0)
-		static constexpr size_t     SAMPLES_IN_RING_BUFFER = ceil_to_power_2(NODES_IN_BDF_RECORD * OVERFLOW_SAFETY_FACTOR);
+		static constexpr size_t     SAMPLES_IN_RING_BUFFER = ceil_to_power_2(MAX_NODES_IN_BDF_RECORD * OVERFLOW_SAFETY_FACTOR);
 		static constexpr gpio_num_t INTERRUPT_PIN          = GPIO_NUM_39;
 		static constexpr address_t  ADDRESS                = 0x28;
+		// RAM patch upload: Bursts of whole 32 bit words, each one transfer. A failed CRC resets the chip and starts over.
+		static constexpr size_t     UPLOAD_BURST_BYTES     = 4'096; // 92 ms at 400 kHz
+		static constexpr size_t     UPLOAD_ATTEMPTS        = 3;
+		static_assert(UPLOAD_BURST_BYTES % 4 == 0, "The RAM patch consists of 32 bit words.");
+		static_assert(UPLOAD_BURST_BYTES * 9 * 1'000 / Config::Frequency < Config::TimeoutMS / 2, "A burst has to finish well within the I2C timeout.");
 	};
 
 	struct MAX30102
 	{
 		using Config = I2C0_Config;
 
-		static constexpr size_t    SAMPLE_RATE            = 100; // in SPS
+		static constexpr size_t    SAMPLE_RATE            = SampleRates::MAX30102;
+		static constexpr size_t    MAX_SAMPLE_RATE        = std::ranges::max(SampleRates::MAX30102_SELECTABLE);
+		static_assert(is_selectable(SampleRates::MAX30102_SELECTABLE, SAMPLE_RATE));
 
 		// BDF Info
 		static constexpr size_t  CHANNEL_COUNT             = 2; // Red, Infrared
 		inline static const ascii_t* LABELS[]              = {"Oxi Red", "Oxi InfraRed"};
 		static constexpr ascii_t TRANSDUCER_TYPE[]         = "oxi";
-		inline static const ascii_t* PHYSICAL_DIMENSIONS[] = {"Count", "Count"}; // @TODO: Add real dimensions
-		static constexpr int32_t PHYSICAL_MINIMUM          = INT24_MIN;
-		static constexpr int32_t PHYSICAL_MAXIMUM          = INT24_MAX;
-		static constexpr int32_t DIGITAL_MINIMUM           = INT24_MIN;
-		static constexpr int32_t DIGITAL_MAXIMUM           = INT24_MAX;
+		inline static const ascii_t* PHYSICAL_DIMENSIONS[] = {"nA", "nA"}; // Photodiode current
+		static constexpr int32_t PHYSICAL_MINIMUM          = 0;
+		static constexpr int32_t PHYSICAL_MAXIMUM          = 16'384; // Full scale of the 16 uA ADC range
+		static constexpr int32_t DIGITAL_MINIMUM           = 0;
+		static constexpr int32_t DIGITAL_MAXIMUM           = 262'143; // 18 bits
 		static constexpr ascii_t PRE_FILTERING[]           = "None";
-		static constexpr size_t  NODES_IN_BDF_RECORD       = SAMPLE_RATE * DURATION_OF_MEASUREMENT;
+		static constexpr size_t  NODES_IN_BDF_RECORD       = nodes_in_bdf_record(SAMPLE_RATE);
+		static constexpr size_t  MAX_NODES_IN_BDF_RECORD   = nodes_in_bdf_record(MAX_SAMPLE_RATE);
 
-		static constexpr address_t ADDRESS                = 0x57;
-		static constexpr size_t    SAMPLES_IN_RING_BUFFER = ceil_to_power_2(NODES_IN_BDF_RECORD * OVERFLOW_SAFETY_FACTOR);
+		static constexpr address_t  ADDRESS                = 0x57;
+		static constexpr size_t     SAMPLES_IN_RING_BUFFER = ceil_to_power_2(MAX_NODES_IN_BDF_RECORD * OVERFLOW_SAFETY_FACTOR);
+		// Data ready: The INT pin (active low, open drain) isn't verified against the schematic yet. Until it is, the
+		// FIFO is polled every POLL_PERIOD_US, which reads at most a burst at the highest rate.
+		static constexpr bool       INTERRUPT_PIN_VERIFIED = false;
+		static constexpr gpio_num_t INTERRUPT_PIN          = GPIO_NUM_35; // Only used with INTERRUPT_PIN_VERIFIED
+		// FIFO: The interrupt asserts, once FIFO_BURST_SAMPLES samples are unread (FIFO_A_FULL). All pending samples are
+		// read in one burst then. The rest of the FIFO is the margin for the latency of the read. The FIFO fills at the
+		// sample rate, since device::MAX30102 doesn't average (SMP_AVE).
+		static constexpr size_t     FIFO_DEPTH             = 32;
+		static constexpr size_t     FIFO_BURST_SAMPLES     = 17; // A burst every 170 ms at 100 SPS (42.5 ms at 400 SPS), 150 ms (37.5 ms) margin
+		static constexpr size_t     FIFO_SAMPLE_BYTES      = CHANNEL_COUNT * 3;
+		static_assert(FIFO_BURST_SAMPLES + 15 >= FIFO_DEPTH && FIFO_BURST_SAMPLES <= FIFO_DEPTH, "FIFO_A_FULL holds 0 to 15 free samples.");
+		static constexpr int64_t    POLL_PERIOD_US         = FIFO_BURST_SAMPLES * 1'000'000ll / MAX_SAMPLE_RATE;
+	};
+
+	/**
+	 * \brief SpO2 and pulse rate from the MAX30102, enabled by SPO2_ESTIMATION (see dsp::SpO2Estimator). Both are sent as
+	 * signals of their own, held between the beats. With the MAX30102 channels disabled by the session, only these
+	 * features are sent.
+	 */
+	struct Oximetry
+	{
+		static constexpr size_t   SAMPLE_RATE     = SampleRates::OXIMETRY_SELECTABLE[0];
+		static constexpr size_t   MAX_SAMPLE_RATE = SAMPLE_RATE;
+		static constexpr uint32_t TIMEOUT_MS      = 5'000; // Without a beat for this long (e.g. no finger), both drop to 0.
+		// SpO2 = A R^2 + B R + C in %. The curve of the Maxim reference design: It has to be calibrated for the optics of the board.
+		static constexpr double   CALIBRATION_A   = -45.060;
+		static constexpr double   CALIBRATION_B   = 30.354;
+		static constexpr double   CALIBRATION_C   = 94.845;
+		static_assert(std::ranges::all_of(SampleRates::MAX30102_SELECTABLE, [](size_t rate) { return rate % 50 == 0 && rate % SAMPLE_RATE == 0; }),
+		              "The estimation runs at 50 SPS and every rate has to be a multiple of it.");
+
+		// BDF Info
+		static constexpr size_t      CHANNEL_COUNT         = 2; // SpO2, pulse rate
+		static constexpr size_t      SATURATION            = 0;
+		static constexpr size_t      PULSE_RATE            = 1;
+		inline static const ascii_t* LABELS[]              = {"SpO2", "Pulse rate"};
+		static constexpr ascii_t     TRANSDUCER_TYPE[]     = "Ratio of ratios";
+		inline static const ascii_t* PHYSICAL_DIMENSIONS[] = {"%", "bpm"};
+		static constexpr uint32_t    HELD_CHANNELS         = 0b11; // Estimates, 0 is none. Not interpolated (see mem::Resampler).
+		static constexpr int32_t     PHYSICAL_MINIMUM      = 0;
+		static constexpr int32_t     PHYSICAL_MAXIMUM      = 300;
+		static constexpr int32_t     DIGITAL_MINIMUM       = 0;
+		static constexpr int32_t     DIGITAL_MAXIMUM       = 30'000; // 0.01 % or bpm per digit
+		static constexpr ascii_t     PRE_FILTERING[]       = "HP:0.5Hz LP:5Hz 4 beats";
+		static constexpr size_t      NODES_IN_BDF_RECORD     = nodes_in_bdf_record(SAMPLE_RATE);
+		static constexpr size_t      MAX_NODES_IN_BDF_RECORD = NODES_IN_BDF_RECORD;
+
+		static constexpr size_t SAMPLES_IN_RING_BUFFER = ceil_to_power_2(MAX_NODES_IN_BDF_RECORD * OVERFLOW_SAFETY_FACTOR);
 	};
 
 	struct MCP3561
@@ -155,14 +485,139 @@ namespace config
 	struct PCFB574
 	{
 		using Config = I2C0_Config;
-		static constexpr address_t ADDRESS = 0x20;
+		static constexpr address_t ADDRESS        = 0x20;
+		static constexpr int64_t   POLL_PERIOD_US = 200'000;
+	};
+
+	/**
+	 * \brief Periodic jobs of sources without a data ready line (see sys::Scheduler).
+	 */
+	struct Scheduler
+	{
+		static constexpr size_t   MAX_JOBS                     = 8;
+		static constexpr size_t   JITTER_HISTOGRAM_BUCKETS     = 16; // Up to 2^15 us, the last bucket holds everything later
+		static constexpr bool     RUN_JITTER_BENCHMARK         = false; // Runs sys::run_jitter_benchmark() on boot
+		static constexpr uint32_t JITTER_BENCHMARK_DURATION_MS = 10'000;
+	};
+
+	struct SDCard
+	{
+		using Config = BoardSPIConfig;
+
+		// The chip select isn't verified against the schematic yet. A wrong one selects another device on the bus.
+		static constexpr bool       CS_PIN_VERIFIED = false;
+		static constexpr gpio_num_t CS_PIN          = GPIO_NUM_15;
+		static constexpr size_t     CLOCK_SPEED     = 20 * 1000 * 1000;
+		static constexpr ascii_t    MOUNT_POINT[]   = "/sdcard";
+		static constexpr int        MAX_FILES       = 2;
+	};
+
+	/**
+	 * \brief Records the transmitted BDF stream onto the SD card.
+	 */
+	struct Recorder
+	{
+		static constexpr bool    ENABLED            = false; // Power supply and chip select of the SD card need to be checked first.
+		static constexpr ascii_t FILE_NAME_FORMAT[] = "/sdcard/rec%05u.bdf"; // 8.3 names only (CONFIG_FATFS_LFN_NONE)
+		static constexpr size_t  BLOCK_SIZE         = 16 * 1024;        // Multiple of the FAT sector size (4096 Bytes)
+		static constexpr size_t  PREALLOCATION_STEP = 4 * 1024 * 1024;  // Bytes which are reserved at once
+		static_assert(!ENABLED || SDCard::CS_PIN_VERIFIED, "The chip select of the SD card has to be verified first.");
+	};
+
+	/**
+	 * \brief BDF+ "BDF Annotations" signal, appended to every data record.
+	 */
+	struct Annotations
+	{
+		static constexpr bool    ENABLED             = true;
+		static constexpr size_t  NODES_IN_BDF_RECORD = 40; // 3 Bytes each -> 120 Bytes of TALs per record
+		static constexpr size_t  MAX_PENDING         = 16; // Annotations waiting for a record. Further ones get dropped.
+		static constexpr size_t  MAX_TEXT_LENGTH     = 32; // Including the terminating zero.
+	};
+
+	/**
+	 * \brief Session configuration, which the client appends to the header request (see net::SessionConfig).
+	 */
+	struct Session
+	{
+		static constexpr size_t MAX_CONFIG_LENGTH = 96; // Longer configurations are cut off.
+	};
+
+	/**
+	 * \brief Coalescing of consecutive data records into one send.
+	 */
+	struct Transmission
+	{
+		static constexpr bool     COALESCE_RECORDS  = true;
+		static constexpr uint32_t LATENCY_BUDGET_MS = 600;                             // Maximum age of the oldest record of a batch
+		static constexpr uint32_t FILL_TIMEOUT_MS   = RECORD_DURATION_MS;              // A sensor lagging the end of a record longer is padded.
+		static constexpr size_t   MAX_BATCH_SIZE    = CONFIG_LWIP_TCP_SND_BUF_DEFAULT; // A batch has to fit the socket send buffer.
+	};
+
+	struct Metrics
+	{
+		static constexpr uint32_t LOG_PERIOD_MS = 10'000;
+	};
+
+	/**
+	 * \brief Thresholds of sys::HealthMonitor. All of them are evaluated over the sliding window.
+	 */
+	struct Health
+	{
+		static constexpr uint32_t PERIOD_MS            = 1'000;
+		static constexpr size_t   WINDOW_PERIODS       = 10;  // Length of the sliding window
+		static constexpr uint32_t MIN_RATE_PERMILLE    = 950; // Of the configured sample rate
+		static constexpr uint32_t MAX_PADDING_PERMILLE = 10;  // Of the written samples
+		static constexpr uint32_t MAX_BUS_ERRORS       = 0;   // Per bus
+	};
+
+	struct BootProfile
+	{
+		static constexpr size_t MAX_STAGES = 16; // Initialization steps and first samples (see util::BootProfile)
+	};
+
+	/**
+	 * \brief Synthetic sensors, which replace the real ones with USE_SYNTHETIC_SENSORS. They generate deterministic
+	 * waveforms at the configured sample rates, so the acquisition and transmission can be benchmarked without a board.
+	 */
+	struct Synthetic
+	{
+		static constexpr int64_t  TICK_US        = 1'000;   // Period of the simulated data ready lines. Faster sensors deliver bursts.
+		static constexpr int64_t  MAX_BACKLOG_US = 100'000; // A sensor which wasn't read for longer restarts its clock instead of catching up.
+		static constexpr uint32_t HEART_RATE_BPM = 72;      // ECG and PPG
+		static constexpr uint32_t STEP_PERIOD_MS = 1'000;   // Step function of the MCP3561
+		static constexpr uint32_t NOISE_SEED     = 0x2545F491;
+	};
+
+	/**
+	 * \brief Event trace of the acquisition and the transmission (see util::Trace). Debug builds only.
+	 */
+	struct Trace
+	{
+#if defined(EDU_DEBUG)
+		static constexpr bool   ENABLED         = true;
+#else
+		static constexpr bool   ENABLED         = false;
+#endif
+		static constexpr size_t EVENTS_PER_CORE = 2'048; // 8 Bytes each. The oldest events get overwritten.
 	};
 
 	struct BDF
 	{
-		static constexpr size_t OVERALL_CHANNELS = ADS1299::CHANNEL_COUNT + BHI160::CHANNEL_COUNT + MAX30102::CHANNEL_COUNT;
-		static constexpr size_t SEND_STACK_SIZE = ADS1299::CHANNEL_COUNT * ADS1299::NODES_IN_BDF_RECORD + 
-											      BHI160::CHANNEL_COUNT * BHI160::NODES_IN_BDF_RECORD +
-											      MAX30102::CHANNEL_COUNT * MAX30102::NODES_IN_BDF_RECORD;
+		static constexpr size_t HEART_RATE_CHANNELS = QRS_DETECTION ? HeartRate::CHANNEL_COUNT : 0;
+		static constexpr size_t OXIMETRY_CHANNELS   = SPO2_ESTIMATION ? Oximetry::CHANNEL_COUNT : 0;
+		static constexpr size_t OVERALL_CHANNELS = ADS1299::CHANNEL_COUNT + BHI160::CHANNEL_COUNT + MAX30102::CHANNEL_COUNT + HEART_RATE_CHANNELS + OXIMETRY_CHANNELS;
+		static constexpr size_t SENSOR_BUFFERS   = 3 + (QRS_DETECTION ? 1 : 0) + (SPO2_ESTIMATION ? 1 : 0); // Ring buffers in the stream
+		// Channels of the widest ring buffer. mem::Resampler packs one sample of all its channels on the stack.
+		static constexpr size_t MAX_SENSOR_CHANNELS = std::max({ADS1299::CHANNEL_COUNT, BHI160::CHANNEL_COUNT, MAX30102::CHANNEL_COUNT,
+		                                                        HeartRate::CHANNEL_COUNT, Oximetry::CHANNEL_COUNT, MCP3561::CHANNEL_COUNT});
+		static_assert(MAX_SENSOR_CHANNELS <= 32, "Channel masks have 32 bits.");
+		static constexpr size_t ANNOTATION_NODES = Annotations::ENABLED ? Annotations::NODES_IN_BDF_RECORD : 0;
+		static constexpr size_t SEND_STACK_SIZE = ADS1299::CHANNEL_COUNT * ADS1299::MAX_NODES_IN_BDF_RECORD + 
+											      BHI160::CHANNEL_COUNT * BHI160::MAX_NODES_IN_BDF_RECORD +
+											      MAX30102::CHANNEL_COUNT * MAX30102::MAX_NODES_IN_BDF_RECORD +
+											      HEART_RATE_CHANNELS * HeartRate::MAX_NODES_IN_BDF_RECORD +
+											      OXIMETRY_CHANNELS * Oximetry::MAX_NODES_IN_BDF_RECORD +
+											      ANNOTATION_NODES;
 	};
 }
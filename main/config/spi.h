@@ -15,7 +15,7 @@ namespace config
         static constexpr auto SCK{GPIO_NUM_18};
         static constexpr auto SPIHost{VSPI_HOST};
         static constexpr auto transferSize{1024};
-        static constexpr auto DMAChannel{SPI_DMA_DISABLED};
+        static constexpr auto DMAChannel{SPI_DMA_CH_AUTO}; // Without DMA a transaction is limited to 64 bytes.
         static constexpr auto Name{"Board SPI"};
     };
 }
@@ -4,6 +4,11 @@
 #include <freertos/task.h>
 #include <freertos/event_groups.h>
 
+#include <algorithm>
+#include <bit>
+
+#include "devices.h"
+
 #define NO_DELAY 0
 #define WATCHDOG_TIME_FOR_HANDLING 10
 #define YIELD_FOR(ms)              xTaskNotifyWait(0, 0, nullptr, pdMS_TO_TICKS(ms))
@@ -11,10 +16,15 @@
 
 #define PIN_SENSOR_CONTROL        true
 #define PIN_TELEMETRY_TRANSMITTER true
+#define PIN_SCHEDULER_DISPATCH    true
+#define PIN_ACQUISITION           true
 
+/**
+ * \brief Notification bits of the sensor control task.
+ */
 struct SensorControlEvent
 {
-	enum
+	enum : uint32_t
 	{
 		// Control Bits 
 		StartMeasurement             = 1 << 0,
@@ -23,22 +33,45 @@ struct SensorControlEvent
 		PulseOximeterReady           = 1 << 2,
 		InertialMeasurementUnitReady = 1 << 3,
 		ElectrocardiogramReady       = 1 << 4,
+		AnalogDigitalConverterReady  = 1 << 5,
+		// Control Bits
+		Reconfigure                  = 1 << 6, // Applies the pending session configuration (see sys::configure_session)
+		ApplySession                 = 1 << 7, // To an acquisition task: Programs the pending sample rates on its bus
 		// Any
 		Any                          = StartMeasurement | 
 		                               StopMeasurement | 
 		                               PulseOximeterReady | 
 		                               InertialMeasurementUnitReady | 
-		                               ElectrocardiogramReady,
+		                               ElectrocardiogramReady |
+		                               AnalogDigitalConverterReady |
+		                               Reconfigure |
+		                               ApplySession,
 	};
 };
 
 namespace config
 {
 	/**
-	 * \brief Sensor Control configuration
+	 * \brief Rate monotonic priority: The faster a source has to be served, the higher its task runs. Rates within a
+	 * factor of two share a level, so the order only changes if a sample rate changes considerably.
+	 */
+	consteval uint32_t rate_monotonic_priority(size_t rateHz)
+	{
+		constexpr uint32_t BASE_PRIORITY = 10; // Above the control and transmitter tasks
+		return BASE_PRIORITY + static_cast<uint32_t>(std::bit_width(rateHz));
+	}
+
+	/**
+	 * \brief Core of the acquisition tasks. Wi-Fi (and therefore most of lwIP) runs on core 0, so its bursts can't
+	 * delay the reads of a sensor.
+	 */
+	constexpr static uint32_t ACQUISITION_TASK_CORE = 1;
+
+	/**
+	 * \brief Sensor Control configuration. Only handles start and stop commands, the sensors are read by the
+	 * acquisition tasks.
 	 */
 	extern TaskHandle_t       SensorControl;
-	extern EventGroupHandle_t SensorControlEventGroup;
 	constexpr static uint32_t SENSOR_CONTROL_TASK_STACK_SIZE = 20'000;
 	constexpr static uint32_t SENSOR_CONTROL_TASK_PRIORITY   = 1;
 #if PIN_SENSOR_CONTROL
@@ -51,6 +84,28 @@ namespace config
 	constexpr static uint32_t TELEMETRY_TRANSMITTER_TASK_STACK_SIZE = 20'000;
 	constexpr static uint32_t TELEMETRY_TRANSMITTER_TASK_PRIORITY   = 2;
 #if PIN_TELEMETRY_TRANSMITTER
-	constexpr static uint32_t TELEMETRY_TRANSMITTER_TASK_CORE       = 1;
+	constexpr static uint32_t TELEMETRY_TRANSMITTER_TASK_CORE       = 0; // With Wi-Fi, away from the acquisition
+#endif
+	/**
+	 * \brief Scheduler dispatch configuration. Runs the jobs of sys::Scheduler above the sensor control task.
+	 */
+	extern TaskHandle_t SchedulerDispatch;
+	constexpr static uint32_t SCHEDULER_DISPATCH_TASK_STACK_SIZE = 4'096;
+	constexpr static uint32_t SCHEDULER_DISPATCH_TASK_PRIORITY   = rate_monotonic_priority(1'000'000 / TSC2003::POLL_PERIOD_US);
+#if PIN_SCHEDULER_DISPATCH
+	constexpr static uint32_t SCHEDULER_DISPATCH_TASK_CORE       = ACQUISITION_TASK_CORE;
 #endif
+	/**
+	 * \brief SPI acquisition configuration. Initializes and reads the ADS1299 and the MCP3561 on their data ready lines.
+	 */
+	extern TaskHandle_t SPIAcquisition;
+	constexpr static uint32_t SPI_ACQUISITION_TASK_STACK_SIZE = 6'144;
+	constexpr static uint32_t SPI_ACQUISITION_TASK_PRIORITY   = rate_monotonic_priority(std::max<size_t>(ADS1299::MAX_SAMPLE_RATE, MCP3561::SAMPLE_RATE));
+	/**
+	 * \brief I2C acquisition configuration. Initializes the I2C devices and reads the MAX30102 and the BHI160 on their data ready lines.
+	 */
+	extern TaskHandle_t I2CAcquisition;
+	constexpr static uint32_t I2C_ACQUISITION_TASK_STACK_SIZE = 8'192; // Runs the firmware upload of the BHI160
+	constexpr static uint32_t I2C_ACQUISITION_TASK_PRIORITY   = rate_monotonic_priority(std::max<size_t>(MAX30102::MAX_SAMPLE_RATE, BHI160::MAX_SAMPLE_RATE));
+	static_assert(SPI_ACQUISITION_TASK_PRIORITY < configMAX_PRIORITIES && I2C_ACQUISITION_TASK_PRIORITY < configMAX_PRIORITIES);
 }
@@ -1,5 +1,7 @@
 // extern
-#include "freertos/FreeRTOS.h" // std
+#include "freertos/FreeRTOS.h"
+#include "esp_heap_caps.h"
+// std
 // intern
 #include "../util/utils.h"
 #include "../util/defines.h"
@@ -7,9 +9,11 @@
 
 #include <array>
 #include <algorithm>
+#include <cassert>
 #include <cstdio>
 
 #include "ADS1299.hpp"
+#include "esp_cpu.h"
 
 namespace device
 {
@@ -93,6 +97,23 @@ namespace device
 		};
 	};
 
+	static constexpr util::byte INVALID_DATA_RATE = 0b111; // Reserved
+
+	constexpr util::byte ADS1299::DataRate(size_t sampleRate)
+	{
+		switch(sampleRate)
+		{
+		case 250:    return Config1Flags::DR_110;
+		case 500:    return Config1Flags::DR_101;
+		case 1'000:  return Config1Flags::DR_100;
+		case 2'000:  return Config1Flags::DR_011;
+		case 4'000:  return Config1Flags::DR_010;
+		case 8'000:  return Config1Flags::DR_001;
+		case 16'000: return Config1Flags::DR_000;
+		default:     return INVALID_DATA_RATE;
+		}
+	}
+
 	struct ADS1299::Config2Flags
 	{
 		enum : util::byte
@@ -120,6 +141,25 @@ namespace device
 		};
 	};
 
+	struct ADS1299::Config4Flags
+	{
+		enum : util::byte
+		{
+			SINGLE_SHOT  = 1 << 3,
+			PD_LOFF_COMP = 1 << 1, // Lead-off comparators enabled
+		};
+	};
+
+	struct ADS1299::LoffFlags
+	{
+		enum : util::byte
+		{
+			COMP_TH_SHIFT   = 5, // Comparator threshold, bits 7:5
+			ILEAD_OFF_SHIFT = 2, // Current magnitude, bits 3:2
+			FLEAD_OFF_DC    = 0b00,
+		};
+	};
+
 	struct ADS1299::ChannelFlags
 	{
 		enum : util::byte
@@ -129,6 +169,7 @@ namespace device
 			SRB2 = 1 << 3,	   // Close SRB2 connection
 			MUXn_001 = 0b001,  // Channel Input Selection: 001 : Input shorted (for offset or noise measurements)
 			MUXn_101 = 0b101,
+			GAIN_SHIFT = 4,    // GAINn are bits 6:4
 		};
 	};
 
@@ -139,29 +180,104 @@ namespace device
 
 	static constexpr util::byte GetBitmapOfChannelNumber()
 	{
-		if constexpr (config::ADS1299::CHANNEL_COUNT == 4)
+		if constexpr (config::ADS1299::CHANNELS_PER_CHIP == 4)
 		{
 			return 0b00;
 		}
-		if constexpr (config::ADS1299::CHANNEL_COUNT == 6)
+		if constexpr (config::ADS1299::CHANNELS_PER_CHIP == 6)
 		{
 			return 0b01;
 		}
-		if constexpr (config::ADS1299::CHANNEL_COUNT == 8)
+		if constexpr (config::ADS1299::CHANNELS_PER_CHIP == 8)
 		{
 			return 0b10;
 		}
 		return 0b11;
 	}
 
+	consteval ADS1299::register_image_t ADS1299::RegisterImage(Mode mode)
+	{
+		static_assert(Register::Config4 - Register::Config1 + 1 == REGISTER_COUNT);
+		constexpr size_t MAX_CHANNEL_COUNT = Register::Ch8Set - Register::Ch1Set + 1;
+		using Input = config::ADS1299::Input;
+
+		register_image_t image{};
+		auto at = [&image](size_t registerAddress) -> util::byte& { return image[registerAddress - Register::Config1]; };
+
+		at(Register::Config1) = Config1Flags::RESERVED | DataRate(config::ADS1299::SAMPLE_RATE * config::ADS1299::DECIMATION); // NOT_DAISY_EN clear: Daisy-chain mode
+		at(Register::Config2) = mode == Mode::TestSignal ? Config2Flags::RESERVED | Config2Flags::INT_CAL | Config2Flags::CAL_FREQ_00
+		                                                 : Config2Flags::RESERVED;
+		bool isBiasUsed    = false;
+		bool isLeadOffUsed = false;
+		for(size_t channel = 0; channel < MAX_CHANNEL_COUNT; channel++)
+		{
+			util::byte& channelSet = at(Register::Ch1Set + channel);
+			if(channel >= config::ADS1299::CHANNELS_PER_CHIP)
+			{
+				channelSet = ChannelFlags::PDn | ChannelFlags::MUXn_001; // Not present on the 4 and 6 channel variants
+				continue;
+			}
+			auto const& settings = config::ADS1299::CHANNELS[channel];
+			const Input input    = mode == Mode::TestSignal ? Input::TestSignal : mode == Mode::InputShorted ? Input::Shorted : settings.input;
+			channelSet = static_cast<util::byte>(settings.gain) << ChannelFlags::GAIN_SHIFT | (settings.srb2 ? ChannelFlags::SRB2 : 0) | static_cast<util::byte>(input);
+			if(settings.bias)
+			{
+				at(Register::BiasSensp) |= 1 << channel;
+				at(Register::BiasSensn) |= 1 << channel;
+				isBiasUsed = true;
+			}
+			// The current sources would disturb the test signal and the noise, so only the configured inputs are checked.
+			if(settings.leadOff && mode == Mode::Measurement)
+			{
+				at(Register::LoffSensp) |= 1 << channel;
+				at(Register::LoffSensn) |= 1 << channel;
+				isLeadOffUsed = true;
+			}
+		}
+		at(Register::Config3) = Config3Flags::NOT_PD_REFBUF | Config3Flags::RESERVED | (isBiasUsed ? Config3Flags::BIASREF_INT | Config3Flags::NOT_PD_BIAS : 0);
+		at(Register::Loff)    = static_cast<util::byte>(config::ADS1299::LEAD_OFF_THRESHOLD) << LoffFlags::COMP_TH_SHIFT
+		                        | static_cast<util::byte>(config::ADS1299::LEAD_OFF_CURRENT) << LoffFlags::ILEAD_OFF_SHIFT | LoffFlags::FLEAD_OFF_DC;
+		at(Register::Gpio)    = 0x0F; // Reset value: All pins are inputs.
+		at(Register::Config4) = isLeadOffUsed ? Config4Flags::PD_LOFF_COMP : 0;
+		return image;
+	}
+
+	consteval ADS1299::register_image_t ADS1299::VerifyMask()
+	{
+		register_image_t mask;
+		mask.fill(0xFF);
+		auto at = [&mask](size_t registerAddress) -> util::byte& { return mask[registerAddress - Register::Config1]; };
+
+		at(Register::LoffStatp) = 0x00; // Read only
+		at(Register::LoffStatn) = 0x00;
+		at(Register::Gpio)      = 0x0F; // The upper nibble reads the levels of the pins.
+		for(size_t channel = config::ADS1299::CHANNELS_PER_CHIP; channel < Register::Ch8Set - Register::Ch1Set + 1; channel++)
+		{
+			at(Register::Ch1Set + channel) = 0x00;
+		}
+		return mask;
+	}
+
 	ADS1299::ADS1299(esp::spiHost<config::ADS1299::Config> const &bus)
 		: esp::spiDevice<config::ADS1299::Config, config::ADS1299::SPI_MAX_TRANSACTION_LENGTH>(
 			  bus, config::ADS1299::CLOCK_SPEED, config::ADS1299::CS_PIN, config::ADS1299::SPI_MODE),
 		  _state(State::Reset),
 		  _noise{},
 		  _ecg{},
+		  _frame{},
+		  _decimator{},
+		  _decimationCycles(0),
+		  _lastDecimationCycles(0),
 		  _nextTime(timepoint_t::clock::now()),
-		  _statusBits(0),
+		  _rxFrame(nullptr),
+		  _txFrame(nullptr),
+		  _frameTransaction{},
+		  _registers{},
+		  _mode(Mode::TestSignal),
+		  _noiseFrames(0),
+		  _status{},
+		  _leadOff(0),
+		  _chipCount(config::ADS1299::CHIP_COUNT),
 		  _resetCounter(0),
 		  _ecgBuffer{},
 		  _noiseBuffer{},
@@ -175,7 +291,15 @@ namespace device
 
 		// Create ring buffers.
 		_ecgBuffer   = mem::RingBuffer(_mutexBuffer, _ecg, sizeof(ecg_t), std::size(_ecg), config::ADS1299::CHANNEL_COUNT);
-		//_noiseBuffer = mem::RingBuffer(_mutexBuffer + 1, _noise, sizeof(voltage_t), std::size(_noise), config::ADS1299::CHANNEL_COUNT, nullptr, 0);
+		_noiseBuffer = mem::RingBuffer(_mutexBuffer + 1, _noise, sizeof(ecg_t), std::size(_noise), config::ADS1299::CHANNEL_COUNT);
+
+		// heap_caps_calloc returns word aligned memory, which the DMA can reach.
+		if(!_rxFrame) _rxFrame = static_cast<util::byte*>(heap_caps_calloc(1, DMA_FRAME_BYTES, MALLOC_CAP_DMA));
+		if(!_txFrame) _txFrame = static_cast<util::byte*>(heap_caps_calloc(1, DMA_FRAME_BYTES, MALLOC_CAP_DMA));
+		assert(_rxFrame && _txFrame);
+		_frameTransaction.length    = DMA_FRAME_BYTES * 8;
+		_frameTransaction.tx_buffer = _txFrame;
+		_frameTransaction.rx_buffer = _rxFrame;
 
 		gpio_set_direction(config::ADS1299::RESET_PIN, GPIO_MODE_OUTPUT);
 		gpio_set_direction(config::ADS1299::N_PDWN_PIN, GPIO_MODE_OUTPUT);
@@ -205,31 +329,132 @@ namespace device
 				}
 			}
 		}
-		SetTestSignals(); // Wait for internal Reference to settle
+		if(!SetMode(config::ADS1299::START_WITH_TEST_SIGNAL ? Mode::TestSignal : Mode::Measurement))
+		{
+			PRINTI("[ADS1299:]", "Registers differ from the image of the start mode.\n");
+		}
+		DetectChips();
 		PRINTI("[ADS1299:]", "Initialization successful.\n");
 	}
 
-	void ADS1299::CaptureData()
+	bool ADS1299::CaptureData()
 	{
-		constexpr size_t TRANSACTION_SIZE = config::ADS1299::CHANNEL_COUNT * sizeof(mem::int24_t);
-		std::array<util::byte, TRANSACTION_SIZE> rxData{};
-		std::array<util::byte, TRANSACTION_SIZE> txData{0x00};
+		bool isValid = this->queueTransaction(_frameTransaction) == ESP_OK && this->waitTransaction() == ESP_OK;
+		for(size_t chip = 0; isValid && chip < _chipCount; chip++)
+		{
+			isValid = HasStatusHeader(chip);
+		}
 
-		sendBlocking(txData, rxData);
-#if 0
-		// Reverse data
-		auto first = rxData.begin();
-		for(util::byte channel = 0; channel < config::ADS1299::CHANNEL_COUNT; ++channel, first = std::next(first, sizeof(voltage_t)))
-			std::reverse(first, std::next(first, sizeof(voltage_t)));
+		if(_noiseFrames)
+		{
+			if(isValid)
+			{
+				DecodeFrame(*static_cast<ecg_t*>(_noiseBuffer.CurrentWrite()));
+				_noiseBuffer.WriteAdvance();
+			}
+			InsertPadding();
+			if(--_noiseFrames == 0 && !WriteImage(_mode))
+			{
+				PRINTI("[ADS1299:]", "Registers differ from the image after the noise capture.\n");
+			}
+			return false;
+		}
 
-		if(!_ecgBuffer.CanWrite())
+		if(!isValid)
+		{
+			InsertPadding();
+			return false;
+		}
+		if constexpr(config::ADS1299::DECIMATION > 1)
 		{
-			PRINTI("[ADS1299:]", "Overflow\n");
+			DecodeFrame(_frame);
+			WriteFrame(_frame);
 		}
-		const auto data = static_cast<voltage_t*>(_ecgBuffer.CurrentWrite());
-		std::memcpy(data->_value, rxData.data(), sizeof(ecg_t));
-#endif
+		else
+		{
+			DecodeFrame(*static_cast<ecg_t*>(_ecgBuffer.CurrentWrite()));
+			_ecgBuffer.WriteAdvance();
+		}
+		return true;
+	}
+
+	void ADS1299::WriteFrame(ecg_t const& frame)
+	{
+		const uint32_t start       = esp_cpu_get_cycle_count();
+		const bool     isDecimated = _decimator.Push(frame.channels, static_cast<ecg_t*>(_ecgBuffer.CurrentWrite())->channels);
+		_decimationCycles         += esp_cpu_get_cycle_count() - start;
+		if(!isDecimated) return;
+
 		_ecgBuffer.WriteAdvance();
+		_lastDecimationCycles = _decimationCycles / config::ADS1299::CHANNEL_COUNT;
+		_decimationCycles     = 0;
+	}
+
+	void ADS1299::DecodeFrame(ecg_t& sample)
+	{
+		// Only the sensed channels have a meaningful comparator output.
+		const uint32_t sensed = _registers[Register::LoffSensp - Register::Config1] | _registers[Register::LoffSensn - Register::Config1];
+		uint32_t leadOff      = 0;
+
+		// Every chip sends the most significant byte first. Channels of chips, which weren't detected, stay 0.
+		sample = ecg_t{};
+		for(size_t chip = 0; chip < _chipCount; chip++)
+		{
+			const util::byte* data = _rxFrame + chip * config::ADS1299::CHIP_FRAME_BYTES;
+			_status[chip]          = (data[0] << 16) | (data[1] << 8) | data[2];
+			leadOff |= ((_status[chip] >> 12 | _status[chip] >> 4) & sensed) << chip * config::ADS1299::CHANNELS_PER_CHIP;
+			data += config::ADS1299::STATUS_BYTES;
+			for(size_t channel = 0; channel < config::ADS1299::CHANNELS_PER_CHIP; channel++, data += sizeof(voltage_t))
+			{
+				voltage_t& voltage = sample.channels[chip * config::ADS1299::CHANNELS_PER_CHIP + channel];
+				voltage._value[0]  = data[2];
+				voltage._value[1]  = data[1];
+				voltage._value[2]  = data[0];
+			}
+		}
+		_leadOff = leadOff;
+	}
+
+	bool ADS1299::HasStatusHeader(size_t chip) const
+	{
+		static constexpr util::byte STATUS_HEADER      = 0xC0;
+		static constexpr util::byte STATUS_HEADER_MASK = 0xF0;
+		return (_rxFrame[chip * config::ADS1299::CHIP_FRAME_BYTES] & STATUS_HEADER_MASK) == STATUS_HEADER;
+	}
+
+	void ADS1299::DetectChips()
+	{
+		// The chain shifts zeros in behind the last chip, so only the frames of present chips start with a status header.
+		static constexpr TickType_t TIMEOUT = pdMS_TO_TICKS(100); // Some periods at the lowest data rate
+		const TickType_t start = xTaskGetTickCount();
+		while(!HasData() && xTaskGetTickCount() - start < TIMEOUT)
+		{
+			vTaskDelay(1);
+		}
+		if(!HasData() || this->queueTransaction(_frameTransaction) != ESP_OK || this->waitTransaction() != ESP_OK)
+		{
+			PRINTI("[ADS1299:]", "No frame to detect the chips. Assuming %u.\n", static_cast<unsigned>(_chipCount));
+			return;
+		}
+
+		size_t chips = 0;
+		while(chips < config::ADS1299::CHIP_COUNT && HasStatusHeader(chips)) chips++;
+		if(chips != config::ADS1299::CHIP_COUNT)
+		{
+			PRINTI("[ADS1299:]", "Found %u of %u chained chips.\n", static_cast<unsigned>(chips), static_cast<unsigned>(config::ADS1299::CHIP_COUNT));
+		}
+		_chipCount = std::max<size_t>(chips, 1);
+	}
+
+	size_t ADS1299::ChipCount() const
+	{
+		return _chipCount;
+	}
+
+	uint32_t ADS1299::AvailableChannels() const
+	{
+		const size_t channels = _chipCount * config::ADS1299::CHANNELS_PER_CHIP;
+		return channels >= 32 ? ~0u : (1u << channels) - 1;
 	}
 
 	bool ADS1299::HasData() const
@@ -237,14 +462,49 @@ namespace device
 		return gpio_get_level(config::ADS1299::N_DRDY_PIN) == 0;
 	}
 
+	uint32_t ADS1299::Status(size_t chip) const
+	{
+		return _status[chip];
+	}
+
+	uint32_t ADS1299::LeadOff() const
+	{
+		return _leadOff;
+	}
+
+	bool ADS1299::StartNoiseCapture()
+	{
+		if(_noiseFrames) return false;
+
+		_noiseBuffer.Reset();
+		_noiseFrames = config::ADS1299::NOISE_CAPTURE_FRAMES;
+		if(!WriteImage(Mode::InputShorted))
+		{
+			PRINTI("[ADS1299:]", "Registers differ from the input shorted image.\n");
+		}
+		return true;
+	}
+
+	bool ADS1299::IsCapturingNoise() const
+	{
+		return _noiseFrames;
+	}
+
 	void ADS1299::InsertPadding()
 	{
-#if 0
-		*static_cast<ecg_t*>(_ecgBuffer.CurrentWrite()) = ecg_t
+		// A zero frame would ring through the decimation filter. Repeating the last one keeps the output rate exact.
+		if constexpr(config::ADS1299::DECIMATION > 1)
 		{
-		};
-#endif
-		_ecgBuffer.WriteAdvance();
+			WriteFrame(_frame);
+			return;
+		}
+		*static_cast<ecg_t*>(_ecgBuffer.CurrentWrite()) = ecg_t{};
+		_ecgBuffer.PaddingAdvance();
+	}
+
+	uint32_t ADS1299::DecimationCycles() const
+	{
+		return _lastDecimationCycles;
 	}
 
 	bool ADS1299::IsReady() const
@@ -318,78 +578,73 @@ namespace device
 		return (IDRegisterData & DeviceIDChannelMask) == DeviceIDCompare;
 	}
 
-	void ADS1299::SetTestSignals()
-	{
-		this->sendBlocking({Command::SDataC});
-
-		// Configure Config 2
-		static constexpr util::byte config2RegisterContent = Config2Flags::RESERVED | Config2Flags::INT_CAL | Config2Flags::CAL_FREQ_00;
-		static constexpr util::byte config2Package[] = {WREG(Register::Config2), BytesToWrite(1), config2RegisterContent};
-		this->sendBlocking(util::to_span(config2Package));
-
-		// Configure Channel 1 - 4
-		static constexpr util::byte channelSettings = ChannelFlags::SRB2 | ChannelFlags::MUXn_101;
-		static constexpr util::byte channelSettingPackage[] = {WREG(Register::Ch1Set), BytesToWrite(4), channelSettings, channelSettings, channelSettings, channelSettings};
-		this->sendBlocking(util::to_span(channelSettingPackage));
-
-		this->sendBlocking({Command::Start});
-		this->sendBlocking({Command::RDataC});
-	}
-
-	void ADS1299::SetNoiseData()
-	{
-		static constexpr util::byte dataRate = []()
-		{
-			return Config1Flags::DR_110;
-			/*if constexpr(config::ADS1299::SAMPLE_RATE == 250)
-				return Config1Flags::DR_110;
-			else if constexpr(config::ADS1299::SAMPLE_RATE == 500)
-				return Config1Flags::DR_101;
-			else if constexpr(config::ADS1299::SAMPLE_RATE == 1'000)
-				return Config1Flags::DR_100;
-			else if constexpr(config::ADS1299::SAMPLE_RATE == 2'000)
-				return Config1Flags::DR_011;
-			else if constexpr(config::ADS1299::SAMPLE_RATE == 4'000)
-				return Config1Flags::DR_010;
-			else if constexpr(config::ADS1299::SAMPLE_RATE == 8'000)
-				return Config1Flags::DR_001;
-			else if constexpr(config::ADS1299::SAMPLE_RATE == 16'000)
-				return Config1Flags::DR_000;*/
-		}();
-		
-		// Configure Config 1
-		static constexpr util::byte config1RegisterContent = Config1Flags::RESERVED | dataRate;
-		static constexpr util::byte config1Package[] = {WREG(Register::Config1), BytesToWrite(1), config1RegisterContent};
-		this->sendBlocking(util::to_span(config1Package));
-
-		// Configure Config 2 to default value
-		static constexpr util::byte config2RegisterContent = Config2Flags::RESERVED;
-		static constexpr util::byte config2Package[] = {WREG(Register::Config2), BytesToWrite(1), config2RegisterContent};
-		this->sendBlocking(util::to_span(config2Package));
-
-		// Set Channel 1 - 4 to input Short
-		static constexpr util::byte channelSetting = ChannelFlags::MUXn_001;
-		static constexpr util::byte channelSettingPackage[] = {WREG(Register::Ch1Set), BytesToWrite(4), channelSetting, channelSetting, channelSetting, channelSetting};
-		this->sendBlocking(util::to_span(channelSettingPackage));
-		this->sendBlocking(util::to_span(Command::Start));
-		this->sendBlocking(util::to_span(Command::RDataC));
+	bool ADS1299::SetSampleRate(size_t sampleRate)
+	{
+		const util::byte dataRate = DataRate(sampleRate * config::ADS1299::DECIMATION);
+		if(dataRate == INVALID_DATA_RATE)
+		{
+			PRINTI("[ADS1299:]", "Unsupported sample rate %u SPS.\n", static_cast<unsigned>(sampleRate));
+			return false;
+		}
+
+		_registers[Register::Config1 - Register::Config1] = Config1Flags::RESERVED | dataRate;
+		_decimator.Reset();
+		_decimationCycles = 0;
+		return WriteRegisters(_registers);
 	}
 
-	void ADS1299::SetCustomSettings()
+	bool ADS1299::SetMode(Mode mode)
 	{
+		_mode        = mode;
+		_noiseFrames = 0;
+		return WriteImage(mode);
+	}
+
+	bool ADS1299::WriteImage(Mode mode)
+	{
+		static constexpr register_image_t IMAGES[] =
+		{
+			RegisterImage(Mode::Measurement),
+			RegisterImage(Mode::TestSignal),
+			RegisterImage(Mode::InputShorted),
+		};
+		const util::byte config1 = _registers[Register::Config1 - Register::Config1];
+		_registers = IMAGES[static_cast<size_t>(mode)];
+		if(config1)
+		{
+			_registers[Register::Config1 - Register::Config1] = config1; // Keep the sample rate
+		}
+		return WriteRegisters(_registers);
+	}
+
+	bool ADS1299::WriteRegisters(register_image_t const& image)
+	{
+		// Registers can only be accessed, while the continuous read mode is stopped.
 		this->sendBlocking(util::to_span(Command::SDataC));
-		//-- Setting up MUX Configuration
-		this->sendBlocking(util::to_span(Command::SDataC));
-		// ConfigureExternalReference Config2 Register to default value!
-		static constexpr util::byte config2RegisterContent = Config2Flags::RESERVED;
-		static constexpr util::byte config2Package[] = {WREG(Register::Config2), BytesToWrite(1), config2RegisterContent};
-		this->sendBlocking(util::to_span(config2Package));
-		// Set all ChannelMux to Gain 1, SRB2 open,
-		// Normal electrode input in normal operation mode!
-		static constexpr util::byte channelPackage[] = {WREG(Register::Ch1Set), BytesToWrite(4), 0, ChannelFlags::MUXn_001, ChannelFlags::MUXn_001, ChannelFlags::MUXn_001};
-		this->sendBlocking(util::to_span(channelPackage));
+
+		std::array<util::byte, 2 + REGISTER_COUNT> writePackage{WREG(Register::Config1), BytesToWrite(REGISTER_COUNT)};
+		std::ranges::copy(image, writePackage.begin() + 2);
+		this->sendBlocking(writePackage);
+
+		const std::array<util::byte, 2 + REGISTER_COUNT> readPackage{RREG(Register::Config1), BytesToWrite(REGISTER_COUNT)};
+		std::array<util::byte, 2 + REGISTER_COUNT> readback{};
+		this->sendBlocking(readPackage, readback);
+
+		static constexpr register_image_t VERIFY_MASK = VerifyMask();
+		bool isVerified = true;
+		for(size_t index = 0; index < REGISTER_COUNT; index++)
+		{
+			const util::byte value = readback[2 + index];
+			if((value ^ image[index]) & VERIFY_MASK[index])
+			{
+				PRINTI("[ADS1299:]", "Register 0x%02X reads 0x%02X instead of 0x%02X.\n",
+					   static_cast<unsigned>(Register::Config1 + index), static_cast<unsigned>(value), static_cast<unsigned>(image[index]));
+				isVerified = false;
+			}
+		}
 
 		this->sendBlocking(util::to_span(Command::Start));
 		this->sendBlocking(util::to_span(Command::RDataC));
+		return isVerified;
 	}
 }
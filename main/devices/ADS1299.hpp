@@ -5,12 +5,14 @@
 #include "../util/types.h"
 #include "../memory/int.h"
 #include "../memory/ring_buffer.h"
+#include "../dsp/decimator.h"
 // external
 #include <esp_util/spiDevice.hpp>
 #include <esp_util/spiHost.hpp>
 #include "freertos/FreeRTOS.h"
 #include "esp_attr.h"
 // std
+#include <array>
 #include <chrono>
 
 namespace device
@@ -18,13 +20,51 @@ namespace device
 	class ADS1299 : protected esp::spiDevice<config::ADS1299::Config, config::ADS1299::SPI_MAX_TRANSACTION_LENGTH>
 	{
 	public:
+		/**
+		 * \brief Inputs of the channels. Each mode is one register image (see config::ADS1299::CHANNELS).
+		 */
+		enum class Mode : util::byte
+		{
+			Measurement,  // Inputs as configured
+			TestSignal,   // Internal square wave on all channels
+			InputShorted, // Offset and noise of the front end
+		};
+
 		explicit ADS1299(esp::spiHost<config::ADS1299::Config> const& bus);
 
 		void Init();
 		bool IsReady() const;
-		void CaptureData();
+		/**
+		 * \brief Reads one frame in the continuous read mode (RDATAC) into the ring buffer. The transfer runs on DMA,
+		 * so the calling task sleeps meanwhile. A frame, which failed or whose status word is invalid, is written as
+		 * padding. During a noise capture the frame goes into the noise ring buffer and the ECG is padded.
+		 * With oversampling (config::ADS1299::DECIMATION) the frame goes through the decimator, which writes every
+		 * DECIMATION-th frame into the ring buffer.
+		 * \return false if padding was written.
+		 */
+		bool CaptureData();
 		bool HasData() const;
-		void InsertPadding();
+		uint32_t Status(size_t chip = 0) const; // Status word of the last valid frame: 1100, LOFF_STATP, LOFF_STATN, GPIO
+		uint32_t LeadOff() const;               // Channel mask of the detached electrodes in the last valid frame
+		size_t   ChipCount() const;             // Chips in the daisy chain, which answered at Init
+		uint32_t AvailableChannels() const;     // Channel mask of the detected chips
+		void InsertPadding(); // With oversampling: Repeats the last valid frame into the decimator.
+		uint32_t DecimationCycles() const; // CPU cycles of the last decimated frame per channel
+		/**
+		 * \brief Shorts the inputs for the next NOISE_CAPTURE_FRAMES frames, which replace the noise ring buffer. Then
+		 * the previous mode is restored. Returns false if a capture is still running.
+		 */
+		bool StartNoiseCapture();
+		bool IsCapturingNoise() const;
+		/**
+		 * \brief Sets the output data rate, the chips run DECIMATION times faster. Returns false if the device doesn't
+		 * support 'sampleRate'.
+		 */
+		bool SetSampleRate(size_t sampleRate);
+		/**
+		 * \brief Writes the register image of 'mode' and keeps the sample rate. Returns false if the readback differs.
+		 */
+		bool SetMode(Mode mode);
 
 		mem::RingBuffer* ECGRingBuffer();
 		mem::RingBuffer* NoiseRingBuffer();
@@ -37,7 +77,9 @@ namespace device
 		struct Config1Flags;
 		struct Config2Flags;
 		struct Config3Flags;
+		struct Config4Flags;
 		struct ChannelFlags;
+		struct LoffFlags;
 		struct RegisterAccess
 		{
 			enum : util::byte
@@ -54,25 +96,55 @@ namespace device
 		{
 			voltage_t channels[config::ADS1299::CHANNEL_COUNT];
 		};
+		using decimator_t = dsp::Decimator<config::ADS1299::DECIMATION, config::ADS1299::DECIMATION_TAPS_PER_PHASE, config::ADS1299::CHANNEL_COUNT>;
 
 		static constexpr util::byte RREG(util::byte registerAddress);
 		static constexpr util::byte WREG(util::byte registerAddress);
+		static constexpr util::byte DataRate(size_t sampleRate); // DR bits of CONFIG1 or INVALID_DATA_RATE
+
+		// Register image: CONFIG1 (0x01) to CONFIG4 (0x17), written with one WREG and verified with one RREG.
+		static constexpr size_t REGISTER_COUNT = 23;
+		using register_image_t = std::array<util::byte, REGISTER_COUNT>;
+		static consteval register_image_t RegisterImage(Mode mode);
+		static consteval register_image_t VerifyMask(); // Bits which read back as written
 
+		// The DMA writes whole words. Otherwise the driver would allocate a bounce buffer for every frame.
+		static constexpr size_t DMA_FRAME_BYTES = (config::ADS1299::FRAME_BYTES + 3) & ~size_t{3};
+		static_assert(DMA_FRAME_BYTES <= config::ADS1299::Config::transferSize, "A frame has to fit into one transaction of the bus.");
 
 		void Reset();
 		void PowerUp();
 		void WaitForPower();
 		void ConfigureExternalReference();
 		bool IsPoweredUp();
-		void SetTestSignals();
-		void SetNoiseData();
-		void SetCustomSettings();
+		/**
+		 * \brief Stops the continuous read, writes 'image' in one burst, reads it back in one burst and restarts the
+		 * conversions. Returns false if a register differs from the image.
+		 */
+		bool WriteRegisters(register_image_t const& image);
+		bool WriteImage(Mode mode); // Keeps the sample rate
+		bool HasStatusHeader(size_t chip) const; // Of the last frame
+		void DecodeFrame(ecg_t& sample);
+		void WriteFrame(ecg_t const& frame); // Through the decimator into the ECG ring buffer
+		void DetectChips();
 
 		State _state;
-		ecg_t _noise[config::ADS1299::NOISE_SAMPLES_IN_RING_BUFFER]; // Noise data (Not implemented)
+		ecg_t _noise[config::ADS1299::NOISE_SAMPLES_IN_RING_BUFFER]; // Input-shorted frames of the last noise capture
 		ecg_t _ecg[config::ADS1299::ECG_SAMPLES_IN_RING_BUFFER]; // Electrocardiography data
+		ecg_t _frame; // Last valid frame at the device rate
+		decimator_t       _decimator;
+		uint32_t          _decimationCycles; // Since the last decimated frame
+		uint32_t          _lastDecimationCycles;
 		timepoint_t       _nextTime;
-		uint32_t          _statusBits;
+		util::byte*       _rxFrame; // DMA capable, allocated at Init
+		util::byte*       _txFrame; // DMA capable zeros. No command may be sent during a read.
+		spi_transaction_t _frameTransaction; // Built once, queued for every frame
+		register_image_t  _registers; // Image of the current mode and sample rate
+		Mode              _mode;
+		size_t            _noiseFrames; // Left in the running noise capture
+		uint32_t          _status[config::ADS1299::CHIP_COUNT];
+		uint32_t          _leadOff;
+		size_t            _chipCount;
 		size_t            _resetCounter;
 		mem::RingBuffer	  _ecgBuffer;
 		mem::RingBuffer	  _noiseBuffer;
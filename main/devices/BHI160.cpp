@@ -6,12 +6,32 @@
 #include <algorithm>
 
 #include "BHI160_Firmware.hpp"
+#include "esp_system.h"
+#include "esp_timer.h"
 
 #include <cstdio>
 #include <cstring>
 
 namespace device
 {
+	namespace
+	{
+		/**
+		 * \brief The RAM patch, which the last boot uploaded. RTC memory keeps it over a reset of the ESP32 (e.g. a crash
+		 * or an update), which doesn't reset the BHI160, so the next boot can skip the upload.
+		 */
+		struct ram_patch
+		{
+			static constexpr uint32_t VALID = 0xB416'0A7C;
+
+			uint32_t valid;       // VALID, otherwise the RTC memory is uninitialized
+			uint32_t firmwareCRC; // BHI160_Firmware_CRC of the upload
+			uint16_t ramVersion;  // RAM_Version, once the patch ran
+		};
+
+		RTC_NOINIT_ATTR ram_patch lastPatch;
+	}
+
 	enum class BHI160::State : util::byte
 	{
 		Reset,
@@ -75,9 +95,11 @@ namespace device
 
 	BHI160::BHI160()
 		: _acceleration{},
+		  _sampleRate(config::BHI160::SAMPLE_RATE),
 		  _timestamp(0),
 		  _nextTime(timepoint_t::clock::now()),
 		  _bytesInFIFO(0),
+		  _fifoLevel(0),
 		  _state(State::Reset)
 	{
 	}
@@ -89,30 +111,65 @@ namespace device
 
 		gpio_set_direction(config::BHI160::INTERRUPT_PIN, GPIO_MODE_INPUT);
 
-		PRINTI("[BHI160:]", "Resetting...\n");
-		Reset();
-
-		if(gpio_get_level(config::BHI160::INTERRUPT_PIN))
+		if(IsPatchRunning())
 		{
-			StartRAMPatch();
-			_state = State::FirmwareUpload;
-			PRINTI("[BHI160:]", "Uploading firmware...\n");
+			PRINTI("[BHI160:]", "RAM patch %04X is still running. Skipping the upload.\n", lastPatch.ramVersion);
+			static constexpr util::byte flushPackage[] = {Register::FIFO_Flush, Command::FLUSH_ALL};
+			this->write(util::to_span(flushPackage)); // Events of the previous boot
 		}
-
-		UploadFirmware();
-		StartCPU();
-		if(gpio_get_level(config::BHI160::INTERRUPT_PIN))
+		else if(!LoadRAMPatch())
 		{
-			PRINTI("[BHI160:]", "Configuring device...\n");
-			PrintVersionAndStatus();
-			_state = State::Configuration;
+			PRINTI("[BHI160:]", "**Error** No valid RAM patch after %u attempts. The accelerometer stays off.\n", static_cast<unsigned>(config::BHI160::UPLOAD_ATTEMPTS));
+			return;
 		}
 
+		PRINTI("[BHI160:]", "Configuring device...\n");
+		PrintVersionAndStatus();
+		_state = State::Configuration;
 		ConfigureDevices();
 
 		PRINTI("[BHI160:]", "Initialization successful.\n");
 	}
 
+	bool BHI160::IsPatchRunning()
+	{
+		// After a power on, the RTC memory is random and the BHI160 waits for its patch anyway.
+		if(esp_reset_reason() == ESP_RST_POWERON || esp_reset_reason() == ESP_RST_BROWNOUT) return false;
+		if(lastPatch.valid != ram_patch::VALID || lastPatch.firmwareCRC != BHI160_Firmware_CRC || !lastPatch.ramVersion) return false;
+
+		std::uint8_t chipControl = 0;
+		if(this->read(Register::Chip_Control, 1, &chipControl) != ESP_OK) return false;
+		return chipControl == Command::CPU_Run_Request && ReadRAMVersion() == lastPatch.ramVersion;
+	}
+
+	bool BHI160::LoadRAMPatch()
+	{
+		lastPatch.valid = 0;
+		for(size_t attempt = 1; attempt <= config::BHI160::UPLOAD_ATTEMPTS; attempt++)
+		{
+			PRINTI("[BHI160:]", "Resetting...\n");
+			Reset();
+			if(!gpio_get_level(config::BHI160::INTERRUPT_PIN))
+			{
+				PRINTI("[BHI160:]", "No interrupt after the reset.\n");
+			}
+			StartRAMPatch();
+			_state = State::FirmwareUpload;
+			PRINTI("[BHI160:]", "Uploading firmware (attempt %u)...\n", static_cast<unsigned>(attempt));
+			if(!UploadFirmware()) continue;
+
+			StartCPU();
+			lastPatch = ram_patch
+			{
+				.valid       = ram_patch::VALID,
+				.firmwareCRC = BHI160_Firmware_CRC,
+				.ramVersion  = ReadRAMVersion(),
+			};
+			return true;
+		}
+		return false;
+	}
+
 	void BHI160::HandleData(std::span<util::byte> package)
 	{
 		if(package.empty()) return;
@@ -178,47 +235,40 @@ namespace device
 		vTaskDelay(pdMS_TO_TICKS(10));
 	}
 
-	void BHI160::UploadFirmware()
+	bool BHI160::UploadFirmware()
 	{
 		static constexpr util::byte uploadAddress0[] = {Register::Upload_Address_0, util::PADDING_BYTE, util::PADDING_BYTE};
 		this->write(util::to_span(uploadAddress0));
-		std::size_t counter = 0;
 		vTaskDelay(pdMS_TO_TICKS(10));
-		auto iterBegin{BHI160_Firmware.begin()};
-		while(iterBegin < BHI160_Firmware.end())
-		{
-			static constexpr size_t BYTES_TO_WRITE = 16;
-			util::byte buffer[BYTES_TO_WRITE + 1];
 
-			buffer[0] = Register::Upload_Data;
-			if(iterBegin + BYTES_TO_WRITE > BHI160_Firmware.end())
-			{
-				auto bytesUntilEnd{(BHI160_Firmware.end() - iterBegin)};
-				counter = counter + bytesUntilEnd;
-				std::memcpy(&buffer[1], iterBegin, bytesUntilEnd);
-				this->write(std::span{buffer, buffer + bytesUntilEnd + 1});
-			} else
+		// Upload_Data increments the address by itself, so every burst continues where the previous one stopped.
+		const std::span firmware(reinterpret_cast<const util::byte*>(BHI160_Firmware.data()), BHI160_Firmware.size());
+		const int64_t   start  = esp_timer_get_time();
+		size_t          bursts = 0;
+		for(size_t offset = 0; offset < firmware.size(); offset += config::BHI160::UPLOAD_BURST_BYTES, bursts++)
+		{
+			const auto burst = firmware.subspan(offset, std::min(config::BHI160::UPLOAD_BURST_BYTES, firmware.size() - offset));
+			if(this->writeRegister(Register::Upload_Data, burst) != ESP_OK)
 			{
-				counter += BYTES_TO_WRITE;
-				std::memcpy(&buffer[1], iterBegin, BYTES_TO_WRITE);
-				this->write(buffer);
+				PRINTI("[BHI160:]", "Upload failed at byte %u.\n", static_cast<unsigned>(offset));
+				return false;
 			}
-			iterBegin += BYTES_TO_WRITE;
 		}
+		PRINTI("[BHI160:]", "%u Bytes written in %u bursts within %lld ms.\n", static_cast<unsigned>(firmware.size()),
+			   static_cast<unsigned>(bursts), (esp_timer_get_time() - start) / 1'000);
 
-		PRINTI("[BHI160:]", "%u Bytes written...\n", counter);
-
-		vTaskDelay(pdMS_TO_TICKS(10)); 
-
-		std::array<std::uint8_t, 4> registerCRC;
-		this->read(Register::Upload_CRC, registerCRC.size(), &registerCRC[0]);
-		std::ranges::reverse(registerCRC);
-		PRINTI("[BHI160:]", "Register CRC: 0x%04lx, Firmware CRC: 0x%04lx", *reinterpret_cast<uint32_t*>(registerCRC.data()),  BHI160_Firmware_CRC);
-		uint16_t registerAddress;
-		this->read(Register::Upload_Address_0, sizeof(registerAddress), reinterpret_cast<util::byte*>(&registerAddress));
-		//this->read(Register::Upload_Address_1, 1, &RegisterAddress[1]);
-		//fmt::print("[BHI160:] Register Address 0x{:02x}\n", registerAddress);
+		vTaskDelay(pdMS_TO_TICKS(10));
 
+		// CRC-32/MPEG-2 of the uploaded bytes. The datasheet stores it little endian: 0x97 holds the LSB, 0x9A the MSB.
+		util::byte crcBytes[4] = {};
+		if(this->read(Register::Upload_CRC, sizeof(crcBytes), crcBytes) != ESP_OK) return false;
+		const uint32_t registerCRC = crcBytes[0] | crcBytes[1] << 8 | crcBytes[2] << 16 | static_cast<uint32_t>(crcBytes[3]) << 24;
+		if(registerCRC != BHI160_Firmware_CRC)
+		{
+			PRINTI("[BHI160:]", "CRC mismatch: Register 0x%08lx, firmware 0x%08lx\n", static_cast<unsigned long>(registerCRC), static_cast<unsigned long>(BHI160_Firmware_CRC));
+			return false;
+		}
+		return true;
 	}
 
 	void BHI160::StartCPU()
@@ -245,10 +295,10 @@ namespace device
 		static constexpr std::uint8_t  sensorID = 65;
 
 		// Register - Sample Rate 16 Bit - Latency ms 16Bit
-		static constexpr util::byte sensorConfig[] = {
+		const util::byte sensorConfig[] = {
 		  Register::Parameter_Write_Buffer,
-		  (config::BHI160::SAMPLE_RATE & 0xFF),
-		  (config::BHI160::SAMPLE_RATE & 0xFF00) >> BYTES_TO_BITS(1),
+		  static_cast<util::byte>(_sampleRate & 0xFF),
+		  static_cast<util::byte>((_sampleRate & 0xFF00) >> BYTES_TO_BITS(1)),
 		  (config::BHI160::LATENCY & 0xFF),
 		  (config::BHI160::LATENCY & 0xFF00) >> BYTES_TO_BITS(1),
 		  (config::BHI160::DYNAMIC_RANGE & 0xFF),
@@ -266,15 +316,28 @@ namespace device
 		//Enable other Step counter with 0 latency
 	}
 
+	void BHI160::SetSampleRate(uint16_t sampleRate)
+	{
+		_sampleRate = sampleRate;
+		ConfigureDevices();
+		PRINTI("[BHI160:]", "Sample rate set to %u SPS.\n", static_cast<unsigned>(_sampleRate));
+	}
+
 	void BHI160::GetRemainingFIFOSize()
 	{
 		std::uint16_t rxData;
 		this->read(Register::Bytes_Remaining, util::total_size(rxData), reinterpret_cast<util::byte*>(&rxData));
 
 		std::memcpy(&_bytesInFIFO, &rxData, util::total_size(rxData));
+		_fifoLevel = _bytesInFIFO;
 		//fmt::print("BHI160: Bytes remaining: {}\n", _bytesInFIFO);
 	}
 
+	uint16_t BHI160::FIFOLevel() const
+	{
+		return _fifoLevel;
+	}
+
 	void BHI160::GetData()
 	{
 		if(_bytesInFIFO == 0)
@@ -326,14 +389,19 @@ namespace device
 		};
 #endif
 
-		_buffer.WriteAdvance();
+		_buffer.PaddingAdvance();
 	}
 
-	void BHI160::PrintVersionAndStatus()
+	std::uint16_t BHI160::ReadRAMVersion()
 	{
-		std::uint16_t RAMVersion;
+		std::uint16_t RAMVersion = 0;
 		this->read(Register::RAM_Version, sizeof(RAMVersion), reinterpret_cast<util::byte*>(&RAMVersion));
-		PRINTI("[BHI160:]", "RAM Version %02X\n", RAMVersion);
+		return RAMVersion;
+	}
+
+	void BHI160::PrintVersionAndStatus()
+	{
+		PRINTI("[BHI160:]", "RAM Version %02X\n", ReadRAMVersion());
 
 		std::uint16_t ROMVersion;
 		this->read(Register::ROM_Version, sizeof(ROMVersion), reinterpret_cast<util::byte*>(&ROMVersion));
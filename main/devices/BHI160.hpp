@@ -24,8 +24,13 @@ namespace device
 		mem::RingBuffer* RingBuffer();
 		bool             HasData() const;
 		void             GetRemainingFIFOSize();
+		uint16_t         FIFOLevel() const; // Bytes in the FIFO at the last GetRemainingFIFOSize()
 		void             GetData();
 		void             InsertPadding();
+		/**
+		 * \brief Reconfigures the accelerometer. 'sampleRate' has to be one of config::SampleRates::BHI160_SELECTABLE.
+		 */
+		void             SetSampleRate(uint16_t sampleRate);
 
 	private:
 
@@ -36,9 +41,12 @@ namespace device
 
 		void HandleData(std::span<util::byte> package);
 		void Reset();
+		bool IsPatchRunning(); // The RAM patch of this firmware survived a reset of the ESP32 (warm boot).
+		bool LoadRAMPatch();   // Uploads and starts the RAM patch. Retries on a CRC mismatch.
 		void StartRAMPatch();
-		void UploadFirmware();
+		bool UploadFirmware(); // Returns false if the CRC of the chip doesn't match the firmware.
 		void StartCPU();
+		std::uint16_t ReadRAMVersion();
 		void ConfigureDevices();
 		void PrintVersionAndStatus();
 
@@ -52,9 +60,11 @@ namespace device
 		using timepoint_t = std::chrono::time_point<std::chrono::system_clock>;
 		acceleration_t _acceleration[config::BHI160::SAMPLES_IN_RING_BUFFER];
 
+		uint16_t                  _sampleRate;
 		util::timestamp_t         _timestamp;
 		timepoint_t               _nextTime;
 		std::uint16_t             _bytesInFIFO;
+		std::uint16_t             _fifoLevel;
 		State                     _state;
 		StaticSemaphore_t         _mutexBuffer{};
 		mem::RingBuffer           _buffer;
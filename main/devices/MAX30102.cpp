@@ -60,6 +60,7 @@ namespace device
 		  _buffer(),
 	      _nextTime(timepoint_t::clock::now()),
 	      _numberOfSamples(0),
+		  _burst{},
 		  _mutexBuffer(),
 	      _state(State::Reset)
 	{
@@ -98,26 +99,54 @@ namespace device
 		this->write(util::to_span(resetPackage));
 	}
 
+	bool MAX30102::SetSampleRate(size_t sampleRate)
+	{
+		util::byte sampleRateBits;
+		switch(sampleRate)
+		{
+		case 50:    sampleRateBits = 0b000; break;
+		case 100:   sampleRateBits = 0b001; break;
+		case 200:   sampleRateBits = 0b010; break;
+		case 400:   sampleRateBits = 0b011; break;
+		case 800:   sampleRateBits = 0b100; break;
+		case 1'000: sampleRateBits = 0b101; break;
+		case 1'600: sampleRateBits = 0b110; break;
+		case 3'200: sampleRateBits = 0b111; break;
+		default:
+			PRINTI("[MAX30102:]", "Unsupported sample rate %u SPS.\n", static_cast<unsigned>(sampleRate));
+			return false;
+		}
+
+		static constexpr util::byte pulseWidth = 0b11;
+		static constexpr util::byte adcRange = 0b11;
+		const util::byte spo2ConfigData = adcRange << 5 | sampleRateBits << 2 | pulseWidth;
+		const util::byte spo2Package[] = {Register::SPO2Config, spo2ConfigData};
+		this->write(util::to_span(spo2Package));
+		return true;
+	}
+
 	void MAX30102::Configure()
 	{
 		static constexpr util::byte modeControl = 0b011;
 		static constexpr util::byte modeControlPackage[] = {Register::ModeConfig, modeControl};
 		this->write(util::to_span(modeControlPackage));
 
-		static constexpr util::byte sampleRate = 0b001;
-		static constexpr util::byte pulseWidth = 0b11;
-		static constexpr util::byte adcRange = 0b11;
-		static constexpr util::byte spo2ConfigData = adcRange << 5 | sampleRate << 2 | pulseWidth;
-		static constexpr util::byte spo2Package[] = {Register::SPO2Config, spo2ConfigData};
-		this->write(util::to_span(spo2Package));
+		DISCARD SetSampleRate(config::MAX30102::SAMPLE_RATE);
 
-		static constexpr util::byte sampleAverage = 0b001;
+		// SMP_AVE: No averaging. Otherwise the FIFO would fill at a fraction of the sample rate, which the timestamps assume.
+		// FIFO_A_FULL: Free samples in the FIFO, when the interrupt asserts.
+		static constexpr util::byte sampleAverage = 0b000;
 		static constexpr util::byte fifoRolloverEnable = 0b1;
-		static constexpr util::byte fifoAFull = 0b0000;
+		static constexpr util::byte fifoAFull = config::MAX30102::FIFO_DEPTH - config::MAX30102::FIFO_BURST_SAMPLES;
 		static constexpr util::byte fifoConfigData = sampleAverage << 5 | fifoRolloverEnable << 4 | fifoAFull;
 		static constexpr util::byte fifoPackage[] = {Register::FiFoConfig, fifoConfigData};
 		this->write(util::to_span(fifoPackage));
 
+		// Signal a burst of samples on the interrupt line instead of every single one.
+		static constexpr util::byte fifoAlmostFullEnable = 0b1000'0000;
+		static constexpr util::byte interruptPackage[] = {Register::InterruptEnable1, fifoAlmostFullEnable};
+		this->write(util::to_span(interruptPackage));
+
 		static constexpr util::byte ledBrightness = 128;
 		static constexpr util::byte led1AmplitudePackage[] = {Register::LED1PulseAmplitude, ledBrightness};
 		static constexpr util::byte led2AmplitudePackage[] = {Register::LED2PulseAmplitude, ledBrightness};
@@ -125,62 +154,62 @@ namespace device
 		this->write(util::to_span(led2AmplitudePackage));
 	}
 
-	void MAX30102::ReadData()
+	MAX30102::sample_t MAX30102::Decode(util::byte const* data)
 	{
-		std::array<util::byte, 6> rxData;
-		this->read(Register::FiFoDataRegister, util::total_size(rxData), rxData.data());
-		std::ranges::reverse(rxData);
-
-		sample_t tempRed, tempInfraRed;
-
-#if 0
-		std::memcpy(&tempRed._value, rxData.data() + sizeof(sample_t), sizeof(sample_t));
-		std::memcpy(&tempInfraRed._value, rxData.data(), sizeof(sample_t));
-#endif
-
-		// sample data has a maximum width of 18 Bits, so discard the rest.
-		tempRed._value[3]	   &= 0x03;
-		tempInfraRed._value[3] &= 0x03; 
-
-#if 0
-		*static_cast<oxi_sample*>(_buffer.CurrentWrite()) = oxi_sample
-		{
-			.red = tempRed,
-			.infraRed = tempInfraRed
-		};
-#endif
-		_buffer.WriteAdvance();
-		_numberOfSamples--;
+		// Big endian and left aligned to bit 17, independent of the ADC resolution. The bits above are undefined.
+		const uint32_t value = static_cast<uint32_t>(data[0]) << 16 | static_cast<uint32_t>(data[1]) << 8 | data[2];
+		return sample_t(static_cast<int32_t>(value & 0x3'FFFF));
 	}
 
-	void MAX30102::InsertPadding()
+	uint32_t MAX30102::ReadStatus()
 	{
-#if 0
-		*static_cast<oxi_sample*>(_buffer.CurrentWrite()) = oxi_sample
+		// The status, enable and pointer registers are consecutive: One read clears the interrupt and yields the pointers.
+		constexpr size_t WRITE_POINTER    = Register::FiFoWrite - Register::InterruptStatus1;
+		constexpr size_t OVERFLOW_COUNTER = Register::OverflowCounter - Register::InterruptStatus1;
+		constexpr size_t READ_POINTER     = Register::FiFoRead - Register::InterruptStatus1;
+		util::byte registers[READ_POINTER + 1]{};
+		if(this->read(Register::InterruptStatus1, std::size(registers), registers) != ESP_OK)
 		{
-			.red      = static_cast<uint32_t>(0),
-			.infraRed = static_cast<uint32_t>(0)
-		};
-#endif
-		_buffer.WriteAdvance();
+			_numberOfSamples = 0;
+			return 0;
+		}
+
+		constexpr uint32_t POINTER_MASK = config::MAX30102::FIFO_DEPTH - 1;
+		const uint32_t lostSamples = registers[OVERFLOW_COUNTER];
+		_numberOfSamples = (registers[WRITE_POINTER] - registers[READ_POINTER]) & POINTER_MASK;
+		if(!_numberOfSamples && lostSamples)
+		{
+			_numberOfSamples = config::MAX30102::FIFO_DEPTH; // The pointers are equal, if the FIFO is full.
+		}
+		return lostSamples;
 	}
 
-	void MAX30102::ReadBufferSize()
+	uint32_t MAX30102::ReadData()
 	{
-		std::uint8_t ReadPointer = 0, WritePointer = 0;
-		this->read(Register::FiFoRead, 1, &ReadPointer);
-		this->read(Register::FiFoWrite, 1, &WritePointer);
-		_numberOfSamples = WritePointer - ReadPointer;
-		if(_numberOfSamples < 0)
+		const uint32_t samples = _numberOfSamples;
+		_numberOfSamples = 0;
+		if(!samples) return 0;
+
+		// The FIFO data register doesn't increment the address: Every 6 bytes of the burst pop one sample.
+		if(this->read(Register::FiFoDataRegister, samples * config::MAX30102::FIFO_SAMPLE_BYTES, _burst) != ESP_OK) return 0;
+
+		util::byte const* data = _burst;
+		for(uint32_t sample = 0; sample < samples; sample++, data += config::MAX30102::FIFO_SAMPLE_BYTES)
 		{
-			_numberOfSamples += 32;
+			// SpO2 mode: LED1 (red) first, then LED2 (infrared).
+			*static_cast<oxi_sample*>(_buffer.CurrentWrite()) = oxi_sample
+			{
+				.red      = Decode(data),
+				.infraRed = Decode(data + 3),
+			};
+			_buffer.WriteAdvance();
 		}
+		return samples;
 	}
 
-	bool MAX30102::HasData() 
+	void MAX30102::InsertPadding()
 	{
-		if(_numberOfSamples == 0)
-			ReadBufferSize();
-		return _numberOfSamples != 0;
+		*static_cast<oxi_sample*>(_buffer.CurrentWrite()) = oxi_sample{};
+		_buffer.PaddingAdvance();
 	}
 }
@@ -27,11 +27,22 @@ namespace device
 		void Init();
 		mem::RingBuffer* RingBuffer();
 
-		void ReadBufferSize();
-		bool HasData();
 		bool IsReady() const;
-		void ReadData();
+		/**
+		 * \brief Reads the interrupt status and the FIFO pointers in one transaction, which releases the interrupt line.
+		 * \return Samples lost due to a FIFO overflow since the last read.
+		 */
+		uint32_t ReadStatus();
+		/**
+		 * \brief Reads the samples, which were pending at ReadStatus(), in one burst and decodes them into the ring buffer.
+		 * \return Number of samples read.
+		 */
+		uint32_t ReadData();
 		void InsertPadding();
+		/**
+		 * \brief Sets the SpO2 sample rate. Returns false if the sensor doesn't support 'sampleRate'.
+		 */
+		bool SetSampleRate(size_t sampleRate);
 
 	private:
 		using sample_t = mem::int24_t;
@@ -48,11 +59,13 @@ namespace device
 
 		void Reset();
 		void Configure();
+		static sample_t Decode(util::byte const* data); // One channel of a FIFO sample
 
 		oxi_sample                _underlyingBuffer[config::MAX30102::SAMPLES_IN_RING_BUFFER]; // Don't use directly! Use _buffer instead.
 		mem::RingBuffer           _buffer;
 		timepoint_t               _nextTime;
-		int32_t                   _numberOfSamples;
+		uint32_t                  _numberOfSamples; // Pending in the FIFO at the last ReadStatus()
+		util::byte                _burst[config::MAX30102::FIFO_DEPTH * config::MAX30102::FIFO_SAMPLE_BYTES];
 		StaticSemaphore_t         _mutexBuffer{};
 		State                     _state;
 	};
@@ -190,6 +190,6 @@ namespace device
 	void MCP3561::InsertPadding()
 	{
 		*static_cast<mem::int24_t*>(_buffer.CurrentWrite()) = mem::int24_t((int32_t)0);
-		_buffer.WriteAdvance();
+		_buffer.PaddingAdvance();
 	}
 }
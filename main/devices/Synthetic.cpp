@@ -0,0 +1,410 @@
+#include "Synthetic.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+
+#include "esp_timer.h"
+
+#include "../util/defines.h"
+
+namespace device
+{
+	namespace
+	{
+		constexpr size_t   TEMPLATE_SIZE  = 256;  // Points of one beat
+		constexpr uint32_t FRACTION_BITS  = 8;    // Between two template points
+		constexpr int32_t  ECG_AMPLITUDE  = 100'000;
+		constexpr int32_t  ECG_NOISE      = 500;
+		constexpr int32_t  PPG_RED_DC     = 120'000;
+		constexpr int32_t  PPG_RED_AC     = 1'400;  // R = 0.58, i.e. SpO2 97 % on the curve of config::Oximetry
+		constexpr int32_t  PPG_IR_DC      = 150'000;
+		constexpr int32_t  PPG_IR_AC      = 3'000;
+		constexpr int32_t  PPG_NOISE      = 50;
+		constexpr float    PPG_DELAY      = 0.2f;   // Pulse transit time in beats
+		constexpr int32_t  ONE_G          = 16'384; // Acceleration of 1 g
+		constexpr float    STEP_FREQUENCY = 1.8f;   // Steps per second
+		constexpr int32_t  ACCEL_NOISE    = 80;
+		constexpr int32_t  ACCURACY_HIGH  = 3;
+		constexpr int32_t  STEP_LOW       = -200'000;
+		constexpr int32_t  STEP_HIGH      = 200'000;
+		constexpr int32_t  STEP_NOISE     = 1'000;
+
+		using beat_template = std::array<int32_t, TEMPLATE_SIZE>;
+
+		struct wave
+		{
+			float center;    // Phase in the beat
+			float amplitude; // Relative to the peak
+			float width;
+		};
+
+		beat_template make_template(std::initializer_list<wave> waves, float amplitude, float delay)
+		{
+			beat_template points{};
+			for(size_t point = 0; point < TEMPLATE_SIZE; point++)
+			{
+				const float phase = std::fmod(static_cast<float>(point) / TEMPLATE_SIZE + 1.f - delay, 1.f);
+				float value = 0.f;
+				for(wave const& current : waves)
+				{
+					const float distance = (phase - current.center) / current.width;
+					value += current.amplitude * std::exp(-0.5f * distance * distance);
+				}
+				points[point] = static_cast<int32_t>(value * amplitude);
+			}
+			return points;
+		}
+
+		beat_template const& ecg_template()
+		{
+			static const beat_template points = make_template({
+				{0.20f,  0.15f, 0.025f}, // P
+				{0.35f, -0.15f, 0.010f}, // Q
+				{0.375f, 1.00f, 0.012f}, // R
+				{0.40f, -0.25f, 0.010f}, // S
+				{0.65f,  0.30f, 0.040f}, // T
+			}, ECG_AMPLITUDE, 0.f);
+			return points;
+		}
+
+		beat_template const& ppg_template()
+		{
+			static const beat_template points = make_template({
+				{0.25f, 1.00f, 0.080f}, // Systolic peak
+				{0.55f, 0.35f, 0.070f}, // Dicrotic wave
+			}, 1.f * (1 << 16), PPG_DELAY);
+			return points;
+		}
+
+		/**
+		 * \brief Value of 'points' at sample 'index', interpolated between the template points.
+		 */
+		int32_t beat_value(beat_template const& points, uint32_t index, size_t sampleRate)
+		{
+			constexpr uint64_t STEPS = TEMPLATE_SIZE << FRACTION_BITS;
+			const uint64_t position  = static_cast<uint64_t>(index) * config::Synthetic::HEART_RATE_BPM * STEPS / (60ull * sampleRate) % STEPS;
+			const size_t   point     = position >> FRACTION_BITS;
+			const int64_t  fraction  = position & ((1u << FRACTION_BITS) - 1);
+			const int64_t  before    = points[point];
+			const int64_t  after     = points[(point + 1) % TEMPLATE_SIZE];
+			return static_cast<int32_t>(before + ((after - before) * fraction >> FRACTION_BITS));
+		}
+
+		void create_buffer(mem::RingBuffer& buffer, StaticSemaphore_t* mutexBuffer, void* nodes, size_t nodeSize, size_t nodeCount, size_t channelCount)
+		{
+			buffer = mem::RingBuffer(mutexBuffer,
+			                         nodes,
+			                         static_cast<mem::RingBuffer::size_type>(nodeSize),
+			                         static_cast<mem::RingBuffer::size_type>(nodeCount),
+			                         static_cast<mem::RingBuffer::channel_t>(channelCount));
+		}
+	}
+
+	SampleClock::SampleClock(size_t sampleRate)
+		: _epoch(0), _produced(0), _index(0), _sampleRate(sampleRate), _isRunning(false)
+	{
+	}
+
+	void SampleClock::SetSampleRate(size_t sampleRate)
+	{
+		_sampleRate = sampleRate;
+		_isRunning  = false;
+	}
+
+	size_t SampleClock::SampleRate() const
+	{
+		return _sampleRate;
+	}
+
+	uint32_t SampleClock::Due()
+	{
+		const int64_t now = esp_timer_get_time();
+		if(!_isRunning)
+		{
+			_epoch     = now;
+			_produced  = 0;
+			_isRunning = true;
+		}
+		const uint64_t elapsed = static_cast<uint64_t>(now - _epoch) * _sampleRate / 1'000'000 + 1;
+		const uint64_t due     = elapsed - std::min(elapsed, _produced);
+		if(due * 1'000'000 / _sampleRate > static_cast<uint64_t>(config::Synthetic::MAX_BACKLOG_US))
+		{
+			// The sensor was stopped: Continue from now on instead of delivering the whole pause at once.
+			_epoch    = now;
+			_produced = 0;
+			return 1;
+		}
+		return static_cast<uint32_t>(due);
+	}
+
+	uint32_t SampleClock::Next()
+	{
+		_produced++;
+		return _index++;
+	}
+
+	Noise::Noise(uint32_t seed)
+		: _state(seed)
+	{
+	}
+
+	int32_t Noise::Next(int32_t amplitude)
+	{
+		_state = _state * 1'664'525u + 1'013'904'223u;
+		return static_cast<int32_t>((_state >> 16) % (2 * amplitude + 1)) - amplitude;
+	}
+
+	/*
+	 * ADS1299
+	 */
+	SyntheticADS1299::SyntheticADS1299()
+		: _ecg{}, _noiseFrames{}, _clock(config::ADS1299::SAMPLE_RATE), _noise(config::Synthetic::NOISE_SEED), _noiseFramesLeft(0),
+		  _ecgBuffer{}, _noiseBuffer{}, _mutexBuffer{}
+	{
+	}
+
+	void SyntheticADS1299::Init()
+	{
+		create_buffer(_ecgBuffer, &_mutexBuffer[0], _ecg, sizeof(ecg_t), std::size(_ecg), config::ADS1299::CHANNEL_COUNT);
+		create_buffer(_noiseBuffer, &_mutexBuffer[1], _noiseFrames, sizeof(ecg_t), std::size(_noiseFrames), config::ADS1299::CHANNEL_COUNT);
+		DISCARD ecg_template();
+		PRINTI("[ADS1299:]", "Synthetic ECG at %u SPS.\n", static_cast<unsigned>(_clock.SampleRate()));
+	}
+
+	bool SyntheticADS1299::CaptureData()
+	{
+		// A call writes either samples or noise frames, so a false return means, that no real sample was written.
+		const bool isCapturingNoise = _noiseFramesLeft;
+		for(uint32_t due = _clock.Due(); due; --due)
+		{
+			const int32_t ecg = beat_value(ecg_template(), _clock.Next(), _clock.SampleRate());
+			if(isCapturingNoise)
+			{
+				auto& frame = *static_cast<ecg_t*>(_noiseBuffer.CurrentWrite());
+				std::ranges::for_each(frame.channels, [this](mem::int24_t& channel) { channel = mem::int24_t(_noise.Next(ECG_NOISE)); });
+				_noiseBuffer.WriteAdvance();
+				InsertPadding();
+				if(--_noiseFramesLeft == 0) break;
+				continue;
+			}
+			*static_cast<ecg_t*>(_ecgBuffer.CurrentWrite()) = ecg_t
+			{
+				.channels =
+				{
+					mem::int24_t(ecg + _noise.Next(ECG_NOISE)),
+					mem::int24_t(ecg * 3 / 5 + _noise.Next(ECG_NOISE)),
+					mem::int24_t(-ecg * 2 / 5 + _noise.Next(ECG_NOISE)),
+					mem::int24_t(_noise.Next(ECG_NOISE)),
+				},
+			};
+			_ecgBuffer.WriteAdvance();
+		}
+		return !isCapturingNoise;
+	}
+
+	uint32_t SyntheticADS1299::AvailableChannels() const
+	{
+		return config::ADS1299::CHANNEL_COUNT >= 32 ? ~0u : (1u << config::ADS1299::CHANNEL_COUNT) - 1;
+	}
+
+	uint32_t SyntheticADS1299::LeadOff() const
+	{
+		return 0;
+	}
+
+	uint32_t SyntheticADS1299::DecimationCycles() const
+	{
+		return 0;
+	}
+
+	bool SyntheticADS1299::StartNoiseCapture()
+	{
+		if(_noiseFramesLeft) return false;
+		_noiseBuffer.Reset();
+		_noiseFramesLeft = config::ADS1299::NOISE_CAPTURE_FRAMES;
+		return true;
+	}
+
+	bool SyntheticADS1299::IsCapturingNoise() const
+	{
+		return _noiseFramesLeft;
+	}
+
+	bool SyntheticADS1299::HasData()
+	{
+		return _clock.Due();
+	}
+
+	void SyntheticADS1299::InsertPadding()
+	{
+		*static_cast<ecg_t*>(_ecgBuffer.CurrentWrite()) = ecg_t{};
+		_ecgBuffer.PaddingAdvance();
+	}
+
+	bool SyntheticADS1299::SetSampleRate(size_t sampleRate)
+	{
+		_clock.SetSampleRate(sampleRate);
+		return true;
+	}
+
+	mem::RingBuffer* SyntheticADS1299::ECGRingBuffer()
+	{
+		return &_ecgBuffer;
+	}
+
+	mem::RingBuffer* SyntheticADS1299::NoiseRingBuffer()
+	{
+		return &_noiseBuffer;
+	}
+
+	/*
+	 * MAX30102
+	 */
+	SyntheticMAX30102::SyntheticMAX30102()
+		: _underlyingBuffer{}, _clock(config::MAX30102::SAMPLE_RATE), _noise(config::Synthetic::NOISE_SEED + 1), _buffer{}, _mutexBuffer{}
+	{
+	}
+
+	void SyntheticMAX30102::Init()
+	{
+		create_buffer(_buffer, &_mutexBuffer, _underlyingBuffer, sizeof(oxi_sample), std::size(_underlyingBuffer), config::MAX30102::CHANNEL_COUNT);
+		DISCARD ppg_template();
+		PRINTI("[MAX30102:]", "Synthetic PPG at %u SPS.\n", static_cast<unsigned>(_clock.SampleRate()));
+	}
+
+	uint32_t SyntheticMAX30102::ReadStatus()
+	{
+		return 0;
+	}
+
+	uint32_t SyntheticMAX30102::ReadData()
+	{
+		uint32_t samples = 0;
+		for(; _clock.Due(); samples++)
+		{
+			const int32_t pulse = beat_value(ppg_template(), _clock.Next(), _clock.SampleRate());
+			*static_cast<oxi_sample*>(_buffer.CurrentWrite()) = oxi_sample
+			{
+				// The blood of the pulse absorbs light: The counts fall.
+				.red      = mem::int24_t(PPG_RED_DC - (pulse * PPG_RED_AC >> 16) + _noise.Next(PPG_NOISE)),
+				.infraRed = mem::int24_t(PPG_IR_DC - (pulse * PPG_IR_AC >> 16) + _noise.Next(PPG_NOISE)),
+			};
+			_buffer.WriteAdvance();
+		}
+		return samples;
+	}
+
+	void SyntheticMAX30102::InsertPadding()
+	{
+		*static_cast<oxi_sample*>(_buffer.CurrentWrite()) = oxi_sample{};
+		_buffer.PaddingAdvance();
+	}
+
+	bool SyntheticMAX30102::SetSampleRate(size_t sampleRate)
+	{
+		_clock.SetSampleRate(sampleRate);
+		return true;
+	}
+
+	mem::RingBuffer* SyntheticMAX30102::RingBuffer()
+	{
+		return &_buffer;
+	}
+
+	/*
+	 * BHI160
+	 */
+	SyntheticBHI160::SyntheticBHI160()
+		: _acceleration{}, _clock(config::BHI160::SAMPLE_RATE), _noise(config::Synthetic::NOISE_SEED + 2), _buffer{}, _mutexBuffer{}
+	{
+	}
+
+	void SyntheticBHI160::Init()
+	{
+		create_buffer(_buffer, &_mutexBuffer, _acceleration, sizeof(acceleration_t), std::size(_acceleration), config::BHI160::CHANNEL_COUNT);
+		PRINTI("[BHI160:]", "Synthetic motion at %u SPS.\n", static_cast<unsigned>(_clock.SampleRate()));
+	}
+
+	bool SyntheticBHI160::HasData()
+	{
+		return _clock.Due();
+	}
+
+	void SyntheticBHI160::GetData()
+	{
+		const float time  = static_cast<float>(_clock.Next()) / _clock.SampleRate();
+		const float angle = 2.f * std::numbers::pi_v<float> * STEP_FREQUENCY * time;
+		*static_cast<acceleration_t*>(_buffer.CurrentWrite()) = acceleration_t
+		{
+			.X      = mem::int24_t(static_cast<int32_t>(ONE_G / 8 * std::sin(angle)) + _noise.Next(ACCEL_NOISE)),
+			.Y      = mem::int24_t(static_cast<int32_t>(ONE_G / 16 * std::sin(2.f * angle)) + _noise.Next(ACCEL_NOISE)),
+			.Z      = mem::int24_t(ONE_G + static_cast<int32_t>(ONE_G / 4 * std::cos(angle)) + _noise.Next(ACCEL_NOISE)),
+			.status = mem::int24_t(ACCURACY_HIGH),
+		};
+		_buffer.WriteAdvance();
+	}
+
+	uint16_t SyntheticBHI160::FIFOLevel() const
+	{
+		return 0;
+	}
+
+	void SyntheticBHI160::InsertPadding()
+	{
+		*static_cast<acceleration_t*>(_buffer.CurrentWrite()) = acceleration_t{};
+		_buffer.PaddingAdvance();
+	}
+
+	void SyntheticBHI160::SetSampleRate(uint16_t sampleRate)
+	{
+		_clock.SetSampleRate(sampleRate);
+	}
+
+	mem::RingBuffer* SyntheticBHI160::RingBuffer()
+	{
+		return &_buffer;
+	}
+
+	/*
+	 * MCP3561
+	 */
+	SyntheticMCP3561::SyntheticMCP3561()
+		: _output{}, _clock(config::MCP3561::SAMPLE_RATE), _noise(config::Synthetic::NOISE_SEED + 3), _buffer{}, _mutexBuffer{}
+	{
+	}
+
+	void SyntheticMCP3561::Init()
+	{
+		create_buffer(_buffer, &_mutexBuffer, _output, sizeof(mem::int24_t), std::size(_output), config::MCP3561::CHANNEL_COUNT);
+		PRINTI("[MCP3561:]", "Synthetic steps at %u SPS.\n", static_cast<unsigned>(_clock.SampleRate()));
+	}
+
+	void SyntheticMCP3561::CaptureData()
+	{
+		const uint64_t samplesPerStep = std::max<uint64_t>(1, static_cast<uint64_t>(_clock.SampleRate()) * config::Synthetic::STEP_PERIOD_MS / 1'000);
+		for(uint32_t due = _clock.Due(); due; --due)
+		{
+			const bool isHigh = _clock.Next() / samplesPerStep % 2;
+			*static_cast<mem::int24_t*>(_buffer.CurrentWrite()) = mem::int24_t((isHigh ? STEP_HIGH : STEP_LOW) + _noise.Next(STEP_NOISE));
+			_buffer.WriteAdvance();
+		}
+	}
+
+	bool SyntheticMCP3561::HasData()
+	{
+		return _clock.Due();
+	}
+
+	void SyntheticMCP3561::InsertPadding()
+	{
+		*static_cast<mem::int24_t*>(_buffer.CurrentWrite()) = mem::int24_t(static_cast<int32_t>(0));
+		_buffer.PaddingAdvance();
+	}
+
+	mem::RingBuffer* SyntheticMCP3561::RingBuffer()
+	{
+		return &_buffer;
+	}
+}
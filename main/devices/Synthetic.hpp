@@ -0,0 +1,173 @@
+#pragma once
+
+// std
+#include <cstdint>
+// internal
+#include "../config/devices.h"
+#include "../memory/ring_buffer.h"
+#include "../memory/int.h"
+// external
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+/**
+ * \brief Synthetic replacements of the sensor drivers. They share the interface of the drivers, which is used by the
+ * sensor control, and write through the same ring buffers. Samples are generated on demand: A read produces all samples
+ * which are due since the previous one, so the data ready lines may tick slower than the sample rate.
+ * Select them with USE_SYNTHETIC_SENSORS.
+ */
+namespace device
+{
+	/**
+	 * \brief Counts the samples, which are due at the configured sample rate since the clock started.
+	 */
+	class SampleClock
+	{
+	public:
+		explicit SampleClock(size_t sampleRate);
+
+		void     SetSampleRate(size_t sampleRate); // Restarts the clock
+		size_t   SampleRate() const;
+		uint32_t Due();  // Samples due now
+		uint32_t Next(); // Consumes one due sample and returns its index since Init, the phase of the waveform.
+
+	private:
+		int64_t  _epoch;
+		uint64_t _produced; // Samples since _epoch
+		uint32_t _index;
+		size_t   _sampleRate;
+		bool     _isRunning;
+	};
+
+	/**
+	 * \brief Deterministic white noise (linear congruential generator).
+	 */
+	class Noise
+	{
+	public:
+		explicit Noise(uint32_t seed);
+		int32_t Next(int32_t amplitude); // In [-amplitude, amplitude]
+
+	private:
+		uint32_t _state;
+	};
+
+	/**
+	 * \brief ECG template (P, QRS and T wave) on channels 1-3 in different leads and noise on channel 4. A noise capture
+	 * writes noise on all channels into the noise ring buffer. The electrodes never come off.
+	 */
+	class SyntheticADS1299
+	{
+	public:
+		SyntheticADS1299();
+
+		void             Init();
+		bool             CaptureData(); // Writes all due samples.
+		bool             HasData();
+		void             InsertPadding();
+		bool             SetSampleRate(size_t sampleRate);
+		uint32_t         AvailableChannels() const; // All
+		uint32_t         LeadOff() const;           // None
+		uint32_t         DecimationCycles() const;  // 0: The selected rate is generated directly.
+		bool             StartNoiseCapture();
+		bool             IsCapturingNoise() const;
+		mem::RingBuffer* ECGRingBuffer();
+		mem::RingBuffer* NoiseRingBuffer();
+
+	private:
+		struct ecg_t
+		{
+			mem::int24_t channels[config::ADS1299::CHANNEL_COUNT];
+		};
+
+		ecg_t             _ecg[config::ADS1299::ECG_SAMPLES_IN_RING_BUFFER];
+		ecg_t             _noiseFrames[config::ADS1299::NOISE_SAMPLES_IN_RING_BUFFER];
+		SampleClock       _clock;
+		Noise             _noise;
+		size_t            _noiseFramesLeft;
+		mem::RingBuffer   _ecgBuffer;
+		mem::RingBuffer   _noiseBuffer;
+		StaticSemaphore_t _mutexBuffer[2];
+	};
+
+	/**
+	 * \brief Photoplethysmogram with a systolic peak and a dicrotic notch. Red and infrared differ in DC and AC level.
+	 */
+	class SyntheticMAX30102
+	{
+	public:
+		SyntheticMAX30102();
+
+		void             Init();
+		uint32_t         ReadStatus(); // Never loses samples
+		uint32_t         ReadData();   // Writes all due samples.
+		void             InsertPadding();
+		bool             SetSampleRate(size_t sampleRate);
+		mem::RingBuffer* RingBuffer();
+
+	private:
+		struct oxi_sample
+		{
+			mem::int24_t red;
+			mem::int24_t infraRed;
+		};
+
+		oxi_sample        _underlyingBuffer[config::MAX30102::SAMPLES_IN_RING_BUFFER];
+		SampleClock       _clock;
+		Noise             _noise;
+		mem::RingBuffer   _buffer;
+		StaticSemaphore_t _mutexBuffer;
+	};
+
+	/**
+	 * \brief Accelerometer of a walking person: Periodic motion around 1 g on Z.
+	 */
+	class SyntheticBHI160
+	{
+	public:
+		SyntheticBHI160();
+
+		void             Init();
+		bool             HasData();
+		void             GetData(); // Writes one sample.
+		uint16_t         FIFOLevel() const; // Always 0, samples are generated on demand.
+		void             InsertPadding();
+		void             SetSampleRate(uint16_t sampleRate);
+		mem::RingBuffer* RingBuffer();
+
+	private:
+		struct acceleration_t
+		{
+			mem::int24_t X, Y, Z;
+			mem::int24_t status;
+		};
+
+		acceleration_t    _acceleration[config::BHI160::SAMPLES_IN_RING_BUFFER];
+		SampleClock       _clock;
+		Noise             _noise;
+		mem::RingBuffer   _buffer;
+		StaticSemaphore_t _mutexBuffer;
+	};
+
+	/**
+	 * \brief Step function with noise.
+	 */
+	class SyntheticMCP3561
+	{
+	public:
+		SyntheticMCP3561();
+
+		void             Init();
+		void             CaptureData(); // Writes all due samples.
+		bool             HasData();
+		void             InsertPadding();
+		mem::RingBuffer* RingBuffer();
+
+	private:
+		mem::int24_t      _output[32];
+		SampleClock       _clock;
+		Noise             _noise;
+		mem::RingBuffer   _buffer;
+		StaticSemaphore_t _mutexBuffer;
+	};
+}
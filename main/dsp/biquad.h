@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * \brief Fixed-point biquads. The coefficients are designed at compile time (RBJ audio EQ cookbook) and quantized to
+ * Q2.30, the filtering itself only uses integer arithmetic. So every build computes the same samples bit for bit.
+ */
+namespace dsp
+{
+	static constexpr int COEFFICIENT_FRACTION_BITS = 30; // Q2.30: Coefficients in [-2, 2)
+
+	namespace detail
+	{
+		constexpr double PI = 3.14159265358979323846;
+
+		/**
+		 * \brief sin(x) for the design of the coefficients. std::sin isn't usable at compile time.
+		 */
+		constexpr double sine(double x)
+		{
+			while(x > PI) x -= 2 * PI;
+			while(x < -PI) x += 2 * PI;
+			double term = x;
+			double sum  = x;
+			for(int n = 1; n < 20; n++)
+			{
+				term *= -x * x / ((2 * n) * (2 * n + 1));
+				sum  += term;
+			}
+			return sum;
+		}
+
+		constexpr double cosine(double x)
+		{
+			return sine(x + PI / 2);
+		}
+
+		constexpr int32_t to_q30(double value)
+		{
+			const double scaled = value * (1ll << COEFFICIENT_FRACTION_BITS);
+			return static_cast<int32_t>(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+		}
+	}
+
+	struct biquad_state
+	{
+		int32_t x1, x2; // Previous inputs
+		int32_t y1, y2; // Previous outputs
+		int32_t error;  // Fraction, which was cut off the previous output (error feedback)
+	};
+
+	/**
+	 * \brief Direct form I with a 64 bit accumulator. The rounding error of the output is fed back into the next
+	 * sample, so poles close to the unit circle (e.g. a high-pass far below the sample rate) don't drift.
+	 */
+	struct biquad
+	{
+		int32_t b0, b1, b2; // Q2.30
+		int32_t a1, a2;     // Q2.30, a0 is normalized to 1
+
+		constexpr int32_t Step(int32_t x, biquad_state& state) const
+		{
+			const int64_t accumulator = static_cast<int64_t>(b0) * x
+			                            + static_cast<int64_t>(b1) * state.x1
+			                            + static_cast<int64_t>(b2) * state.x2
+			                            - static_cast<int64_t>(a1) * state.y1
+			                            - static_cast<int64_t>(a2) * state.y2
+			                            + state.error;
+			const auto y = static_cast<int32_t>(accumulator >> COEFFICIENT_FRACTION_BITS);
+			state.error  = static_cast<int32_t>(accumulator - (static_cast<int64_t>(y) << COEFFICIENT_FRACTION_BITS));
+			state.x2     = state.x1;
+			state.x1     = x;
+			state.y2     = state.y1;
+			state.y1     = y;
+			return y;
+		}
+
+		/**
+		 * \brief Sets the state, as if 'x' had been applied forever, and returns the output. Avoids the step response
+		 * to the offset of the first sample.
+		 */
+		constexpr int32_t Prime(int32_t x, biquad_state& state) const
+		{
+			const int64_t dcNumerator   = static_cast<int64_t>(b0) + b1 + b2;
+			const int64_t dcDenominator = (int64_t{1} << COEFFICIENT_FRACTION_BITS) + a1 + a2;
+			const auto    y             = static_cast<int32_t>(dcNumerator * x / dcDenominator);
+			state = biquad_state{.x1 = x, .x2 = x, .y1 = y, .y2 = y, .error = 0};
+			return y;
+		}
+	};
+
+	enum class BiquadType : uint8_t
+	{
+		HighPass,
+		LowPass,
+		Notch,
+	};
+
+	/**
+	 * \brief Designs a section at 'frequency' (corner or center) for 'sampleRate'. Butterworth sections use Q = 1/sqrt(2).
+	 */
+	consteval biquad design_biquad(BiquadType type, double frequency, double sampleRate, double q)
+	{
+		const double w0     = 2 * detail::PI * frequency / sampleRate;
+		const double cosW0  = detail::cosine(w0);
+		const double alpha  = detail::sine(w0) / (2 * q);
+		const double a0     = 1 + alpha;
+		double       b[3]   = {};
+		switch(type)
+		{
+		case BiquadType::HighPass: b[0] = (1 + cosW0) / 2; b[1] = -(1 + cosW0); b[2] = b[0]; break;
+		case BiquadType::LowPass:  b[0] = (1 - cosW0) / 2; b[1] = 1 - cosW0;    b[2] = b[0]; break;
+		case BiquadType::Notch:    b[0] = 1;               b[1] = -2 * cosW0;   b[2] = 1;    break;
+		}
+		return biquad
+		{
+			.b0 = detail::to_q30(b[0] / a0),
+			.b1 = detail::to_q30(b[1] / a0),
+			.b2 = detail::to_q30(b[2] / a0),
+			.a1 = detail::to_q30(-2 * cosW0 / a0),
+			.a2 = detail::to_q30((1 - alpha) / a0),
+		};
+	}
+}
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "../memory/int.h"
+#include "biquad.h"
+
+/**
+ * \brief Decimation of an oversampled stream by an integer ratio. The anti-aliasing filter is a Kaiser windowed sinc,
+ * which is designed at compile time from the ratio and quantized to Q2.30 with a DC gain of exactly one.
+ */
+namespace dsp
+{
+	namespace detail
+	{
+		constexpr double  KAISER_BETA = 5.65; // ~60 dB stopband attenuation
+		constexpr int64_t SAMPLE_MIN  = -(int64_t{1} << 23);
+		constexpr int64_t SAMPLE_MAX  = (int64_t{1} << 23) - 1;
+
+		constexpr double square_root(double x)
+		{
+			if(x <= 0) return 0;
+			double root = x > 1 ? x : 1;
+			for(int n = 0; n < 64; n++) root = (root + x / root) / 2;
+			return root;
+		}
+
+		/**
+		 * \brief Modified Bessel function of the first kind, order 0 (power series).
+		 */
+		constexpr double bessel_i0(double x)
+		{
+			double term = 1;
+			double sum  = 1;
+			for(int k = 1; k < 40; k++)
+			{
+				term *= (x / (2 * k)) * (x / (2 * k));
+				sum  += term;
+			}
+			return sum;
+		}
+
+		/**
+		 * \brief Low-pass at half the output rate, Ratio * TapsPerPhase taps. The quantization remainder goes into the
+		 * center tap, so the taps sum up to exactly 2^30.
+		 */
+		template<size_t Ratio, size_t TapsPerPhase>
+		consteval std::array<int32_t, Ratio * TapsPerPhase> design_decimation_filter()
+		{
+			constexpr size_t TAPS   = Ratio * TapsPerPhase;
+			constexpr double CENTER = (TAPS - 1) / 2.0;
+
+			std::array<int32_t, TAPS> taps{};
+			int64_t                   sum = 0;
+			for(size_t tap = 0; tap < TAPS; tap++)
+			{
+				const double x      = (tap - CENTER) / Ratio;
+				const double sinc   = x == 0 ? 1 : sine(PI * x) / (PI * x);
+				const double window = (tap - CENTER) / CENTER;
+				const double kaiser = bessel_i0(KAISER_BETA * square_root(1 - window * window)) / bessel_i0(KAISER_BETA);
+				taps[tap] = to_q30(sinc * kaiser / Ratio);
+				sum      += taps[tap];
+			}
+			// The window shrinks the DC gain by a fraction of a percent: Normalize before the correction of the remainder.
+			for(int32_t& tap : taps) tap = static_cast<int32_t>(static_cast<int64_t>(tap) * (int64_t{1} << COEFFICIENT_FRACTION_BITS) / sum);
+			sum = 0;
+			for(int32_t tap : taps) sum += tap;
+			taps[TAPS / 2] += static_cast<int32_t>((int64_t{1} << COEFFICIENT_FRACTION_BITS) - sum);
+			return taps;
+		}
+	}
+
+	/**
+	 * \brief Polyphase FIR decimator in transposed form: Every input is multiplied into the TapsPerPhase outputs, which
+	 * it contributes to, so there is no input history. The state per channel is TapsPerPhase accumulators, independent
+	 * of the ratio, and every input costs TapsPerPhase multiply-accumulates per channel.
+	 *
+	 * The passband is alias free up to about (0.5 - 1.8 / TapsPerPhase) of the output rate. The group delay is
+	 * (Ratio * TapsPerPhase - 1) / 2 input samples.
+	 */
+	template<size_t Ratio, size_t TapsPerPhase, size_t Channels>
+	class Decimator
+	{
+		static_assert(Ratio >= 2 && (Ratio & (Ratio - 1)) == 0, "The ratio must be a power of 2.");
+		static_assert(TapsPerPhase >= 2);
+
+	public:
+		static constexpr size_t RATIO          = Ratio;
+		static constexpr size_t TAPS_PER_PHASE = TapsPerPhase;
+
+		constexpr Decimator()
+			: _accumulators{}, _phase(0), _head(0), _isPrimed(false)
+		{
+		}
+
+		constexpr void Reset() // The next input primes the filter.
+		{
+			_phase    = 0;
+			_head     = 0;
+			_isPrimed = false;
+		}
+
+		/**
+		 * \brief Feeds one input frame. Returns true and writes 'output', when an output frame is complete (every Ratio
+		 * inputs). Saturates at the 24 bit range.
+		 */
+		bool Push(mem::int24_t const* input, mem::int24_t* output)
+		{
+			const size_t offset = (Ratio - _phase) % Ratio; // Distance to the next output
+			if(!_isPrimed) Prime(input, offset);
+
+			int32_t const* coefficients = &PHASES[offset][0];
+			for(size_t channel = 0; channel < Channels; channel++)
+			{
+				const int64_t x     = static_cast<int32_t>(input[channel]);
+				int64_t*      slots = _accumulators[channel];
+				for(size_t j = 0; j < TapsPerPhase; j++)
+				{
+					slots[(_head + j) % TapsPerPhase] += coefficients[j] * x;
+				}
+			}
+
+			_phase = (_phase + 1) % Ratio;
+			if(offset != 0) return false;
+
+			constexpr int64_t HALF = int64_t{1} << (COEFFICIENT_FRACTION_BITS - 1);
+			for(size_t channel = 0; channel < Channels; channel++)
+			{
+				int64_t& slot   = _accumulators[channel][_head];
+				output[channel] = static_cast<int32_t>(std::clamp<int64_t>((slot + HALF) >> COEFFICIENT_FRACTION_BITS, detail::SAMPLE_MIN, detail::SAMPLE_MAX));
+				slot            = 0;
+			}
+			_head = (_head + 1) % TapsPerPhase;
+			return true;
+		}
+
+	private:
+		/**
+		 * \brief Coefficients by distance to the next output: PHASES[offset][j] = h[offset + j * Ratio].
+		 */
+		static constexpr auto PHASES = []
+		{
+			constexpr auto taps = detail::design_decimation_filter<Ratio, TapsPerPhase>();
+			std::array<std::array<int32_t, TapsPerPhase>, Ratio> phases{};
+			for(size_t offset = 0; offset < Ratio; offset++)
+			{
+				for(size_t j = 0; j < TapsPerPhase; j++) phases[offset][j] = taps[offset + j * Ratio];
+			}
+			return phases;
+		}();
+
+		/**
+		 * \brief Fills the accumulators, as if 'input' had been applied forever. Avoids the step response to the offset
+		 * of the first frame.
+		 */
+		void Prime(mem::int24_t const* input, size_t offset)
+		{
+			// Pending output j already holds the contributions of all earlier inputs: The taps past offset + j * Ratio.
+			std::array<int64_t, TapsPerPhase> remaining{};
+			for(size_t j = 0; j < TapsPerPhase; j++)
+			{
+				for(size_t k = offset + j * Ratio + 1; k < Ratio * TapsPerPhase; k++)
+				{
+					remaining[j] += PHASES[k % Ratio][k / Ratio];
+				}
+			}
+			for(size_t channel = 0; channel < Channels; channel++)
+			{
+				const int64_t x = static_cast<int32_t>(input[channel]);
+				for(size_t j = 0; j < TapsPerPhase; j++)
+				{
+					_accumulators[channel][(_head + j) % TapsPerPhase] = remaining[j] * x;
+				}
+			}
+			_isPrimed = true;
+		}
+
+		int64_t _accumulators[Channels][TapsPerPhase]; // Partial sums of the next TapsPerPhase outputs, from _head on
+		size_t  _phase;                                // Inputs since the last output
+		size_t  _head;
+		bool    _isPrimed;
+	};
+
+	/**
+	 * \brief Ratio 1 passes the frames through.
+	 */
+	template<size_t TapsPerPhase, size_t Channels>
+	class Decimator<1, TapsPerPhase, Channels>
+	{
+	public:
+		static constexpr size_t RATIO          = 1;
+		static constexpr size_t TAPS_PER_PHASE = 0;
+
+		constexpr void Reset()
+		{
+		}
+
+		bool Push(mem::int24_t const* input, mem::int24_t* output)
+		{
+			std::copy_n(input, Channels, output);
+			return true;
+		}
+	};
+
+	/**
+	 * \brief Measures the cost of one output sample per channel for the ratios 2 to 64. 'now' returns a monotonic tick
+	 * count (CPU cycles on the device, nanoseconds on the host), 'report' receives the ratio and the ticks.
+	 */
+	template<size_t TapsPerPhase, size_t Channels, typename Clock, typename Report>
+	void benchmark_decimators(Clock now, Report report)
+	{
+		constexpr size_t OUTPUTS = 256;
+		constexpr size_t FRAMES  = 64;
+
+		// Full scale noise, generated before the measurement.
+		static mem::int24_t frames[FRAMES][Channels];
+		uint32_t random = 0x2545'F491u;
+		for(auto& frame : frames)
+		{
+			for(mem::int24_t& channel : frame)
+			{
+				random  = random * 1'664'525u + 1'013'904'223u;
+				channel = static_cast<int32_t>(random) >> 8;
+			}
+		}
+
+		auto measure = [&]<size_t Ratio>()
+		{
+			static Decimator<Ratio, TapsPerPhase, Channels> decimator;
+			mem::int24_t     output[Channels]{};
+			volatile int32_t sink = 0;
+
+			decimator.Reset();
+			const auto start = now();
+			for(size_t sample = 0; sample < OUTPUTS * Ratio; sample++)
+			{
+				if(decimator.Push(frames[sample % FRAMES], output)) sink = sink + static_cast<int32_t>(output[0]);
+			}
+			const auto ticks = now() - start;
+			report(Ratio, static_cast<double>(ticks) / (OUTPUTS * Channels));
+		};
+
+		[&]<size_t... Exponent>(std::index_sequence<Exponent...>)
+		{
+			(measure.template operator()<size_t{2} << Exponent>(), ...);
+		}(std::make_index_sequence<6>{});
+	}
+}
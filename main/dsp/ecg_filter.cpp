@@ -0,0 +1,136 @@
+#include "ecg_filter.h"
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+
+#define ECG_FILTER_TAG "[ECG Filter:]"
+
+namespace dsp
+{
+	namespace
+	{
+		using cascade = ECGFilter::cascade;
+		using Stages  = config::ECGFilter;
+
+		constexpr double BUTTERWORTH_Q = 0.70710678118654752;
+
+		consteval cascade design_cascade(size_t sampleRate)
+		{
+			cascade result{.sampleRate = sampleRate, .sectionCount = 0, .sections = {}};
+			if(Stages::HIGH_PASS_HZ > 0.f)
+			{
+				result.sections[result.sectionCount++] = design_biquad(BiquadType::HighPass, Stages::HIGH_PASS_HZ, sampleRate, BUTTERWORTH_Q);
+			}
+			if(Stages::NOTCH_HZ > 0.f)
+			{
+				result.sections[result.sectionCount++] = design_biquad(BiquadType::Notch, Stages::NOTCH_HZ, sampleRate, Stages::NOTCH_Q);
+			}
+			if(Stages::LOW_PASS_HZ > 0.f)
+			{
+				result.sections[result.sectionCount++] = design_biquad(BiquadType::LowPass, Stages::LOW_PASS_HZ, sampleRate, BUTTERWORTH_Q);
+			}
+			return result;
+		}
+
+		consteval auto design_cascades()
+		{
+			std::array<cascade, std::size(config::SampleRates::ADS1299_SELECTABLE)> cascades{};
+			for(size_t rate = 0; rate < cascades.size(); rate++)
+			{
+				cascades[rate] = design_cascade(config::SampleRates::ADS1299_SELECTABLE[rate]);
+			}
+			return cascades;
+		}
+
+		constexpr auto CASCADES = design_cascades();
+
+		constexpr int32_t filter(cascade const& filters, biquad_state* states, int32_t value, bool isPrimed)
+		{
+			for(size_t section = 0; section < filters.sectionCount; section++)
+			{
+				value = isPrimed ? filters.sections[section].Step(value, states[section]) : filters.sections[section].Prime(value, states[section]);
+			}
+			return std::clamp<int32_t>(value, INT24_MIN, INT24_MAX);
+		}
+
+		/**
+		 * \brief FNV-1a of the outputs of every cascade for a test signal: Alternating blocks of full scale noise, full
+		 * scale steps and silence, starting on an offset.
+		 */
+		constexpr uint32_t checksum(uint32_t seed)
+		{
+			constexpr size_t TEST_SAMPLES = 1'536;
+			constexpr size_t BLOCK        = 256;
+
+			uint32_t hash = 2'166'136'261u;
+			for(cascade const& filters : CASCADES)
+			{
+				biquad_state states[ECGFilter::MAX_SECTIONS]{};
+				uint32_t     random = seed;
+				for(size_t sample = 0; sample < TEST_SAMPLES; sample++)
+				{
+					random = random * 1'664'525u + 1'013'904'223u;
+					int32_t input = 0;
+					switch(sample / BLOCK % 3)
+					{
+					case 0: input = static_cast<int32_t>(random) >> 8; break;
+					case 1: input = sample & (BLOCK / 2) ? INT24_MAX : INT24_MIN; break;
+					case 2: input = 0; break;
+					}
+					const int32_t output = filter(filters, states, sample == 0 ? 1'000'000 : input, sample != 0);
+					hash = (hash ^ static_cast<uint32_t>(output)) * 16'777'619u;
+				}
+			}
+			return hash;
+		}
+
+		constexpr uint32_t TEST_SEED          = 0x2545'F491u;
+		constexpr uint32_t REFERENCE_CHECKSUM = checksum(TEST_SEED); // Computed by the compiler on the build host
+	}
+
+	ECGFilter::ECGFilter()
+		: _cascade(&CASCADES[0]), _states{}, _isPrimed(false)
+	{
+		DISCARD SetSampleRate(config::ADS1299::SAMPLE_RATE);
+	}
+
+	bool ECGFilter::SetSampleRate(size_t sampleRate)
+	{
+		const auto match = std::ranges::find(CASCADES, sampleRate, &cascade::sampleRate);
+		if(match == CASCADES.end()) return false;
+
+		_cascade = &*match;
+		Reset();
+		return true;
+	}
+
+	void ECGFilter::Reset()
+	{
+		_isPrimed = false;
+	}
+
+	void ECGFilter::Process(mem::int24_t* channels, uint32_t channelMask)
+	{
+		for(size_t channel = 0; channel < config::ADS1299::CHANNEL_COUNT; channel++)
+		{
+			if(!(channelMask & (1u << channel))) continue;
+			channels[channel] = filter(*_cascade, _states[channel], static_cast<int32_t>(channels[channel]), _isPrimed);
+		}
+		_isPrimed = true;
+	}
+
+	bool ECGFilter::SelfTest()
+	{
+		// Read through a volatile, so the optimizer can't fold the device computation into the reference.
+		volatile uint32_t seed   = TEST_SEED;
+		const uint32_t    result = checksum(seed);
+		if(result != REFERENCE_CHECKSUM)
+		{
+			PRINTI(ECG_FILTER_TAG, "Self-test failed: Checksum 0x%08lX instead of 0x%08lX.\n", static_cast<unsigned long>(result), static_cast<unsigned long>(REFERENCE_CHECKSUM));
+			return false;
+		}
+		PRINTI(ECG_FILTER_TAG, "Self-test passed: Bit exact with the compiler (0x%08lX).\n", static_cast<unsigned long>(result));
+		return true;
+	}
+}
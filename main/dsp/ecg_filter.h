@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+#include "../config/devices.h"
+#include "../memory/int.h"
+#include "../util/defines.h"
+#include "biquad.h"
+
+namespace dsp
+{
+	/**
+	 * \brief Filters the ADS1299 channels with the stages of config::ECGFilter (high-pass, notch, low-pass), one cascade
+	 * of fixed-point biquads per channel. The coefficients of every selectable sample rate are designed at compile time,
+	 * so a rate change only selects another cascade.
+	 *
+	 * SelfTest() proves, that the device computes the same samples as the compiler: Both run a test signal through all
+	 * cascades and compare the checksums of the outputs.
+	 */
+	class ECGFilter
+	{
+	public:
+		static constexpr size_t MAX_SECTIONS = 3;
+
+		struct cascade
+		{
+			size_t sampleRate;
+			size_t sectionCount;
+			biquad sections[MAX_SECTIONS];
+		};
+
+		ECGFilter();
+
+		bool SetSampleRate(size_t sampleRate); // Also resets the filters. Returns false if the rate isn't selectable.
+		void Reset(); // The next sample primes the filters.
+		/**
+		 * \brief Filters one sample of the channels in 'channelMask' in place. Saturates at the 24 bit range.
+		 */
+		void Process(mem::int24_t* channels, uint32_t channelMask);
+
+		NODISCARD static bool SelfTest();
+
+	private:
+		cascade const* _cascade;
+		biquad_state   _states[config::ADS1299::CHANNEL_COUNT][MAX_SECTIONS];
+		bool           _isPrimed;
+	};
+}
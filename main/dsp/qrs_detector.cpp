@@ -0,0 +1,244 @@
+#include "qrs_detector.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace dsp
+{
+	namespace
+	{
+		constexpr size_t   RATE         = QRSDetector::DETECTION_RATE;
+		constexpr uint32_t LEARNING     = 2 * RATE;           // Initial signal and noise levels
+		constexpr uint32_t REFRACTORY   = 200 * RATE / 1'000; // No beat follows another one within
+		constexpr uint32_t T_WAVE       = 360 * RATE / 1'000; // A flat peak within this is a T wave
+		constexpr uint32_t RELEARN      = 5 * RATE;           // Without a beat, the levels are learned again.
+		constexpr uint32_t FILTER_DELAY = 5;                  // Of the band-pass around 10 Hz, in detection samples
+
+		constexpr double BUTTERWORTH_Q = 0.70710678118654752;
+
+		constexpr biquad BAND_PASS[] =
+		{
+			design_biquad(BiquadType::HighPass, 5., RATE, BUTTERWORTH_Q),
+			design_biquad(BiquadType::LowPass, 15., RATE, BUTTERWORTH_Q),
+		};
+	}
+
+	QRSDetector::QRSDetector()
+		: _factor(1), _sum(0), _count(0), _last(0), _samples(0), _index(0), _isPrimed(false), _bandPass{}, _inputs{}, _filtered{}, _squares{},
+		  _integral(0), _previous(0), _isFalling(false), _slope(0), _rising{}, _candidate{}, _signalLevel(0), _noiseLevel(0),
+		  _learningEnd(0), _learningMaximum(0), _learningSum(0), _lastBeat(0), _lastSlope(0), _hasBeat(false), _intervals{},
+		  _intervalCount(0)
+	{
+		Reset();
+	}
+
+	bool QRSDetector::SetSampleRate(size_t sampleRate)
+	{
+		if(sampleRate < DETECTION_RATE || sampleRate % DETECTION_RATE) return false;
+
+		_factor = static_cast<uint32_t>(sampleRate / DETECTION_RATE);
+		Reset();
+		return true;
+	}
+
+	void QRSDetector::Reset()
+	{
+		_sum       = 0;
+		_count     = 0;
+		_samples   = 0;
+		_index     = 0;
+		_isPrimed  = false;
+		_integral  = 0;
+		_previous  = 0;
+		_isFalling = false;
+		_slope     = 0;
+		_rising    = peak{};
+		std::ranges::fill(_inputs, 0);
+		std::ranges::fill(_filtered, 0);
+		std::ranges::fill(_squares, 0);
+		Learn(0);
+	}
+
+	bool QRSDetector::Process(int32_t sample, beat& detected)
+	{
+		_last = sample;
+		_samples++;
+		_sum += sample;
+		if(++_count < _factor) return false;
+
+		const auto average = static_cast<int32_t>(_sum / _factor);
+		_inputs[_index % HISTORY] = average;
+		_sum   = 0;
+		_count = 0;
+
+		int32_t filtered = average;
+		for(size_t section = 0; section < std::size(BAND_PASS); section++)
+		{
+			filtered = _isPrimed ? BAND_PASS[section].Step(filtered, _bandPass[section]) : BAND_PASS[section].Prime(filtered, _bandPass[section]);
+		}
+		_isPrimed = true;
+		return Detect(filtered, detected);
+	}
+
+	bool QRSDetector::Conceal(beat& detected)
+	{
+		return Process(_last, detected);
+	}
+
+	uint32_t QRSDetector::Samples() const
+	{
+		return _samples;
+	}
+
+	bool QRSDetector::Detect(int32_t filtered, beat& detected)
+	{
+		const uint32_t index = _index++;
+		_filtered[index % HISTORY] = filtered;
+
+		// Five point derivative, squared and integrated. The integral is kept as a sum, the window is constant.
+		auto past = [this, index](uint32_t age) { return static_cast<int64_t>(_filtered[(index - age) % HISTORY]); };
+		const int64_t derivative = (2 * past(0) + past(1) - past(3) - 2 * past(4)) / 8;
+		const int64_t square     = derivative * derivative;
+		_integral += square - _squares[index % WINDOW];
+		_squares[index % WINDOW] = square;
+		_slope = std::max(_slope, static_cast<int32_t>(derivative < 0 ? -derivative : derivative));
+
+		const int64_t integral = _integral;
+		const int64_t previous = _previous;
+		_previous = integral;
+		if(index < _learningEnd)
+		{
+			_learningMaximum = std::max(_learningMaximum, integral);
+			_learningSum    += integral;
+			if(index + 1 == _learningEnd)
+			{
+				_signalLevel = _learningMaximum / 3;
+				_noiseLevel  = _learningSum / LEARNING / 2;
+				_lastBeat    = index;
+			}
+			return false;
+		}
+
+		// A peak is the maximum of a rise, once the integral fell to half of it. The next rise starts at the minimum.
+		bool isBeat = false;
+		if(_isFalling)
+		{
+			_isFalling = integral < previous;
+			_slope     = 0;
+		}
+		else if(integral > _rising.value)
+		{
+			_rising = peak{.value = integral, .index = index, .slope = _slope};
+		}
+		else if(integral < _rising.value / 2)
+		{
+			peak found  = _rising;
+			found.index = LocateR(found.index);
+			_rising     = peak{};
+			_isFalling  = true;
+			_slope      = 0;
+			isBeat      = Classify(found, detected);
+		}
+		if(!isBeat) isBeat = SearchBack(detected);
+
+		if(!isBeat && index - _lastBeat > RELEARN)
+		{
+			Learn(index + 1);
+		}
+		return isBeat;
+	}
+
+	bool QRSDetector::Classify(peak const& candidate, beat& detected)
+	{
+		const bool isRefractory = _hasBeat && candidate.index - _lastBeat < REFRACTORY;
+		const bool isTWave      = _hasBeat && candidate.index - _lastBeat < T_WAVE && candidate.slope < _lastSlope / 2;
+		if(candidate.value > Threshold() && !isRefractory && !isTWave)
+		{
+			Accept(candidate, 1, detected);
+			return true;
+		}
+		_noiseLevel += (candidate.value - _noiseLevel) / 8;
+		if(_hasBeat && !isRefractory && !isTWave && candidate.value > _candidate.value)
+		{
+			_candidate = candidate;
+		}
+		return false;
+	}
+
+	bool QRSDetector::SearchBack(beat& detected)
+	{
+		if(!_intervalCount || !_candidate.value) return false;
+
+		uint32_t sum = 0;
+		for(size_t interval = 0; interval < std::min<size_t>(_intervalCount, INTERVALS); interval++) sum += _intervals[interval];
+		const uint32_t average = sum / std::min<uint32_t>(_intervalCount, INTERVALS);
+		if((_index - 1 - _lastBeat) * 100 < average * 166 || _candidate.value <= Threshold() / 2) return false;
+
+		// A beat below the threshold: The signal level follows it faster.
+		Accept(_candidate, 2, detected);
+		return true;
+	}
+
+	void QRSDetector::Accept(peak const& candidate, int64_t weight, beat& detected)
+	{
+		_signalLevel += (candidate.value - _signalLevel) * weight / 8;
+
+		const uint32_t interval = _hasBeat ? candidate.index - _lastBeat : 0;
+		if(_hasBeat)
+		{
+			_intervals[_intervalCount++ % INTERVALS] = interval;
+		}
+		_lastBeat  = candidate.index;
+		_lastSlope = candidate.slope;
+		_hasBeat   = true;
+		_candidate = peak{};
+
+		// A detection sample averages _factor input samples, its center is the R peak.
+		detected = beat{.sample = candidate.index * _factor + (_factor - 1) / 2, .interval = interval * _factor};
+	}
+
+	uint32_t QRSDetector::LocateR(uint32_t peakIndex) const
+	{
+		// The integral peaks at the end of the QRS complex, delayed by the band-pass. The R peak is the input sample,
+		// which deviates most from the straight line between the ends of the window. So the baseline doesn't shift it
+		// and the shape of the complex doesn't either. Only samples still in the history are searched.
+		const uint32_t last  = peakIndex > FILTER_DELAY ? peakIndex - FILTER_DELAY : 0;
+		const uint32_t first = std::max<uint32_t>({last > WINDOW ? last - static_cast<uint32_t>(WINDOW) : 0u, _index > HISTORY ? _index - static_cast<uint32_t>(HISTORY) : 0u, _learningEnd});
+		if(first >= last) return last;
+
+		const int64_t start  = _inputs[first % HISTORY];
+		const int64_t end    = _inputs[last % HISTORY];
+		const int64_t length = last - first;
+		uint32_t      location  = last;
+		int64_t       deviation = -1;
+		for(uint32_t index = first; index <= last; index++)
+		{
+			const int64_t baseline = start + (end - start) * (index - first) / length;
+			int64_t       distance = _inputs[index % HISTORY] - baseline;
+			distance = distance < 0 ? -distance : distance;
+			if(distance > deviation)
+			{
+				deviation = distance;
+				location  = index;
+			}
+		}
+		return location;
+	}
+
+	void QRSDetector::Learn(uint32_t start)
+	{
+		_learningEnd     = start + LEARNING;
+		_learningMaximum = 0;
+		_learningSum     = 0;
+		_signalLevel     = 0;
+		_noiseLevel      = 0;
+		_candidate       = peak{};
+		_hasBeat         = false;
+		_intervalCount   = 0;
+	}
+
+	int64_t QRSDetector::Threshold() const
+	{
+		return _noiseLevel + (_signalLevel - _noiseLevel) / 4;
+	}
+}
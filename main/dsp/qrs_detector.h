@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../util/defines.h"
+#include "biquad.h"
+
+namespace dsp
+{
+	/**
+	 * \brief Streaming QRS detector after Pan and Tompkins (1985) in fixed point: Band-pass (5-15 Hz), five point
+	 * derivative, squaring and integration over a moving window of 150 ms. The peaks of the integrated signal are
+	 * classified with adaptive signal and noise levels, a refractory period, a T wave check of the slope and a search
+	 * back for beats below the threshold.
+	 *
+	 * The input is averaged down to DETECTION_RATE first. So every rate shares the same filters and states, and a
+	 * sample above the detection rate costs one addition. A beat is reported, once it is certain: About 0.2 s after
+	 * its R peak, or up to 1.66 RR intervals later if the search back finds it.
+	 */
+	class QRSDetector
+	{
+	public:
+		static constexpr size_t DETECTION_RATE = 250; // in SPS. Input rates have to be a multiple.
+
+		struct beat
+		{
+			uint32_t sample;   // Input sample of the R peak, counted from Reset
+			uint32_t interval; // Input samples since the previous beat. 0 for the first beat after Reset.
+		};
+
+		QRSDetector();
+
+		bool SetSampleRate(size_t sampleRate); // Also resets. Returns false if the rate isn't a multiple of DETECTION_RATE.
+		void Reset(); // Restarts the learning phase.
+		/**
+		 * \brief Feeds one input sample. Returns true and writes 'detected', if a beat was found.
+		 */
+		bool Process(int32_t sample, OUT beat& detected);
+		bool Conceal(OUT beat& detected); // Feeds the previous sample again, e.g. instead of padding.
+		uint32_t Samples() const; // Fed since Reset
+
+	private:
+		static constexpr size_t WINDOW    = (150 * DETECTION_RATE + 500) / 1'000; // Moving window integration
+		static constexpr size_t HISTORY   = 128;                                  // Detection samples kept to locate the R peak
+		static constexpr size_t INTERVALS = 8;                                    // RR intervals in the average
+		static_assert((HISTORY & (HISTORY - 1)) == 0);
+
+		struct peak
+		{
+			int64_t  value;  // Of the integrated signal
+			uint32_t index;  // Detection sample of the R peak
+			int32_t  slope;  // Steepest derivative on its rising edge
+		};
+
+		bool Detect(int32_t filtered, OUT beat& detected); // One sample at DETECTION_RATE
+		bool Classify(peak const& candidate, OUT beat& detected);
+		bool SearchBack(OUT beat& detected);
+		void Accept(peak const& candidate, int64_t weight, OUT beat& detected); // weight: Of the new peak in the signal level, in 1/8
+		uint32_t LocateR(uint32_t peakIndex) const; // Detection sample of the R peak before a peak of the integral
+		void     Learn(uint32_t start);              // Levels from the first LEARNING samples after 'start'
+		int64_t  Threshold() const;
+
+		uint32_t     _factor;  // Input samples per detection sample
+		int64_t      _sum;     // Of the current detection sample
+		uint32_t     _count;
+		int32_t      _last;    // Previous input sample
+		uint32_t     _samples; // Input samples since Reset
+		uint32_t     _index;   // Detection samples since Reset
+		bool         _isPrimed;
+		biquad_state _bandPass[2];
+		int32_t      _inputs[HISTORY];     // Averaged input, by detection sample
+		int32_t      _filtered[HISTORY];   // Band-passed
+		int64_t      _squares[WINDOW];     // Squared derivatives in the window
+		int64_t      _integral;            // Sum of _squares
+		int64_t      _previous;            // Integrated signal of the previous detection sample
+		bool         _isFalling;           // After a peak, until the integrated signal rises again
+		int32_t      _slope;               // Steepest derivative since the last peak
+		peak         _rising;              // Maximum of the integrated signal since the last peak
+		peak         _candidate;           // Largest noise peak since the last beat, for the search back
+		int64_t      _signalLevel;
+		int64_t      _noiseLevel;
+		uint32_t     _learningEnd;         // Detection sample, from which on peaks are classified
+		int64_t      _learningMaximum;
+		int64_t      _learningSum;
+		uint32_t     _lastBeat;            // Detection sample of the previous R peak
+		int32_t      _lastSlope;           // Of the previous beat
+		bool         _hasBeat;
+		uint32_t     _intervals[INTERVALS]; // Last RR intervals in detection samples
+		uint32_t     _intervalCount;
+	};
+}
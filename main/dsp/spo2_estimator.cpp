@@ -0,0 +1,183 @@
+#include "spo2_estimator.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace dsp
+{
+	namespace
+	{
+		constexpr size_t   RATE         = SpO2Estimator::ESTIMATION_RATE;
+		constexpr uint32_t REFRACTORY   = RATE / 4;     // 240 bpm
+		constexpr uint32_t LONGEST_BEAT = RATE * 5 / 2; // 24 bpm. A longer beat restarts the learning.
+		constexpr int64_t  MIN_DC       = 1 << 12;      // Counts. Less light means no finger on the sensor.
+		constexpr int32_t  Q16          = 1 << 16;
+
+		constexpr double BUTTERWORTH_Q   = 0.70710678118654752;
+		constexpr double BUTTERWORTH_Q4[] = {0.54119610014619698, 1.30656296487637653}; // Sections of the 4th order
+
+		// The 4th order high-pass suppresses the respiratory baseline (0.2-0.4 Hz), which would shift the zero crossings.
+		constexpr biquad BAND_PASS[] =
+		{
+			design_biquad(BiquadType::HighPass, .5, RATE, BUTTERWORTH_Q4[0]),
+			design_biquad(BiquadType::HighPass, .5, RATE, BUTTERWORTH_Q4[1]),
+			design_biquad(BiquadType::LowPass, 5., RATE, BUTTERWORTH_Q),
+		};
+		static_assert(std::size(BAND_PASS) == SpO2Estimator::BAND_PASS_SECTIONS);
+
+		constexpr int32_t to_q16(double value)
+		{
+			return static_cast<int32_t>(value * Q16 + (value < 0 ? -.5 : .5));
+		}
+	}
+
+	SpO2Estimator::SpO2Estimator(calibration const& curve)
+		: _a(to_q16(curve.a)), _b(to_q16(curve.b)), _c(to_q16(curve.c)), _factor(1), _sums{}, _count(0), _last{}, _samples(0), _index(0),
+		  _isPrimed(false), _dc{}, _bandPass{}, _ac{}, _maximum{}, _minimum{}, _amplitude(0), _isBelow(false), _hasStart(false),
+		  _beatStart(0), _ratios{}, _periods{}, _beatCount(0)
+	{
+	}
+
+	bool SpO2Estimator::SetSampleRate(size_t sampleRate)
+	{
+		if(sampleRate < ESTIMATION_RATE || sampleRate % ESTIMATION_RATE) return false;
+
+		_factor = static_cast<uint32_t>(sampleRate / ESTIMATION_RATE);
+		Reset();
+		return true;
+	}
+
+	void SpO2Estimator::Reset()
+	{
+		std::ranges::fill(_sums, 0);
+		_count     = 0;
+		_samples   = 0;
+		_index     = 0;
+		_isPrimed  = false;
+		_amplitude = 0;
+		_isBelow   = false;
+		_hasStart  = false;
+		_beatCount = 0;
+	}
+
+	bool SpO2Estimator::Process(int32_t red, int32_t infrared, estimate& result)
+	{
+		_last[RED]      = red;
+		_last[INFRARED] = infrared;
+		_samples++;
+		_sums[RED]      += red;
+		_sums[INFRARED] += infrared;
+		if(++_count < _factor) return false;
+
+		int32_t input[CHANNELS];
+		for(size_t channel = 0; channel < CHANNELS; channel++)
+		{
+			input[channel] = static_cast<int32_t>((_sums[channel] << INPUT_SHIFT) / _factor);
+			_sums[channel] = 0;
+		}
+		_count = 0;
+		return Estimate(input, result);
+	}
+
+	bool SpO2Estimator::Conceal(estimate& result)
+	{
+		return Process(_last[RED], _last[INFRARED], result);
+	}
+
+	uint32_t SpO2Estimator::Samples() const
+	{
+		return _samples;
+	}
+
+	bool SpO2Estimator::Estimate(int32_t const (&input)[CHANNELS], estimate& result)
+	{
+		const uint32_t index = _index++;
+		for(size_t channel = 0; channel < CHANNELS; channel++)
+		{
+			int32_t ac = input[channel];
+			if(!_isPrimed)
+			{
+				_dc[channel] = static_cast<int64_t>(input[channel]) << DC_SHIFT;
+				for(size_t section = 0; section < std::size(BAND_PASS); section++) ac = BAND_PASS[section].Prime(ac, _bandPass[channel][section]);
+			}
+			else
+			{
+				_dc[channel] += input[channel] - (_dc[channel] >> DC_SHIFT);
+				for(size_t section = 0; section < std::size(BAND_PASS); section++) ac = BAND_PASS[section].Step(ac, _bandPass[channel][section]);
+			}
+			_ac[channel]      = ac;
+			_maximum[channel] = std::max(_maximum[channel], ac);
+			_minimum[channel] = std::min(_minimum[channel], ac);
+		}
+		_isPrimed = true;
+
+		if(_hasStart && index - _beatStart > LONGEST_BEAT)
+		{
+			// No pulse: Learn the amplitude again from the next beats.
+			_amplitude = 0;
+			_beatCount = 0;
+			_hasStart  = false;
+		}
+
+		// A beat ends at a rising zero crossing, once the signal was below the hysteresis.
+		if(_ac[INFRARED] < -_amplitude / 4) _isBelow = true;
+		if(!_isBelow || _ac[INFRARED] < 0) return false;
+		_isBelow = false;
+		if(!_hasStart)
+		{
+			StartBeat();
+			return false;
+		}
+		return EndBeat(result);
+	}
+
+	bool SpO2Estimator::EndBeat(estimate& result)
+	{
+		const uint32_t period    = _index - 1 - _beatStart;
+		const int64_t  red       = static_cast<int64_t>(_maximum[RED]) - _minimum[RED];
+		const int64_t  infrared  = static_cast<int64_t>(_maximum[INFRARED]) - _minimum[INFRARED];
+		if(period < REFRACTORY || infrared < _amplitude / 4) return false; // Still the same beat
+
+		_amplitude = _amplitude ? static_cast<int32_t>(_amplitude + (infrared - _amplitude) / 4) : static_cast<int32_t>(infrared);
+		const int64_t dcRed      = _dc[RED] >> DC_SHIFT;
+		const int64_t dcInfrared = _dc[INFRARED] >> DC_SHIFT;
+		StartBeat();
+		if(dcRed < (MIN_DC << INPUT_SHIFT) || dcInfrared < (MIN_DC << INPUT_SHIFT) || !infrared) return false;
+
+		// AC / DC of both channels in Q24, then their ratio in Q16. The AC is below 2^24, so nothing overflows.
+		const int64_t perfusionRed      = (red << 24) / dcRed;
+		const int64_t perfusionInfrared = std::max<int64_t>((infrared << 24) / dcInfrared, 1);
+		const auto    slot              = _beatCount++ % BEATS;
+		_ratios[slot]  = static_cast<int32_t>(std::min<int64_t>((perfusionRed << 16) / perfusionInfrared, 4 * Q16));
+		_periods[slot] = period;
+
+		const auto beats  = std::min<uint32_t>(_beatCount, BEATS);
+		int64_t    ratio  = 0;
+		uint32_t   length = 0;
+		for(uint32_t beat = 0; beat < beats; beat++)
+		{
+			ratio  += _ratios[beat];
+			length += _periods[beat];
+		}
+		ratio /= beats;
+
+		// SpO2 = a R^2 + b R + c: Q16 throughout, in 0.01 % at the end.
+		const int64_t saturation = ((_a * (ratio * ratio >> 16) >> 16) + (_b * ratio >> 16) + _c) * 100 >> 16;
+		result = estimate
+		{
+			.sample     = _samples - 1,
+			.period     = length * _factor / beats,
+			.ratio      = static_cast<int32_t>(ratio),
+			.saturation = static_cast<int32_t>(std::clamp<int64_t>(saturation, 0, 10'000)),
+		};
+		return true;
+	}
+
+	void SpO2Estimator::StartBeat()
+	{
+		_hasStart  = true;
+		_beatStart = _index - 1;
+		std::ranges::copy(_ac, _maximum);
+		std::ranges::copy(_ac, _minimum);
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../util/defines.h"
+#include "biquad.h"
+
+namespace dsp
+{
+	/**
+	 * \brief Streaming SpO2 and pulse rate estimation from the red and infrared PPG of a pulse oximeter in fixed point.
+	 * Ratio of ratios: Per beat, R = (AC red / DC red) / (AC infrared / DC infrared), averaged over the last beats and
+	 * mapped to SpO2 by a quadratic calibration.
+	 *
+	 * The DC of each channel is tracked by an exponential average, the AC is the peak to peak amplitude of a band-pass
+	 * (0.5-5 Hz) over one beat. A beat ends at a rising zero crossing of the band-passed infrared signal, with hysteresis,
+	 * a refractory period and a minimum amplitude, which adapts to the previous beats. Crossings, which fail these,
+	 * belong to the current beat (e.g. the dicrotic notch). The inputs are counts of received light (as the MAX30102
+	 * delivers them), which fall while the blood volume rises: The hysteresis expects a steep systolic trough.
+	 *
+	 * The input is averaged down to ESTIMATION_RATE first. So every rate shares the same filters and states, and a
+	 * sample above the estimation rate costs two additions.
+	 */
+	class SpO2Estimator
+	{
+	public:
+		static constexpr size_t ESTIMATION_RATE    = 50; // in SPS. Input rates have to be a multiple.
+		static constexpr size_t BAND_PASS_SECTIONS = 3;
+
+		/**
+		 * \brief Quadratic calibration SpO2 = a R^2 + b R + c in %. It depends on the LEDs and the optics, so a curve of
+		 * the sensor (e.g. the one of the vendor) has to be calibrated against a reference oximeter for clinical use.
+		 */
+		struct calibration
+		{
+			double a, b, c;
+		};
+
+		struct estimate
+		{
+			uint32_t sample;     // Input sample at the end of the beat, counted from Reset
+			uint32_t period;     // Average beat period in input samples
+			int32_t  ratio;      // R averaged over the last beats, Q16
+			int32_t  saturation; // SpO2 in 0.01 %, clamped to [0, 100] %
+		};
+
+		explicit SpO2Estimator(calibration const& curve);
+
+		bool SetSampleRate(size_t sampleRate); // Also resets. Returns false if the rate isn't a multiple of ESTIMATION_RATE.
+		void Reset(); // Forgets the beats and the amplitude.
+		/**
+		 * \brief Feeds one input sample of both channels. Returns true and writes 'result', if a beat ended.
+		 */
+		bool Process(int32_t red, int32_t infrared, OUT estimate& result);
+		bool Conceal(OUT estimate& result); // Feeds the previous sample again, e.g. instead of padding.
+		uint32_t Samples() const; // Fed since Reset
+
+	private:
+		static constexpr size_t  CHANNELS    = 2; // Red, infrared
+		static constexpr size_t  RED         = 0;
+		static constexpr size_t  INFRARED    = 1;
+		static constexpr size_t  BEATS       = 4; // In the averages of R and the period
+		static constexpr int     INPUT_SHIFT = 5; // Fraction bits of the averaged input. Counts have 18 bits.
+		static constexpr int     DC_SHIFT    = 6; // Time constant of the DC average: 64 samples (1.28 s)
+
+		bool Estimate(int32_t const (&input)[CHANNELS], OUT estimate& result); // One sample at ESTIMATION_RATE
+		bool EndBeat(OUT estimate& result);
+		void StartBeat();
+
+		int32_t      _a, _b, _c;  // Calibration, Q16
+		uint32_t     _factor;     // Input samples per estimation sample
+		int64_t      _sums[CHANNELS];
+		uint32_t     _count;
+		int32_t      _last[CHANNELS]; // Previous input sample
+		uint32_t     _samples;        // Input samples since Reset
+		uint32_t     _index;          // Estimation samples since Reset
+		bool         _isPrimed;
+		int64_t      _dc[CHANNELS];   // Q(INPUT_SHIFT + DC_SHIFT)
+		biquad_state _bandPass[CHANNELS][BAND_PASS_SECTIONS];
+		int32_t      _ac[CHANNELS];   // Band-passed, of the current sample
+		int32_t      _maximum[CHANNELS];
+		int32_t      _minimum[CHANNELS];
+		int32_t      _amplitude;      // Average peak to peak infrared amplitude of the beats. 0 while learning.
+		bool         _isBelow;        // The infrared signal fell below the hysteresis since the last beat.
+		bool         _hasStart;
+		uint32_t     _beatStart;      // Estimation sample
+		int32_t      _ratios[BEATS];  // Q16
+		uint32_t     _periods[BEATS]; // Estimation samples
+		uint32_t     _beatCount;
+	};
+}
@@ -8,7 +8,9 @@
 
 #include "tasks/sensor_control.h"
 #include "tasks/transmitter_task.h"
-#include "memory/ring_buffer.h"
+#include "tasks/scheduler.h"
+#include "tasks/startup_barrier.h"
+#include "util/boot_profile.h"
 #include "config/task.h"
 
 namespace config
@@ -20,11 +22,17 @@ namespace config
 extern "C"
 void app_main(void) 
 {
-    //mem::RingBufferView buffers;
-    mem::RingBufferView view;
-
     BaseType_t result;
 
+    if constexpr(config::Scheduler::RUN_JITTER_BENCHMARK)
+    {
+        sys::run_jitter_benchmark(config::Scheduler::JITTER_BENCHMARK_DURATION_MS);
+    }
+
+    // Both tasks start right away: Wi-Fi associates on core 0, while the sensors are initialized on core 1.
+    // The transmitter waits for the ring buffers at the barrier.
+    sys::gStartup.Init();
+
 #if PIN_SENSOR_CONTROL
     result = xTaskCreatePinnedToCore(
 #else
@@ -33,7 +41,7 @@ void app_main(void)
         sys::sensor_control_task, 
         "SensorControlTask", 
         config::SENSOR_CONTROL_TASK_STACK_SIZE,
-        &view,
+        nullptr,
         config::SENSOR_CONTROL_TASK_PRIORITY,
         &config::SensorControl
 #if PIN_SENSOR_CONTROL
@@ -43,13 +51,6 @@ void app_main(void)
 
     assert(result == pdPASS && "[SensorControlTask:] **Fatal** Could not allocate required memory!");
 
-    while(view.size() == 0) { /* Do nothing */ } // Sensor Controller Task has to write  to tmp if ready
-
-    PRINTI("[SensorControlTask:]", "Task created successfully!\n");
-
-    //vTaskPrioritySet(xTaskGetCurrentTaskHandle(), 19);
-    //sys::transmitter_task(&view);
-
 #if PIN_TELEMETRY_TRANSMITTER
     result = xTaskCreatePinnedToCore(
 #else
@@ -58,13 +59,17 @@ void app_main(void)
         sys::transmitter_task,
         "TelemetryTransmitterTask",
         config::TELEMETRY_TRANSMITTER_TASK_STACK_SIZE,
-        &view,
+        nullptr,
         config::TELEMETRY_TRANSMITTER_TASK_PRIORITY,
         &config::TelemetryTransmitter
 #if PIN_TELEMETRY_TRANSMITTER
         ,config::TELEMETRY_TRANSMITTER_TASK_CORE
 #endif
     );
-    
-    while(view.size()) { /* Do nothing */ }
+
+    assert(result == pdPASS && "[TelemetryTransmitterTask:] **Fatal** Could not allocate required memory!");
+
+    // Blocks without using the CPU. app_main returns afterwards, the tasks keep running.
+    sys::gStartup.WaitForAll();
+    util::gBootProfile.Print();
 }
@@ -69,5 +69,10 @@ namespace mem
 		_value[2] = 0;
 		return *this;
 	}
-	
+
+	int24_t::operator int32_t() const
+	{
+		const uint32_t value = _value[0] | (_value[1] << BYTES_TO_BITS(1)) | (_value[2] << BYTES_TO_BITS(2));
+		return static_cast<int32_t>(value << BYTES_TO_BITS(1)) >> BYTES_TO_BITS(1);
+	}
 }
@@ -32,5 +32,8 @@ namespace mem
 		int24_t& operator=(int32_t const& value);
 		int24_t& operator=(int16_t const& value);
 		int24_t& operator=(uint16_t const& value);
+
+		// Conversion (sign extended)
+		explicit operator int32_t() const;
 	};
 }
@@ -0,0 +1,120 @@
+#include "resampler.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "int.h"
+#include "../config/devices.h"
+#include "../network/bdf_annotations.h"
+
+namespace mem
+{
+	namespace
+	{
+		constexpr size_t MAX_CHANNELS = config::BDF::MAX_SENSOR_CHANNELS;
+		static_assert(config::ADS1299::CHANNEL_COUNT <= MAX_CHANNELS && config::BHI160::CHANNEL_COUNT <= MAX_CHANNELS &&
+		              config::MAX30102::CHANNEL_COUNT <= MAX_CHANNELS && config::HeartRate::CHANNEL_COUNT <= MAX_CHANNELS &&
+		              config::Oximetry::CHANNEL_COUNT <= MAX_CHANNELS && config::MCP3561::CHANNEL_COUNT <= MAX_CHANNELS,
+		              "The sample buffer of Fill has to hold every channel of the widest sensor.");
+
+		int24_t interpolate(int24_t const& before, int24_t const& after, int64_t elapsed, int64_t interval)
+		{
+			const int64_t first = static_cast<int32_t>(before);
+			const int64_t last  = static_cast<int32_t>(after);
+			return int24_t(static_cast<int32_t>(first + (last - first) * elapsed / interval));
+		}
+	}
+
+	Resampler::Resampler()
+		: _start(0), _recordDuration(0), _record(0)
+	{
+	}
+
+	void Resampler::Begin(time_us start, time_us recordDuration)
+	{
+		_start          = start;
+		_recordDuration = recordDuration;
+		_record         = 0;
+	}
+
+	bool Resampler::CanFill(RingBuffer const& buffer) const
+	{
+		const RingBuffer::size_type stamped = buffer.StampedSize();
+		return stamped && buffer.TimestampAt(stamped - 1) >= SamplePoint(buffer, buffer.NodesInBDFRecord() - 1);
+	}
+
+	void Resampler::Fill(RingBuffer& buffer, Stack const& stack, size_type firstChannel, file::GapTracker& gaps) const
+	{
+		const RingBuffer::channel_t      channels = buffer.ChannelCount();
+		const RingBuffer::channel_mask_t mask     = buffer.ChannelMask();
+		const RingBuffer::channel_mask_t held     = buffer.HeldChannels();
+		const RingBuffer::channel_mask_t existing = channels < 32 ? (1u << channels) - 1 : RingBuffer::ALL_CHANNELS;
+		const bool                       isMixed  = mask & ~held & existing; // Some channels are interpolated.
+		assert(channels <= MAX_CHANNELS && "Resampler::Fill(...): Too many channels.");
+
+		int24_t sample[MAX_CHANNELS];
+		auto pushPadding = [&](time_us point)
+		{
+			gaps.Padding(point);
+			std::fill_n(sample, buffer.EnabledChannelCount(), int24_t(0));
+			stack.PushNChannels(sample, sizeof(int24_t), firstChannel, buffer.EnabledChannelCount());
+		};
+		for(size_type index = 0; index < buffer.NodesInBDFRecord(); index++)
+		{
+			// Drop nodes, which have a successor at or before the sample point.
+			const time_us point = SamplePoint(buffer, index);
+			while(buffer.StampedSize() > 1 && buffer.TimestampAt(1) <= point)
+			{
+				buffer.ReadAdvance(1);
+			}
+
+			// The sensor didn't sample up to this point until the deadline.
+			const RingBuffer::size_type stamped = buffer.StampedSize();
+			if(!stamped || buffer.TimestampAt(stamped - 1) < point)
+			{
+				pushPadding(point);
+				continue;
+			}
+
+			auto const* before = static_cast<int24_t const*>(buffer.NodeAt(0));
+			auto const* after  = static_cast<int24_t const*>(buffer.NodeAt(1));
+			const time_us beforeTime  = buffer.TimestampAt(0);
+			const bool    isBetween   = stamped > 1 && beforeTime < point;
+			const time_us interval    = isBetween ? buffer.TimestampAt(1) - beforeTime : 0;
+
+			// Padding stays padding: It is neither held nor blended into the neighbouring samples.
+			if(buffer.IsPaddingAt(0) || (isBetween && isMixed && buffer.IsPaddingAt(1)))
+			{
+				pushPadding(point);
+				continue;
+			}
+
+			// Only the enabled channels are packed into the record. Held channels keep the value of the node before.
+			size_type enabled = 0;
+			for(RingBuffer::channel_t channel = 0; channel < channels; channel++)
+			{
+				if(!(mask & (1u << channel))) continue;
+				const bool isInterpolated = isBetween && !(held & (1u << channel));
+				sample[enabled++] = isInterpolated ? interpolate(before[channel], after[channel], point - beforeTime, interval) : before[channel];
+			}
+			stack.PushNChannels(sample, sizeof(int24_t), firstChannel, enabled);
+			gaps.Sample(point);
+		}
+		gaps.Close(RecordStart() + _recordDuration);
+	}
+
+	void Resampler::Advance()
+	{
+		_record++;
+	}
+
+	Resampler::time_us Resampler::RecordStart() const
+	{
+		return _start + _record * _recordDuration;
+	}
+
+	Resampler::time_us Resampler::SamplePoint(RingBuffer const& buffer, size_type sample) const
+	{
+		return RecordStart() + _recordDuration * sample / buffer.NodesInBDFRecord();
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "ring_buffer.h"
+#include "stack.h"
+
+namespace file
+{
+	class GapTracker;
+}
+
+namespace mem
+{
+	/**
+	 * \brief Cuts the records of all sensors from one timeline instead of by sample count.
+	 *
+	 * Record 'index' covers [start + index * duration, start + (index + 1) * duration). Each sensor gets exactly
+	 * NodesInBDFRecord() samples per record, taken at evenly spaced points of that interval. A sample is interpolated
+	 * linearly between the two stamped nodes around its point, so a sensor whose clock drifts against esp_timer is
+	 * neither ahead nor behind the others. Points before the first node repeat the first node. Held channels (see
+	 * RingBuffer::SetHeldChannels) repeat the node before their point instead. A point next to a padding node is padded.
+	 */
+	class Resampler
+	{
+	public:
+		using time_us   = RingBuffer::time_us;
+		using size_type = Stack::size_type;
+
+		Resampler();
+
+		void Begin(time_us start, time_us recordDuration);
+
+		/**
+		 * \brief Whether 'buffer' holds a node at or after the last sample point of the current record.
+		 */
+		bool CanFill(RingBuffer const& buffer) const;
+		/**
+		 * \brief Pushes the samples of the current record to the channels of 'stack', which start at 'firstChannel'.
+		 * Consumes all nodes, which aren't needed for later records. Points after the newest stamped node are padded
+		 * with zeros, so a record can be cut at its deadline although a sensor stalled. Every padded sample of the record
+		 * is reported to 'gaps', which annotates them.
+		 */
+		void Fill(RingBuffer& buffer, Stack const& stack, size_type firstChannel, file::GapTracker& gaps) const;
+		/**
+		 * \brief Continues with the next record.
+		 */
+		void Advance();
+
+		time_us RecordStart() const;
+
+	private:
+		time_us SamplePoint(RingBuffer const& buffer, size_type sample) const;
+
+		time_us  _start;
+		time_us  _recordDuration;
+		uint32_t _record;
+	};
+}
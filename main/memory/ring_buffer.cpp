@@ -3,7 +3,10 @@
 
 #include "ring_buffer.h"
 
+#include <atomic>
+#include <bit>
 #include <cstdio>
+#include <limits>
 
 namespace mem
 {
@@ -58,6 +61,12 @@ namespace mem
 		_nodeCount(0),
 		_read(0),
 		_write(0),
+		_nodesInBDFRecord(0),
+		_channelMask(ALL_CHANNELS),
+		_heldChannels(0),
+		_written(0),
+		_timestamps(nullptr),
+		_stamped(0),
 		_channelCount(0)
 	{
 	}
@@ -74,6 +83,11 @@ namespace mem
 								 _read(0),
 								 _write(0),
 							 	 _nodesInBDFRecord(0),
+								 _channelMask(ALL_CHANNELS),
+								 _heldChannels(0),
+								 _written(0),
+								 _timestamps(nullptr),
+								 _stamped(0),
 								 _channelCount(channelCount)
 	{
 		bool isPower2 = (_nodeCount & (_nodeCount - 1)) == 0 && _nodeCount;
@@ -100,7 +114,17 @@ namespace mem
 
 	void IRAM_ATTR RingBuffer::WriteAdvance() noexcept
 	{
+		// Clears the mark of a padding node, which used this slot before.
+		if(_timestamps) _timestamps[_write] = 0;
 		_write = (_write + 1) % _nodeCount;
+		_written++;
+	}
+
+	void IRAM_ATTR RingBuffer::PaddingAdvance() noexcept
+	{
+		if(_timestamps) _timestamps[_write] = PADDING_FLAG;
+		_write = (_write + 1) % _nodeCount;
+		_written++;
 	}
 
 	void* RingBuffer::CurrentWrite() const noexcept
@@ -108,6 +132,11 @@ namespace mem
 		return static_cast<char*>(_buffer) + _write * _nodeSize;
 	}
 
+	void* RingBuffer::WrittenNode(size_type age) const noexcept
+	{
+		return static_cast<char*>(_buffer) + ((_write + _nodeCount - age) % _nodeCount) * _nodeSize;
+	}
+
 	void* RingBuffer::ChangeChannel(void* ptr, channel_t channelIndex) const noexcept
 	{
 		return ptr + channelIndex * _nodeCount * _nodeSize;
@@ -158,10 +187,11 @@ namespace mem
 		return _channelCount;
 	}
 
-	void RingBuffer::SetBDF(file::bdf_signal_header_t* headers, size_type const& nodesInBDFRecord)
+	void RingBuffer::SetBDF(file::bdf_signal_header_t* headers, size_type const& nodesInBDFRecord, channel_mask_t channelMask)
 	{
 		_headers = headers;
 		_nodesInBDFRecord = nodesInBDFRecord;
+		_channelMask = channelMask;
 	}
 
 	file::bdf_signal_header_t const* RingBuffer::RecordHeaders() const
@@ -174,9 +204,79 @@ namespace mem
 		return _nodesInBDFRecord;
 	}
 
+	RingBuffer::channel_mask_t RingBuffer::ChannelMask() const
+	{
+		return _channelMask;
+	}
+
+	RingBuffer::channel_t RingBuffer::EnabledChannelCount() const
+	{
+		const channel_mask_t existing = _channelCount < std::numeric_limits<channel_mask_t>::digits ? (1u << _channelCount) - 1 : ALL_CHANNELS;
+		return static_cast<channel_t>(std::popcount(_channelMask & existing));
+	}
+
+	void RingBuffer::SetHeldChannels(channel_mask_t channelMask)
+	{
+		_heldChannels = channelMask;
+	}
+
+	RingBuffer::channel_mask_t RingBuffer::HeldChannels() const
+	{
+		return _heldChannels;
+	}
+
+	RingBuffer::size_type RingBuffer::Written() const
+	{
+		return _written;
+	}
+
 	void RingBuffer::Reset()
 	{
-		_write = 0;
-		_read  = 0;
+		_write   = 0;
+		_read    = 0;
+		_stamped = 0;
+	}
+
+	void RingBuffer::SetTimestamps(time_us* timestamps)
+	{
+		_timestamps = timestamps;
+	}
+
+	void RingBuffer::Stamp(time_us newest, time_us period)
+	{
+		if(!_timestamps) return;
+
+		const size_type write = _write;
+		const size_type count = (write - _stamped) & (_nodeCount - 1);
+		for(size_type node = 0; node < count; node++)
+		{
+			time_us& timestamp = _timestamps[(_stamped + node) & (_nodeCount - 1)];
+			timestamp = (newest - static_cast<time_us>(count - 1 - node) * period) | (timestamp & PADDING_FLAG);
+		}
+		// The reader on the other core must not see the new index before the timestamps.
+		std::atomic_thread_fence(std::memory_order_release);
+		_stamped = write;
+	}
+
+	RingBuffer::size_type RingBuffer::StampedSize() const
+	{
+		const size_type stamped = _stamped;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return (stamped - _read) & (_nodeCount - 1);
+	}
+
+	void* RingBuffer::NodeAt(size_type offset) const
+	{
+		return static_cast<char*>(_buffer) + ((_read + offset) & (_nodeCount - 1)) * _nodeSize;
+	}
+
+	RingBuffer::time_us RingBuffer::TimestampAt(size_type offset) const
+	{
+		return _timestamps[(_read + offset) & (_nodeCount - 1)] & ~PADDING_FLAG;
+	}
+
+	bool RingBuffer::IsPaddingAt(size_type offset) const
+	{
+		return _timestamps[(_read + offset) & (_nodeCount - 1)] & PADDING_FLAG;
 	}
 }
@@ -20,6 +20,10 @@
 * 
 * When r* or w* reach the end of the first channel, it will reset to d*.
 * 
+* Optionally every node has a timestamp (see SetTimestamps). Nodes are stamped by Stamp() after they were written.
+* Only stamped nodes (between r* and s*) are visible to StampedSize(), NodeAt() and TimestampAt().
+* A node written with PaddingAdvance() instead of WriteAdvance() is marked as padding in its timestamp (see IsPaddingAt).
+* 
 **/
 namespace file
 {
@@ -61,6 +65,11 @@ namespace mem
 	public:
 		using size_type = unsigned int;
 		using channel_t = unsigned char;
+		using time_us   = long long;
+		using channel_mask_t = unsigned int;
+
+		static constexpr channel_mask_t ALL_CHANNELS = ~0u;
+		static constexpr time_us        PADDING_FLAG = time_us{1} << 62; // Marks a padding node in its timestamp.
 	public:
 		RingBuffer();
 
@@ -77,7 +86,9 @@ namespace mem
 		void* IRAM_ATTR CurrentRead() const noexcept;
 		void          ReadAdvance(size_type advanceNNodes) noexcept;
 		void IRAM_ATTR WriteAdvance() noexcept;
+		void IRAM_ATTR PaddingAdvance() noexcept; // Like WriteAdvance, but marks the node as padding.
 		void* IRAM_ATTR CurrentWrite() const noexcept;
+		void* WrittenNode(size_type age) const noexcept; // Node written 'age' nodes ago, 1 is the newest one.
 		void* ChangeChannel(void* ptr, channel_t channelIndex) const noexcept;
 
 		bool IsValid() const;
@@ -91,11 +102,37 @@ namespace mem
 		size_type                        Size() const;
 		size_type                        NodesToOverflow() const;
 		channel_t                        ChannelCount() const;
-		void                             SetBDF(file::bdf_signal_header_t* headers, size_type const& nodesInBDFRecord) ;
+		/**
+		 * \brief Sets the signal headers of the channels in 'channelMask'. Only these channels are sent.
+		 */
+		void                             SetBDF(file::bdf_signal_header_t* headers, size_type const& nodesInBDFRecord, channel_mask_t channelMask = ALL_CHANNELS);
 		file::bdf_signal_header_t const* RecordHeaders() const;
 		size_type                        NodesInBDFRecord() const;
+		channel_mask_t                   ChannelMask() const;
+		channel_t                        EnabledChannelCount() const;
+		/**
+		 * \brief Channels, which hold a state or an estimate instead of a signal. They are sampled and held instead of
+		 * interpolated (see Resampler).
+		 */
+		void                             SetHeldChannels(channel_mask_t channelMask);
+		channel_mask_t                   HeldChannels() const;
+		size_type                        Written() const; // Nodes written since construction. Wraps around.
 		void                             Reset();
 
+		/**
+		 * \brief Attaches one timestamp per node. 'timestamps' has to hold NodeCount elements.
+		 */
+		void      SetTimestamps(time_us* timestamps);
+		/**
+		 * \brief Stamps all nodes written since the previous call. The newest one gets 'newest', each older one
+		 * 'period' less. So a burst read from a FIFO is spread over the time it was sampled.
+		 */
+		void      Stamp(time_us newest, time_us period);
+		size_type StampedSize() const; // Stamped nodes, which weren't read yet
+		void*     NodeAt(size_type offset) const;      // Node 'offset' after the read pointer
+		time_us   TimestampAt(size_type offset) const; // Timestamp of NodeAt(offset)
+		bool      IsPaddingAt(size_type offset) const; // Whether NodeAt(offset) was written with PaddingAdvance
+
 	public:
 		void*	  _buffer;
 		file::bdf_signal_header_t* _headers;
@@ -105,6 +142,11 @@ namespace mem
 		size_type _read;
 		size_type _write;
 		size_type _nodesInBDFRecord;
+		channel_mask_t _channelMask;
+		channel_mask_t _heldChannels;
+		size_type _written;
+		time_us*  _timestamps;
+		size_type _stamped; // Index behind the newest stamped node
 		channel_t _channelCount;
 	};
 
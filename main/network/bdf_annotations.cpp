@@ -0,0 +1,242 @@
+#include "bdf_annotations.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+#include "../util/utils.h"
+
+namespace file
+{
+	AnnotationWriter gAnnotations = AnnotationWriter();
+
+	namespace
+	{
+		constexpr ascii_t TAL_SEPARATOR = 0x14; // Ends the onset/duration and each annotation text.
+		constexpr ascii_t TAL_DURATION  = 0x15; // Starts the optional duration.
+		constexpr ascii_t TAL_END       = 0x00; // Ends a TAL. Also used to fill the unused rest of the signal.
+
+		constexpr const ascii_t* KIND_NAMES[] = {"Gap", "Reset", "Rate", "Marker", "Overflow", "Late", "Health", "LeadOff", "Noise", "Beat"};
+
+		/**
+		 * \brief Writes a time in seconds without trailing zeros (e.g. "+0.2", "12.004"). Negative times are clamped to 0.
+		 * \return Number of characters written or -1 if 'size' is too small.
+		 */
+		int format_seconds(ascii_t* dst, size_t size, int64_t us, bool withSign)
+		{
+			us = std::max<int64_t>(us, 0);
+			int length = std::snprintf(dst, size, withSign ? "+%lld.%06lld" : "%lld.%06lld",
+									   static_cast<long long>(us / 1'000'000),
+									   static_cast<long long>(us % 1'000'000));
+			if(length < 0 || static_cast<size_t>(length) >= size)
+			{
+				return -1;
+			}
+			const int untrimmed = length;
+			while(dst[length - 1] == '0') --length;
+			if(dst[length - 1] == '.') --length;
+			std::fill(dst + length, dst + untrimmed, TAL_END);
+			return length;
+		}
+	}
+
+	AnnotationWriter::AnnotationWriter()
+		: _entries{},
+		  _read(0),
+		  _count(0),
+		  _dropped(0),
+		  _reportedDropped(0),
+		  _recordIndex(0),
+		  _start(0),
+		  _lock(portMUX_INITIALIZER_UNLOCKED)
+	{
+	}
+
+	void AnnotationWriter::Begin(time_us start)
+	{
+		portENTER_CRITICAL_SAFE(&_lock);
+		_start       = start;
+		_recordIndex = 0;
+		portEXIT_CRITICAL_SAFE(&_lock);
+	}
+
+	bool AnnotationWriter::Push(Kind kind, time_us timestamp, time_us duration, const ascii_t* text)
+	{
+		entry annotation{.timestamp = timestamp, .duration = duration, .kind = kind, .text = {}};
+		// Control characters would break the TAL structure.
+		for(size_type i = 0; text[i] != '\0' && i < std::size(annotation.text) - 1; i++)
+		{
+			annotation.text[i] = text[i] < ' ' ? ' ' : text[i];
+		}
+
+		portENTER_CRITICAL_SAFE(&_lock);
+		const bool fits = _count < std::size(_entries);
+		if(fits)
+		{
+			_entries[(_read + _count) % std::size(_entries)] = annotation;
+			_count++;
+		}
+		else
+		{
+			_dropped++;
+		}
+		portEXIT_CRITICAL_SAFE(&_lock);
+		return fits;
+	}
+
+	void AnnotationWriter::WriteRecord(float durationOfDataRecord, std::span<ascii_t> record)
+	{
+		const time_us recordDuration = static_cast<time_us>(durationOfDataRecord * 1'000'000.f + 0.5f);
+		std::ranges::fill(record, TAL_END);
+
+		portENTER_CRITICAL_SAFE(&_lock);
+		const time_us   start       = _start;
+		const time_us   recordOnset = recordDuration * _recordIndex++;
+		const size_type dropped     = _dropped;
+		portEXIT_CRITICAL_SAFE(&_lock);
+
+		// Time-keeping TAL. Must be the first one in each record.
+		const int onsetLength = format_seconds(record.data(), record.size(), recordOnset, true);
+		assert(onsetLength > 0 && onsetLength + 3 <= static_cast<int>(record.size()) && "Annotation signal is too small.");
+		size_type written = onsetLength;
+		record[written++] = TAL_SEPARATOR;
+		record[written++] = TAL_SEPARATOR;
+		record[written++] = TAL_END;
+
+		// Report dropped annotations as soon as there is room.
+		if(_reportedDropped != dropped)
+		{
+			entry overflow{.timestamp = recordOnset, .duration = 0, .kind = Kind::Overflow, .text = {}};
+			DISCARD std::snprintf(overflow.text, std::size(overflow.text), "%lu dropped", static_cast<unsigned long>(dropped - _reportedDropped));
+			const size_type size = WriteEntry(overflow, record.subspan(written));
+			if(size)
+			{
+				written += size;
+				_reportedDropped = dropped;
+			}
+		}
+
+		// Only this function removes entries, so the oldest one can be formatted outside of the critical section.
+		while(true)
+		{
+			portENTER_CRITICAL_SAFE(&_lock);
+			const bool isEmpty = _count == 0;
+			entry annotation;
+			if(!isEmpty)
+			{
+				annotation = _entries[_read];
+			}
+			portEXIT_CRITICAL_SAFE(&_lock);
+			if(isEmpty) break;
+
+			annotation.timestamp -= start;
+			const size_type size = WriteEntry(annotation, record.subspan(written));
+			if(!size) break; // Stays pending for the next record.
+			written += size;
+
+			portENTER_CRITICAL_SAFE(&_lock);
+			_read = (_read + 1) % std::size(_entries);
+			_count--;
+			portEXIT_CRITICAL_SAFE(&_lock);
+		}
+	}
+
+	AnnotationWriter::size_type AnnotationWriter::Dropped() const
+	{
+		return _dropped;
+	}
+
+	AnnotationWriter::size_type AnnotationWriter::WriteEntry(entry const& annotation, std::span<ascii_t> out) const
+	{
+		// +<onset>[\x15<duration>]\x14<kind> <text>\x14\0
+		ascii_t tal[24 + 24 + config::Annotations::MAX_TEXT_LENGTH + 8];
+		int length = format_seconds(tal, std::size(tal), annotation.timestamp, true);
+		if(annotation.duration > 0)
+		{
+			tal[length++] = TAL_DURATION;
+			length += format_seconds(tal + length, std::size(tal) - length, annotation.duration, false);
+		}
+		tal[length++] = TAL_SEPARATOR;
+		length += std::snprintf(tal + length, std::size(tal) - length, "%s %s", KIND_NAMES[util::to_underlying(annotation.kind)], annotation.text);
+		tal[length++] = TAL_SEPARATOR;
+		tal[length++] = TAL_END;
+
+		if(static_cast<size_type>(length) > out.size())
+		{
+			return 0;
+		}
+		std::copy_n(tal, length, out.begin());
+		return length;
+	}
+
+	GapTracker::GapTracker()
+		: _source{}, _gapStart(0), _paddedSamples(0)
+	{
+	}
+
+	void GapTracker::Begin(std::string_view source)
+	{
+		const size_t length = std::min(source.size(), MAX_SOURCE_LENGTH);
+		std::copy_n(source.begin(), length, _source);
+		_source[length] = '\0';
+		_paddedSamples  = 0;
+	}
+
+	void GapTracker::Sample(time_us point)
+	{
+		Close(point);
+	}
+
+	void GapTracker::Padding(time_us point)
+	{
+		if(_source[0] == '\0') return;
+		if(_paddedSamples++ == 0)
+		{
+			_gapStart = point;
+		}
+	}
+
+	void GapTracker::Close(time_us end)
+	{
+		if(_paddedSamples == 0) return;
+
+		ascii_t text[config::Annotations::MAX_TEXT_LENGTH];
+		DISCARD std::snprintf(text, std::size(text), "%s %lu", _source, static_cast<unsigned long>(_paddedSamples));
+		DISCARD gAnnotations.Push(AnnotationWriter::Kind::SampleGap, _gapStart, end - _gapStart, text);
+		_paddedSamples = 0;
+	}
+
+	LeadOffTracker::LeadOffTracker(const ascii_t* source, AnnotationWriter::time_us hold)
+		: _source(source), _hold(hold), _since(0), _candidate(0), _reported(0)
+	{
+	}
+
+	void LeadOffTracker::Reset()
+	{
+		_since     = 0;
+		_candidate = 0;
+		_reported  = 0;
+	}
+
+	void LeadOffTracker::Update(uint32_t leadOff, AnnotationWriter::time_us timestamp)
+	{
+		if(leadOff != _candidate)
+		{
+			_candidate = leadOff;
+			_since     = timestamp;
+			return;
+		}
+		if(_candidate == _reported || timestamp - _since < _hold) return;
+
+		// Channels are numbered from 1 like the BDF labels.
+		ascii_t text[config::Annotations::MAX_TEXT_LENGTH];
+		int     length = std::snprintf(text, std::size(text), _candidate ? "%s off" : "%s all on", _source);
+		for(uint32_t channel = 0; channel < 32 && length > 0 && static_cast<size_t>(length) < std::size(text); channel++)
+		{
+			if(!(_candidate & (1u << channel))) continue;
+			length += std::snprintf(text + length, std::size(text) - length, " %lu", static_cast<unsigned long>(channel + 1));
+		}
+		DISCARD gAnnotations.Push(AnnotationWriter::Kind::LeadOff, _since, 0, text);
+		_reported = _candidate;
+	}
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include "freertos/FreeRTOS.h"
+
+#include "../config/devices.h"
+#include "../util/defines.h"
+#include "../util/types.h"
+
+namespace file
+{
+	/**
+	 * \brief Collects time-stamped events and writes them as EDF+/BDF+ TALs (Time-stamped Annotation Lists)
+	 * into the "BDF Annotations" signal of each data record.
+	 *
+	 * Every record starts with the time-keeping TAL "+<record onset>\x14\x14\0", followed by as many pending
+	 * annotations as fit. Annotations which don't fit stay pending for the next record. The memory is bounded by
+	 * config::Annotations::MAX_PENDING. If the queue is full, new annotations are dropped and counted instead.
+	 */
+	class AnnotationWriter
+	{
+	public:
+		using size_type = uint32_t;
+		using time_us   = int64_t;
+
+		enum class Kind : util::byte
+		{
+			SampleGap,    // Padding was inserted instead of real samples.
+			SensorReset,  // A sensor was (re-)initialized.
+			RateChange,   // The sample rate of a sensor was (re-)configured.
+			UserMarker,   // Marker sent by the client (BDF_MARKER).
+			Overflow,     // Annotations were dropped, because the queue was full.
+			DeadlineMiss, // A sensor was read later than one sample period after its data was ready.
+			Health,       // A sensor or bus crossed or returned below a threshold of the health monitor.
+			LeadOff,      // Electrodes were detached or reattached.
+			Noise,        // Result of an input-shorted noise capture.
+			Beat,         // R peak of a heartbeat with the instantaneous heart rate (QRS_DETECTION).
+		};
+
+		AnnotationWriter();
+
+		/**
+		 * \brief Starts a new recording. Onsets are relative to 'start'. Annotations pushed beforehand are kept and
+		 * get the onset of the first record.
+		 */
+		void Begin(time_us start);
+
+		/**
+		 * \brief Queues an annotation. Can be called from any task.
+		 * \return false if the annotation was dropped because the queue is full.
+		 */
+		bool Push(Kind kind, time_us timestamp, time_us duration, const ascii_t* text);
+
+		/**
+		 * \brief Writes the annotation signal of the next data record. The unused rest of 'record' is zero filled.
+		 */
+		void WriteRecord(float durationOfDataRecord, OUT std::span<ascii_t> record);
+
+		size_type Dropped() const;
+
+	private:
+		struct entry
+		{
+			time_us timestamp;
+			time_us duration;
+			Kind    kind;
+			ascii_t text[config::Annotations::MAX_TEXT_LENGTH];
+		};
+
+		size_type WriteEntry(entry const& annotation, OUT std::span<ascii_t> out) const;
+
+		entry        _entries[config::Annotations::MAX_PENDING];
+		size_type    _read;
+		size_type    _count;
+		size_type    _dropped;
+		size_type    _reportedDropped;
+		size_type    _recordIndex;
+		time_us      _start;
+		portMUX_TYPE _lock;
+	};
+
+	/**
+	 * \brief Turns consecutive padded samples of one sensor in the data records into a single "SampleGap" annotation
+	 * with a duration. Fed by mem::Resampler with the sample points of the records, so it annotates exactly the padding
+	 * in the file, whether the sensor inserted it or stalled.
+	 */
+	class GapTracker
+	{
+	public:
+		using time_us = AnnotationWriter::time_us;
+
+		static constexpr size_t MAX_SOURCE_LENGTH = 16; // As BDF labels
+
+		GapTracker();
+
+		void Begin(std::string_view source); // Names the sensor, e.g. by its first label. Empty for a sensor which isn't sent.
+		void Sample(time_us point);
+		void Padding(time_us point);
+		void Close(time_us end); // Reports an open gap up to 'end', so each record annotates its own padding.
+
+	private:
+		ascii_t  _source[MAX_SOURCE_LENGTH + 1];
+		time_us  _gapStart;
+		uint32_t _paddedSamples;
+	};
+
+	/**
+	 * \brief Annotates changes of the detached electrodes of a sensor. A change is only reported, once it lasted
+	 * 'hold', so a comparator toggling at its threshold doesn't flood the annotations.
+	 */
+	class LeadOffTracker
+	{
+	public:
+		LeadOffTracker(const ascii_t* source, AnnotationWriter::time_us hold);
+
+		void Reset(); // Reports the current state again, e.g. for a new recording.
+		void Update(uint32_t leadOff, AnnotationWriter::time_us timestamp); // Channel mask of the detached electrodes
+
+	private:
+		const ascii_t*            _source;
+		AnnotationWriter::time_us _hold;
+		AnnotationWriter::time_us _since;     // Start of the candidate
+		uint32_t                  _candidate; // Latest state, not reported until it held
+		uint32_t                  _reported;
+	};
+
+	extern AnnotationWriter gAnnotations;
+}
@@ -146,5 +146,32 @@ namespace file
 		);
 		//string_copy_and_fill(header->label, std::size(header->label), non_terminated())
 	}
+
+	void make_bdf_plus(bdf_header_t* header)
+	{
+		// EDF+ subfields. 'X' marks unknown values.
+		const char* patient   = "X X X X";
+		const char* recording = "Startdate X X X X";
+		const char* reserved  = "BDF+C";
+
+		string_copy_and_fill(TARGET_BDF_HEADER_MEMBER(header, local_patient_identification), patient);
+		string_copy_and_fill(TARGET_BDF_HEADER_MEMBER(header, local_recording_identification), recording);
+		string_copy_and_fill(TARGET_BDF_HEADER_MEMBER(header, version_of_dataformat), reserved);
+	}
+
+	void create_annotation_header(bdf_signal_header_t* header, uint32_t nr_of_samples_in_signal)
+	{
+		// The physical range must differ from the digital one, although it has no meaning for annotations.
+		create_signal_header(header,
+							 ANNOTATION_LABEL,
+							 "",
+							 "",
+							 -1,
+							 1,
+							 -8'388'608,
+							 8'388'607,
+							 "",
+							 nr_of_samples_in_signal);
+		string_copy_and_fill(TARGET_BDF_HEADER_MEMBER(header, reserved), "");
+	}
 }
-	
\ No newline at end of file
@@ -70,8 +70,12 @@ namespace file
 		static constexpr auto REQ_RECORD_HEADERS = util::non_terminated("BDF_REQ_RECORD_HEADERS");
 		static constexpr auto REQ_RECORDS        = util::non_terminated("BDF_REQ_RECORDS"); // In seconds (e.g. 0.005). indefinite = 0, until stop command
 		static constexpr auto REQ_STOP			= util::non_terminated("BDF_STOP");
+		static constexpr auto MARKER            = util::non_terminated("BDF_MARKER"); // Followed by ' ' and the marker text.
+		static constexpr auto REQ_TRACE         = util::non_terminated("BDF_TRACE");  // Between sessions. Answered with a dump of util::Trace.
 	};
 
+	static constexpr ascii_t ANNOTATION_LABEL[] = "BDF Annotations";
+
 	struct EP_LABEL
 	{
 		static constexpr char ECG[]      = "ECG V";
@@ -91,24 +95,40 @@ namespace file
 							  int32_t digital_maximum,
 							  const ascii_t* pre_filtering,
 							  uint32_t nr_of_samples_in_signal);
+	/**
+	 * \brief Turns a plain BDF header into a continuous BDF+ header ("BDF+C") as required when a "BDF Annotations" signal is present.
+	 */
+	void make_bdf_plus(OUT bdf_header_t* header);
+	/**
+	 * \brief Creates the signal header of the "BDF Annotations" signal. Each sample holds 3 Bytes of TALs.
+	 */
+	void create_annotation_header(OUT bdf_signal_header_t* header, uint32_t nr_of_samples_in_signal);
 
+	/**
+	 * \brief Creates the signal headers of the channels in 'channelMask'. They are packed to the front of 'headers'.
+	 */
 	template<typename DeviceType, size_t Count>
-	void createBDFHeader(bdf_signal_header_t(&headers)[Count])
+	void createBDFHeader(bdf_signal_header_t(&headers)[Count], 
+						 uint32_t nodesInBDFRecord = DeviceType::NODES_IN_BDF_RECORD, 
+						 uint32_t channelMask = ~0u)
 	{
-		for(int header = 0; header < DeviceType::CHANNEL_COUNT; header++)
+		static_assert(Count >= DeviceType::CHANNEL_COUNT);
+		int header = 0;
+		for(int channel = 0; channel < DeviceType::CHANNEL_COUNT; channel++)
 		{
+			if(!(channelMask & (1u << channel))) continue;
 			//char label[sizeof(DeviceType::LABEL) + 1 + 3 + 1];
 			//DISCARD std::snprintf(label, std::size(label), "%s %1d", DeviceType::LABEL, header + 1);
-			create_signal_header(&headers[header],
-								 DeviceType::LABELS[header],
+			create_signal_header(&headers[header++],
+								 DeviceType::LABELS[channel],
 								 DeviceType::TRANSDUCER_TYPE,
-								 DeviceType::PHYSICAL_DIMENSIONS[header],
+								 DeviceType::PHYSICAL_DIMENSIONS[channel],
 								 DeviceType::PHYSICAL_MINIMUM,
 								 DeviceType::PHYSICAL_MAXIMUM,
 								 DeviceType::DIGITAL_MINIMUM,
 								 DeviceType::DIGITAL_MAXIMUM,
 								 DeviceType::PRE_FILTERING,
-								 DeviceType::NODES_IN_BDF_RECORD
+								 nodesInBDFRecord
 			);
 		}
 	}
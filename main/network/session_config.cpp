@@ -0,0 +1,103 @@
+#include "session_config.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <span>
+
+#include "../config/devices.h"
+
+#define SESSION_TAG "[Session:]"
+
+namespace net
+{
+	namespace
+	{
+		struct sensor_info
+		{
+			const ascii_t*          name;
+			std::span<const size_t> selectableRates;
+			size_t                  defaultRate;
+			size_t                  channelCount;
+		};
+
+		constexpr sensor_info SENSOR_INFOS[] =
+		{
+			{"MAX30102", config::SampleRates::MAX30102_SELECTABLE, config::MAX30102::SAMPLE_RATE, config::MAX30102::CHANNEL_COUNT},
+			{"ADS1299",  config::SampleRates::ADS1299_SELECTABLE,  config::ADS1299::SAMPLE_RATE,  config::ADS1299::CHANNEL_COUNT},
+			{"BHI160",   config::SampleRates::BHI160_SELECTABLE,   config::BHI160::SAMPLE_RATE,   config::BHI160::CHANNEL_COUNT},
+			{"HR",       QRS_DETECTION ? std::span<const size_t>(config::SampleRates::HEART_RATE_SELECTABLE) : std::span<const size_t>(),
+			             config::HeartRate::SAMPLE_RATE, config::HeartRate::CHANNEL_COUNT},
+			{"SpO2",     SPO2_ESTIMATION ? std::span<const size_t>(config::SampleRates::OXIMETRY_SELECTABLE) : std::span<const size_t>(),
+			             config::Oximetry::SAMPLE_RATE, config::Oximetry::CHANNEL_COUNT},
+		};
+		static_assert(std::size(SENSOR_INFOS) == SessionConfig::Count, "Every sensor of a session needs its limits.");
+
+		constexpr uint32_t all_channels(size_t channelCount)
+		{
+			// A shift by the full width is undefined.
+			return channelCount >= 32 ? ~0u : (1u << channelCount) - 1;
+		}
+		static_assert(all_channels(32) == ~0u && all_channels(4) == 0b1111);
+	}
+
+	SessionConfig SessionConfig::Defaults()
+	{
+		SessionConfig session{};
+		for(size_t index = 0; index < Count; index++)
+		{
+			session.sensors[index] = sensor
+			{
+				.sampleRate  = static_cast<uint32_t>(SENSOR_INFOS[index].defaultRate),
+				.channelMask = all_channels(SENSOR_INFOS[index].channelCount),
+			};
+		}
+		return session;
+	}
+
+	bool SessionConfig::Parse(const ascii_t* text)
+	{
+		while(*text)
+		{
+			text += std::strspn(text, " \r\n");
+			if(!*text) break;
+
+			const size_t nameLength = std::strcspn(text, "= \r\n");
+			auto info = std::ranges::find_if(SENSOR_INFOS, [&](sensor_info const& candidate)
+			{
+				return std::strlen(candidate.name) == nameLength && !std::strncmp(candidate.name, text, nameLength);
+			});
+			if(info == std::end(SENSOR_INFOS) || text[nameLength] != '=')
+			{
+				PRINTI(SESSION_TAG, "Unknown setting '%.*s'.\n", static_cast<int>(nameLength), text);
+				return false;
+			}
+			text += nameLength + 1;
+
+			ascii_t* end = nullptr;
+			const unsigned long rate = std::strtoul(text, &end, 10);
+			if(end == text || std::ranges::find(info->selectableRates, rate) == info->selectableRates.end())
+			{
+				PRINTI(SESSION_TAG, "%s doesn't support %lu SPS.\n", info->name, rate);
+				return false;
+			}
+			text = end;
+
+			uint32_t mask = all_channels(info->channelCount);
+			if(*text == ':')
+			{
+				mask = static_cast<uint32_t>(std::strtoul(text + 1, &end, 16));
+				if(end == text + 1 || (mask & ~all_channels(info->channelCount)))
+				{
+					PRINTI(SESSION_TAG, "Invalid channel mask for %s.\n", info->name);
+					return false;
+				}
+				text = end;
+			}
+
+			sensors[info - std::begin(SENSOR_INFOS)] = sensor{.sampleRate = static_cast<uint32_t>(rate), .channelMask = mask};
+		}
+		return true;
+	}
+}
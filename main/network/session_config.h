@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+#include "../util/defines.h"
+#include "../util/types.h"
+
+namespace net
+{
+	/**
+	 * \brief Sample rates and enabled channels of one session. The client appends them to the header request:
+	 * "BDF_REQ_HEADER[ <sensor>=<rate>[:<channel mask in hex>]]...", e.g. "BDF_REQ_HEADER ADS1299=1000:3 BHI160=25".
+	 * Sensors which aren't listed keep their defaults. Rates have to be selectable (see config::SampleRates) and masks
+	 * may only enable existing channels. A mask of 0 stops sending the signals of a sensor, but it keeps running. E.g.
+	 * "ADS1299=250:0" with QRS_DETECTION sends the heart rate ("HR") and the beat annotations without the ECG, and
+	 * "MAX30102=100:0" with SPO2_ESTIMATION sends SpO2 and the pulse rate ("SpO2") without the PPG.
+	 */
+	struct SessionConfig
+	{
+		enum Sensor : uint8_t
+		{
+			MAX30102,
+			ADS1299,
+			BHI160,
+			HeartRate, // Derived from the ADS1299, only selectable with QRS_DETECTION
+			Oximetry,  // Derived from the MAX30102, only selectable with SPO2_ESTIMATION
+			Count
+		};
+
+		struct sensor
+		{
+			uint32_t sampleRate;  // in SPS
+			uint32_t channelMask; // Bit n enables channel n
+		};
+
+		static SessionConfig Defaults();
+
+		/**
+		 * \brief Applies the settings in 'text' on top of the current ones.
+		 * \return false if a sensor, rate or mask is invalid. The settings before it are applied anyway.
+		 */
+		NODISCARD bool Parse(const ascii_t* text);
+
+		sensor sensors[Sensor::Count];
+	};
+}
@@ -76,6 +76,11 @@ namespace net
 		return recv(_id, data, size_in_bytes, 0);
 	}
 
+	int TCPClient::Poll(void* data, size_t size_in_bytes) const
+	{
+		return recv(_id, data, size_in_bytes, MSG_DONTWAIT);
+	}
+
 	void TCPClient::SetTimeout(long const& s, long const& us)
 	{
 		timeval timeout{};
@@ -30,6 +30,7 @@ namespace net
 
 		TCPError IRAM_ATTR Send(void const* data, size_t size_in_bytes);
 		int  Receive(OUT void* data, size_t size_in_bytes) const;
+		int  Poll(OUT void* data, size_t size_in_bytes) const; // Non-blocking receive. Returns <= 0 if nothing is pending.
 		template<size_t SIZE>
 		void WaitFor(std::array<char, SIZE> const& value) const
 		{
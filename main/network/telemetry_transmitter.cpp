@@ -1,16 +1,24 @@
 #include "telemetry_transmitter.h"
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <string_view>
 
 #include "../memory/int.h"
 #include "../config/devices.h"
 #include "../config/task.h"
 #include "bdf_plus.h"
+#include "bdf_annotations.h"
 #include "../memory/stack.h"
 #include "../util/utils.h"
+#include "../util/metrics.h"
+#include "../util/trace.h"
+#include "../tasks/sensor_control.h"
+#include "session_config.h"
 
 #include <cstdio>
+#include <unistd.h>
 #include <freertos/FreeRTOS.h>
 #include "esp_timer.h"
 
@@ -22,23 +30,46 @@ namespace net
 {
 	mem::int24_t               gSendStackBuffer[config::BDF::SEND_STACK_SIZE];
 	mem::Stack::layout_section gSendStackLayout[config::BDF::OVERALL_CHANNELS];
+	util::byte                 gRecorderBlock[config::Recorder::ENABLED ? config::Recorder::BLOCK_SIZE : 1];
+	util::byte                 gBatchBuffer[config::Transmission::COALESCE_RECORDS ? config::Transmission::MAX_BATCH_SIZE : 1];
+	file::GapTracker           gBufferGaps[config::BDF::SENSOR_BUFFERS]; // Padding in the records, per ring buffer
 
 	TelemetryTransmitter::TelemetryTransmitter(mem::RingBufferView const* view)
-		: _bufferView(*view), _sendStack(mem::Stack(gSendStackBuffer, gSendStackLayout)), _socket(PORT), _channelCount(0), _stackSize(0)
+		: _bufferView(*view), _sendStack(mem::Stack(gSendStackBuffer, gSendStackLayout)), _socket(PORT), _channelCount(0), _stackSize(0), _recordSize(0), _annotationHeader{},
+		  _recorder(_file, gRecorderBlock, config::Recorder::PREALLOCATION_STEP), _recordingNumber(0),
+		  _batchSize(0), _batchRecords(0), _batchStart(0)
 	{
+		BuildLayout();
+		if constexpr(config::Annotations::ENABLED)
+		{
+			file::create_annotation_header(&_annotationHeader, config::Annotations::NODES_IN_BDF_RECORD);
+		}
+	}
+
+	void TelemetryTransmitter::BuildLayout()
+	{
+		_channelCount = 0;
+		_stackSize    = 0;
 		for(auto const& buffer : _bufferView)
 		{
-			for(util::size_t channel = 0; channel < buffer->ChannelCount(); ++channel, ++_channelCount)
+			for(util::size_t channel = 0; channel < buffer->EnabledChannelCount(); ++channel, ++_channelCount)
 			{
 				const mem::Stack::size_type sectionSize = buffer->NodesInBDFRecord() * sizeof(mem::int24_t);
 				gSendStackLayout[_channelCount] = mem::Stack::layout_section{.level = 0, .size = sectionSize, .off = _stackSize};
 				_stackSize += sectionSize;
 			}	
 		}
+		// The annotation signal is placed behind the data signals of the send stack.
+		_recordSize = _stackSize + config::BDF::ANNOTATION_NODES * sizeof(mem::int24_t);
+		assert(_recordSize <= sizeof(gSendStackBuffer));
+		_sendStack.Clear();
 	}
 
 	void TelemetryTransmitter::TryAgain()
 	{
+		EndRecording();
+		_batchSize    = 0;
+		_batchRecords = 0;
 		PRINTI("[Socket:]", "Closing socket\n");
 		_socket.Close();
 		_socket.Open();
@@ -69,16 +100,51 @@ namespace net
 
 	bool TelemetryTransmitter::SendHeaders() 
 	{
+		// Receive the header request. The session configuration, which follows it, determines the headers.
+		char request[file::BDF_COMMANDS::REQ_HEADER.size() + config::Session::MAX_CONFIG_LENGTH + 1];
+		int  received = 0;
+		while(true)
+		{
+			received = _socket.Receive(request, std::size(request) - 1);
+			if(received >= static_cast<int>(file::BDF_COMMANDS::REQ_TRACE.size())
+			   && !std::memcmp(request, file::BDF_COMMANDS::REQ_TRACE.data(), file::BDF_COMMANDS::REQ_TRACE.size()))
+			{
+				if(SendTrace() == TCPError::SENDING_FAILED) return false;
+				continue;
+			}
+			if(received >= static_cast<int>(file::BDF_COMMANDS::REQ_HEADER.size())
+			   && !std::memcmp(request, file::BDF_COMMANDS::REQ_HEADER.data(), file::BDF_COMMANDS::REQ_HEADER.size()))
+			{
+				break;
+			}
+		}
+		request[received] = '\0';
+		PRINTI(TELEMETRY_TAG, "Received header request.\n");
+
+		SessionConfig session = SessionConfig::Defaults();
+		if(!session.Parse(request + file::BDF_COMMANDS::REQ_HEADER.size()))
+		{
+			PRINTI(TELEMETRY_TAG, "Invalid session configuration. Using the defaults.\n");
+			session = SessionConfig::Defaults();
+		}
+		if(!sys::configure_session(session))
+		{
+			PRINTI(TELEMETRY_TAG, "A sensor rejected its sample rate and keeps the previous one.\n");
+		}
+		BuildLayout();
+
 		file::bdf_header_t generalHeader{};
 		file::create_general_header(&generalHeader, 
 									config::DURATION_OF_MEASUREMENT, 
 									-1, 
-									_channelCount);
+									_channelCount + (config::Annotations::ENABLED ? 1 : 0));
+		if constexpr(config::Annotations::ENABLED)
+		{
+			file::make_bdf_plus(&generalHeader);
+		}
 
-		// Receive header request and send it
-		_socket.WaitFor(file::BDF_COMMANDS::REQ_HEADER);
-		PRINTI(TELEMETRY_TAG, "Received header request.\n");
-		if(_socket.Send(&generalHeader, sizeof(generalHeader)) == net::TCPError::SENDING_FAILED)
+		BeginRecording();
+		if(Emit(&generalHeader, sizeof(generalHeader)) == net::TCPError::SENDING_FAILED)
 		{
 			return false;
 		}
@@ -125,9 +191,29 @@ namespace net
 		return std::strtol(reqRecordsBuffer + file::BDF_COMMANDS::REQ_RECORDS.size() + 1, nullptr, 10);
 	}
 
+	void TelemetryTransmitter::BeginTimeline()
+	{
+		const int64_t start = esp_timer_get_time();
+		file::gAnnotations.Begin(start);
+		_resampler.Begin(start, config::RECORD_DURATION_MS * 1'000ll);
+		// Gaps are named by the label of the first sent channel. BDF labels are padded with spaces.
+		assert(_bufferView.size() <= std::size(gBufferGaps));
+		for(size_t index = 0; index < _bufferView.size(); index++)
+		{
+			mem::RingBuffer const& buffer = _bufferView[index];
+			std::string_view       label;
+			if(buffer.EnabledChannelCount())
+			{
+				label = std::string_view(buffer.RecordHeaders()->label, sizeof(buffer.RecordHeaders()->label));
+			}
+			gBufferGaps[index].Begin(label.substr(0, label.find_last_not_of(' ') + 1));
+		}
+	}
+
 	void TelemetryTransmitter::BeginTransmission(long const& numberOfMeasurements)
 	{
-		xEventGroupSetBits(config::SensorControlEventGroup, SensorControlEvent::StartMeasurement);
+		BeginTimeline();
+		xTaskNotify(config::SensorControl, SensorControlEvent::StartMeasurement, eSetBits);
 		// Send records
 		unsigned written = 0;
 		PRINTI(TELEMETRY_TAG, "Sending %ld data records.\n", numberOfMeasurements);
@@ -136,23 +222,75 @@ namespace net
 
 			written += SendDataRecord();
 			PRINTI(TELEMETRY_TAG, "Send a data record.\n");
-
+			if(HandleCommands()) break;
 		}
-		xEventGroupSetBits(config::SensorControlEventGroup, SensorControlEvent::StopMeasurement);
+		DISCARD FlushBatch();
+		xTaskNotify(config::SensorControl, SensorControlEvent::StopMeasurement, eSetBits);
+		EndRecording();
 		PRINTI(TELEMETRY_TAG, "Written %u bytes of data records to server\n", written);
 	}
 
 	void TelemetryTransmitter::BeginTransmission()
 	{
 		_socket.SetTimeout(2, 0);
-		//_sendStack.Clear();
-		//gView.ResetAll();
+		BeginTimeline();
+		xTaskNotify(config::SensorControl, SensorControlEvent::StartMeasurement, eSetBits);
 		do
 		{
 			SendDataRecord();
 			PRINTI(TELEMETRY_TAG, "Send a data record.\n");
 		}
-		while(!_socket.Check(file::BDF_COMMANDS::REQ_STOP));
+		while(!HandleCommands());
+		DISCARD FlushBatch();
+		xTaskNotify(config::SensorControl, SensorControlEvent::StopMeasurement, eSetBits);
+		EndRecording();
+	}
+
+	bool TelemetryTransmitter::HandleCommands()
+	{
+		char      command[file::BDF_COMMANDS::MARKER.size() + 1 + config::Annotations::MAX_TEXT_LENGTH];
+		const int received = _socket.Poll(command, std::size(command) - 1);
+		if(received <= 0)
+		{
+			return false;
+		}
+		command[received] = '\0';
+
+		if(!std::memcmp(command, file::BDF_COMMANDS::REQ_STOP.data(), file::BDF_COMMANDS::REQ_STOP.size()))
+		{
+			return true;
+		}
+		if(!std::memcmp(command, file::BDF_COMMANDS::MARKER.data(), file::BDF_COMMANDS::MARKER.size()))
+		{
+			const char* text = received > static_cast<int>(file::BDF_COMMANDS::MARKER.size()) ? command + file::BDF_COMMANDS::MARKER.size() + 1 : "";
+			if(!file::gAnnotations.Push(file::AnnotationWriter::Kind::UserMarker, esp_timer_get_time(), 0, text))
+			{
+				PRINTI(TELEMETRY_TAG, "Dropped marker '%s'.\n", text);
+			}
+			return false;
+		}
+		PRINTI(TELEMETRY_TAG, "Error received invalid request.\n");
+		return false;
+	}
+
+	TCPError TelemetryTransmitter::SendTrace()
+	{
+		const util::Trace::dump_header header = util::gTrace.Freeze();
+		PRINTI(TELEMETRY_TAG, "Sending the trace.\n");
+		TCPError error = _socket.Send(&header, sizeof(header));
+		for(size_t core = 0; core < util::Trace::CORES && error == TCPError::NO_ERROR; core++)
+		{
+			for(size_t part = 0; part < 2 && error == TCPError::NO_ERROR; part++)
+			{
+				const std::span<const util::Trace::event> events = util::gTrace.Events(core, part);
+				if(!events.empty())
+				{
+					error = _socket.Send(events.data(), events.size_bytes());
+				}
+			}
+		}
+		util::gTrace.Resume();
+		return error;
 	}
 
 	void TelemetryTransmitter::SendHeadersAttribute(size_type const& attributeOffset, size_type const& attributeSize) 
@@ -161,10 +299,14 @@ namespace net
 		{
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpointer-arith"
-			for(auto channel = 0; channel < buffer->ChannelCount(); ++channel)
-				auto _ = _socket.Send(static_cast<void const*>(buffer->RecordHeaders() + channel) + attributeOffset, attributeSize);
+			for(auto channel = 0; channel < buffer->EnabledChannelCount(); ++channel)
+				auto _ = Emit(static_cast<void const*>(buffer->RecordHeaders() + channel) + attributeOffset, attributeSize);
 #pragma GCC diagnostic pop
 		}
+		if constexpr(config::Annotations::ENABLED)
+		{
+			auto _ = Emit(_annotationHeader.data + attributeOffset, attributeSize);
+		}
 
 		//for(auto const& b : gView)
 		//{
@@ -178,37 +320,136 @@ namespace net
 
 	TelemetryTransmitter::size_type IRAM_ATTR TelemetryTransmitter::SendDataRecord() 
 	{
-		mem::Stack::size_type channel;
-		static uint32_t transmitter_count = 0;
 		uint64_t start = esp_timer_get_time();
-		do
+		// Wait until every sensor sampled past the end of the record, then cut all signals from the same interval. A
+		// sensor, which didn't until the deadline, is padded, so it doesn't stall the others.
+		constexpr int64_t RECORD_DURATION_US = config::RECORD_DURATION_MS * 1'000ll;
+		const int64_t     recordStart        = _resampler.RecordStart();
+		const int64_t     deadline           = recordStart + RECORD_DURATION_US + config::Transmission::FILL_TIMEOUT_MS * 1'000ll;
+		while(!std::ranges::all_of(_bufferView, [this](mem::RingBuffer const* buffer) { return _resampler.CanFill(*buffer); }) &&
+			  esp_timer_get_time() < deadline)
 		{
-			channel = 0;
-			for(mem::RingBuffer* buffer: _bufferView)
-			{
-				int fits = _sendStack.Fits(channel, sizeof(mem::int24_t));
-				int hasData = buffer->HasData();
-				while(fits && hasData)
-				{
-					//buffer->Lock();
-					void const* data = buffer->CurrentRead();
-					_sendStack.PushNChannels(data, sizeof(mem::int24_t), channel, buffer->ChannelCount());
-					buffer->ReadAdvance(1);
-					//buffer->Unlock();
-				}
-				if(transmitter_count++ % 100 == 0)
-					PRINTI("[Transmitter:]", "transmitter fits=%d, hasData=%d\n", fits, hasData);
-				channel += buffer->ChannelCount();
-			}
 			YIELD_FOR(20);
 		}
-		while (!_sendStack.Full(0, channel));
+		util::gTrace.Record(util::TraceEvent::TaskWake, util::TraceSource::Transmitter);
+		mem::Stack::size_type channel = 0;
+		file::GapTracker*     gaps    = gBufferGaps;
+		for(mem::RingBuffer* buffer: _bufferView)
+		{
+			_resampler.Fill(*buffer, _sendStack, channel, *gaps++);
+			channel += buffer->EnabledChannelCount();
+		}
+		_resampler.Advance();
 		uint64_t end = esp_timer_get_time();
 		printf("Write took %llu milliseconds (%llu microseconds)\n", (end - start) / 1000, (end - start));
-		TCPError error = _socket.Send(_sendStack.Data(), _stackSize);
+		if constexpr(config::Annotations::ENABLED)
+		{
+			file::gAnnotations.WriteRecord(config::DURATION_OF_MEASUREMENT, 
+										   std::span(reinterpret_cast<ascii_t*>(gSendStackBuffer) + _stackSize, _recordSize - _stackSize));
+		}
+		util::gTrace.Record(util::TraceEvent::RecordReady, util::TraceSource::Transmitter, static_cast<uint16_t>(_recordSize));
+		DISCARD QueueRecord(_sendStack.Data());
+		if constexpr(config::Recorder::ENABLED)
+		{
+			DISCARD _recorder.AppendRecord(_sendStack.Data(), _recordSize);
+		}
 		
 		_sendStack.Clear();
-		return _stackSize;
+		return _recordSize;
+	}
+
+	TCPError TelemetryTransmitter::QueueRecord(void const* record)
+	{
+		if constexpr(!config::Transmission::COALESCE_RECORDS)
+		{
+			return SendRecords(record, _recordSize, 1);
+		}
+
+		TCPError error = TCPError::NO_ERROR;
+		if(_batchSize + _recordSize > sizeof(gBatchBuffer))
+		{
+			error = FlushBatch();
+		}
+		if(_recordSize > sizeof(gBatchBuffer))
+		{
+			// Doesn't fit the socket buffer at all.
+			return SendRecords(record, _recordSize, 1);
+		}
+
+		const int64_t now = esp_timer_get_time();
+		if(!_batchRecords)
+		{
+			_batchStart = now;
+		}
+		std::memcpy(gBatchBuffer + _batchSize, record, _recordSize);
+		_batchSize += _recordSize;
+		_batchRecords++;
+
+		// Send now, if the next record would not fit or would let the oldest one exceed the latency budget.
+		constexpr int64_t RECORD_DURATION_US = config::RECORD_DURATION_MS * 1'000ll;
+		constexpr int64_t LATENCY_BUDGET_US  = config::Transmission::LATENCY_BUDGET_MS * 1'000ll;
+		if(_batchSize + _recordSize > sizeof(gBatchBuffer) || now + RECORD_DURATION_US - _batchStart > LATENCY_BUDGET_US)
+		{
+			const TCPError flushError = FlushBatch();
+			error = error == TCPError::NO_ERROR ? flushError : error;
+		}
+		return error;
 	}
-}
 
+	TCPError TelemetryTransmitter::FlushBatch()
+	{
+		if(!_batchRecords) return TCPError::NO_ERROR;
+
+		const TCPError error = SendRecords(gBatchBuffer, _batchSize, _batchRecords);
+		_batchSize    = 0;
+		_batchRecords = 0;
+		return error;
+	}
+
+	TCPError TelemetryTransmitter::SendRecords(void const* records, size_type size, uint32_t count)
+	{
+		util::gMetrics.Add(util::Metric::RecordsSent, count);
+		util::gMetrics.Add(util::Metric::Sends);
+		util::gMetrics.Add(util::Metric::BytesSent, size);
+		util::gMetrics.Set(util::Metric::RecordsPerSend, count);
+		util::gTrace.Record(util::TraceEvent::SendBegin, util::TraceSource::Transmitter, static_cast<uint16_t>(count));
+		const TCPError error = _socket.Send(records, size);
+		util::gTrace.Record(util::TraceEvent::SendEnd, util::TraceSource::Transmitter);
+		return error;
+	}
+
+	TCPError TelemetryTransmitter::Emit(void const* data, size_type size)
+	{
+		if constexpr(config::Recorder::ENABLED)
+		{
+			DISCARD _recorder.Append(data, size);
+		}
+		return _socket.Send(data, size);
+	}
+
+	void TelemetryTransmitter::BeginRecording()
+	{
+		if constexpr(!config::Recorder::ENABLED) return;
+
+		// Don't overwrite recordings of earlier sessions.
+		char path[std::size(config::Recorder::FILE_NAME_FORMAT) + 8];
+		do
+		{
+			DISCARD std::snprintf(path, std::size(path), config::Recorder::FILE_NAME_FORMAT, _recordingNumber++);
+		}
+		while(access(path, F_OK) == 0);
+
+		if(_recorder.Begin(path))
+		{
+			PRINTI(TELEMETRY_TAG, "Recording to '%s'.\n", path);
+		}
+	}
+
+	void TelemetryTransmitter::EndRecording()
+	{
+		if(_recorder.IsRecording())
+		{
+			DISCARD _recorder.Close();
+		}
+	}
+}
@@ -2,7 +2,11 @@
 
 #include "../memory/ring_buffer.h"
 #include "../memory/stack.h"
+#include "../memory/resampler.h"
 #include "tcp_client.h"
+#include "bdf_plus.h"
+#include "../storage/posix_file.h"
+#include "../storage/bdf_recorder.h"
 #include "esp_attr.h"
 
 namespace mem
@@ -29,14 +33,33 @@ namespace net
 	private:
 		using size_type = size_t;
 
+		void BuildLayout(); // Lays out the enabled channels of all buffers in the send stack.
+		TCPError SendTrace(); // Sends a dump of util::Trace and restarts it.
 		void SendHeadersAttribute(size_type const& attributeOffset, size_type const& attributeSize);
+		void BeginTimeline(); // Starts the timeline of the records and annotations at the current time.
 		size_type IRAM_ATTR SendDataRecord();
+		TCPError QueueRecord(void const* record); // Sends the record, batched with its successors if coalescing is enabled.
+		TCPError FlushBatch();
+		TCPError SendRecords(void const* records, size_type size, uint32_t count);
+		bool HandleCommands(); // Handles commands received while transmitting. Returns true if a stop was requested.
+		TCPError Emit(void const* data, size_type size); // Sends header data and passes it to the recorder.
+		void BeginRecording();
+		void EndRecording();
 
 		mem::RingBufferView _bufferView;
 		mem::Stack     _sendStack;
+		mem::Resampler _resampler;
 		net::TCPClient _socket;
 		unsigned       _channelCount;
-		size_type      _stackSize;
+		size_type      _stackSize;  // Bytes of data signals in a record
+		size_type      _recordSize; // Bytes of a whole record including annotations
+		file::bdf_signal_header_t _annotationHeader;
+		storage::PosixFile        _file;
+		storage::BDFRecorder      _recorder;
+		unsigned                  _recordingNumber;
+		size_type                 _batchSize;    // Bytes in gBatchBuffer
+		uint32_t                  _batchRecords;
+		int64_t                   _batchStart;   // Completion of the oldest record in the batch (in us)
 	};
 }
 
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+namespace storage
+{
+	/**
+	 * \brief Byte oriented file storage. Abstracts the SD card (FAT) on the target and regular files on the host.
+	 */
+	class Backend
+	{
+	public:
+		using size_type = uint64_t;
+
+		virtual ~Backend() = default;
+
+		virtual bool Open(const char* path) = 0;
+		virtual void Close() = 0;
+
+		/**
+		 * \brief Reserves 'size' bytes for the file, so appending doesn't need to allocate clusters.
+		 */
+		virtual bool Preallocate(size_type size) = 0;
+		virtual bool Write(void const* data, size_type size) = 0; // Appends at the current position.
+		virtual bool WriteAt(size_type offset, void const* data, size_type size) = 0; // Keeps the current position.
+		virtual bool Truncate(size_type size) = 0;
+		virtual bool Flush() = 0;
+	};
+}
@@ -0,0 +1,131 @@
+#include "bdf_recorder.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#include "../network/bdf_plus.h"
+
+#define RECORDER_TAG "[BDF Recorder:]"
+
+namespace storage
+{
+	BDFRecorder::BDFRecorder(Backend& backend, std::span<util::byte> blockBuffer, size_type preallocationStep)
+		: _backend(backend),
+		  _block(blockBuffer),
+		  _preallocationStep(preallocationStep),
+		  _fill(0),
+		  _written(0),
+		  _preallocated(0),
+		  _records(0),
+		  _isRecording(false)
+	{
+	}
+
+	bool BDFRecorder::Begin(const char* path)
+	{
+		if(_isRecording)
+		{
+			DISCARD Close();
+		}
+		_fill         = 0;
+		_written      = 0;
+		_preallocated = 0;
+		_records      = 0;
+
+		if(!_backend.Open(path))
+		{
+			PRINTI(RECORDER_TAG, "Unable to open '%s'.\n", path);
+			return false;
+		}
+		_isRecording = true;
+		return true;
+	}
+
+	bool BDFRecorder::Append(void const* data, size_type size)
+	{
+		if(!_isRecording) return false;
+
+		auto bytes = static_cast<util::byte const*>(data);
+		while(size)
+		{
+			const size_type chunk = std::min<size_type>(size, _block.size() - _fill);
+			std::memcpy(_block.data() + _fill, bytes, chunk);
+			_fill += chunk;
+			bytes += chunk;
+			size  -= chunk;
+			if(_fill == _block.size() && !WriteBlock(_fill))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool BDFRecorder::AppendRecord(void const* data, size_type size)
+	{
+		if(!Append(data, size)) return false;
+		_records++;
+		return true;
+	}
+
+	bool BDFRecorder::Close()
+	{
+		if(!_isRecording) return false;
+
+		bool isClosed = !_fill || WriteBlock(_fill);
+		isClosed = isClosed && _backend.Truncate(_written);
+
+		// Patch the number of data records, which was unknown (-1) while streaming.
+		ascii_t numberOfRecords[sizeof file::bdf_header_t::number_of_data_records + 1];
+		DISCARD std::snprintf(numberOfRecords, std::size(numberOfRecords), "%-8llu", static_cast<unsigned long long>(_records));
+		isClosed = isClosed && _backend.WriteAt(offsetof(file::bdf_header_t, number_of_data_records),
+												numberOfRecords,
+												sizeof file::bdf_header_t::number_of_data_records);
+		isClosed = isClosed && _backend.Flush();
+		_backend.Close();
+		_isRecording = false;
+
+		PRINTI(RECORDER_TAG, "Closed recording with %llu records (%llu Bytes).\n",
+			   static_cast<unsigned long long>(_records), static_cast<unsigned long long>(_written));
+		return isClosed;
+	}
+
+	bool BDFRecorder::IsRecording() const
+	{
+		return _isRecording;
+	}
+
+	BDFRecorder::size_type BDFRecorder::Records() const
+	{
+		return _records;
+	}
+
+	BDFRecorder::size_type BDFRecorder::Size() const
+	{
+		return _written + _fill;
+	}
+
+	bool BDFRecorder::WriteBlock(size_type size)
+	{
+		if(_written + size > _preallocated)
+		{
+			// A failed preallocation only costs speed.
+			if(_backend.Preallocate(_preallocated + _preallocationStep))
+			{
+				_preallocated += _preallocationStep;
+			}
+		}
+		if(!_backend.Write(_block.data(), size))
+		{
+			PRINTI(RECORDER_TAG, "Writing failed. Stopping the recording.\n");
+			_backend.Close();
+			_isRecording = false;
+			return false;
+		}
+		_written += size;
+		_fill     = 0;
+		return true;
+	}
+}
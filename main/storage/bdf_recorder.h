@@ -0,0 +1,48 @@
+#pragma once
+
+#include <span>
+
+#include "backend.h"
+#include "../util/defines.h"
+#include "../util/types.h"
+
+namespace storage
+{
+	/**
+	 * \brief Writes a BDF stream (headers followed by data records) into a file.
+	 *
+	 * All data is collected in 'blockBuffer' and only written in whole blocks, so every write is block-aligned
+	 * relative to the beginning of the file. The file is preallocated in steps of 'preallocationStep' Bytes and
+	 * truncated to its real size on Close(). Close() also patches 'number_of_data_records' in the general header,
+	 * which is always sent as -1 (unknown).
+	 */
+	class BDFRecorder
+	{
+	public:
+		using size_type = Backend::size_type;
+
+		BDFRecorder() = delete;
+		BDFRecorder(Backend& backend, std::span<util::byte> blockBuffer, size_type preallocationStep);
+
+		bool Begin(const char* path);
+		bool Append(void const* data, size_type size);       // Header bytes
+		bool AppendRecord(void const* data, size_type size); // One whole data record
+		bool Close();
+
+		bool      IsRecording() const;
+		size_type Records() const;
+		size_type Size() const;
+
+	private:
+		bool WriteBlock(size_type size);
+
+		Backend&              _backend;
+		std::span<util::byte> _block;
+		size_type             _preallocationStep;
+		size_type             _fill;        // Bytes in _block
+		size_type             _written;     // Bytes written to the backend
+		size_type             _preallocated;
+		size_type             _records;
+		bool                  _isRecording;
+	};
+}
@@ -0,0 +1,82 @@
+#include "posix_file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace storage
+{
+	PosixFile::PosixFile()
+		: _fd(-1)
+	{
+	}
+
+	PosixFile::~PosixFile()
+	{
+		Close();
+	}
+
+	bool PosixFile::Open(const char* path)
+	{
+		Close();
+		_fd = open(path, O_CREAT | O_TRUNC | O_RDWR, 0644);
+		return _fd >= 0;
+	}
+
+	void PosixFile::Close()
+	{
+		if(_fd >= 0)
+		{
+			close(_fd);
+			_fd = -1;
+		}
+	}
+
+	bool PosixFile::Preallocate(size_type size)
+	{
+#if defined(ESP_PLATFORM)
+		// FatFs allocates the cluster chain when seeking beyond the end of a file which is opened for writing.
+		const off_t position = lseek(_fd, 0, SEEK_CUR);
+		return lseek(_fd, static_cast<off_t>(size), SEEK_SET) == static_cast<off_t>(size) &&
+			   lseek(_fd, position, SEEK_SET) == position;
+#else
+		return posix_fallocate(_fd, 0, static_cast<off_t>(size)) == 0;
+#endif
+	}
+
+	bool PosixFile::Write(void const* data, size_type size)
+	{
+		auto bytes = static_cast<char const*>(data);
+		while(size)
+		{
+			const ssize_t written = write(_fd, bytes, size);
+			if(written <= 0)
+			{
+				return false;
+			}
+			bytes += written;
+			size  -= written;
+		}
+		return true;
+	}
+
+	bool PosixFile::WriteAt(size_type offset, void const* data, size_type size)
+	{
+		const off_t position = lseek(_fd, 0, SEEK_CUR);
+		if(position < 0 || lseek(_fd, static_cast<off_t>(offset), SEEK_SET) < 0)
+		{
+			return false;
+		}
+		const bool isWritten = Write(data, size);
+		return lseek(_fd, position, SEEK_SET) == position && isWritten;
+	}
+
+	bool PosixFile::Truncate(size_type size)
+	{
+		return ftruncate(_fd, static_cast<off_t>(size)) == 0;
+	}
+
+	bool PosixFile::Flush()
+	{
+		return fsync(_fd) == 0;
+	}
+}
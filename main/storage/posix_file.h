@@ -0,0 +1,29 @@
+#pragma once
+
+#include "backend.h"
+
+namespace storage
+{
+	/**
+	 * \brief Backend on top of the POSIX file API. On the target this is the ESP-IDF VFS (e.g. the FAT formatted SD card),
+	 * on the host a regular file.
+	 */
+	class PosixFile final : public Backend
+	{
+	public:
+		PosixFile();
+		~PosixFile() override;
+
+		bool Open(const char* path) override;
+		void Close() override;
+
+		bool Preallocate(size_type size) override;
+		bool Write(void const* data, size_type size) override;
+		bool WriteAt(size_type offset, void const* data, size_type size) override;
+		bool Truncate(size_type size) override;
+		bool Flush() override;
+
+	private:
+		int _fd;
+	};
+}
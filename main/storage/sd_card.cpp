@@ -0,0 +1,52 @@
+#include "sd_card.h"
+
+#include <cstdio>
+
+#include "esp_vfs_fat.h"
+#include "driver/sdspi_host.h"
+#include "sdmmc_cmd.h"
+
+#include "../config/devices.h"
+#include "../util/defines.h"
+
+#define SD_CARD_TAG "[SD Card:]"
+
+namespace storage
+{
+	static sdmmc_card_t* card = nullptr;
+
+	bool mount_sd_card()
+	{
+		if(card) return true;
+
+		esp_vfs_fat_sdmmc_mount_config_t mountConfig = {};
+		mountConfig.format_if_mount_failed = false;
+		mountConfig.max_files              = config::SDCard::MAX_FILES;
+		mountConfig.allocation_unit_size   = config::Recorder::BLOCK_SIZE;
+
+		sdmmc_host_t host  = SDSPI_HOST_DEFAULT();
+		host.slot          = config::SDCard::Config::SPIHost;
+		host.max_freq_khz  = config::SDCard::CLOCK_SPEED / 1000;
+
+		sdspi_device_config_t slotConfig = SDSPI_DEVICE_CONFIG_DEFAULT();
+		slotConfig.gpio_cs = config::SDCard::CS_PIN;
+		slotConfig.host_id = config::SDCard::Config::SPIHost;
+
+		const esp_err_t err = esp_vfs_fat_sdspi_mount(config::SDCard::MOUNT_POINT, &host, &slotConfig, &mountConfig, &card);
+		if(err != ESP_OK)
+		{
+			PRINTI(SD_CARD_TAG, "Mounting failed: %s\n", esp_err_to_name(err));
+			card = nullptr;
+			return false;
+		}
+		PRINTI(SD_CARD_TAG, "Mounted at '%s'.\n", config::SDCard::MOUNT_POINT);
+		return true;
+	}
+
+	void unmount_sd_card()
+	{
+		if(!card) return;
+		DISCARD esp_vfs_fat_sdcard_unmount(config::SDCard::MOUNT_POINT, card);
+		card = nullptr;
+	}
+}
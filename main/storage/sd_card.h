@@ -0,0 +1,11 @@
+#pragma once
+
+namespace storage
+{
+	/**
+	 * \brief Mounts the FAT formatted SD card at config::SDCard::MOUNT_POINT.
+	 * The SPI bus (config::SDCard::Config) has to be initialized beforehand.
+	 */
+	bool mount_sd_card();
+	void unmount_sd_card();
+}
@@ -0,0 +1,220 @@
+#include "data_ready.h"
+
+#include <cstdio>
+
+#include "esp_timer.h"
+
+#include "../network/bdf_annotations.h"
+
+#define DATA_READY_TAG "[DataReady:]"
+
+namespace sys
+{
+	DataReadyLine::DataReadyLine(gpio_num_t pin, gpio_int_type_t activeLevel, uint32_t notificationBit, util::TraceSource source)
+		: _assertedAt(0), _task(nullptr), _timer(nullptr), _timerPeriod(0), _pin(pin), _activeLevel(activeLevel), _notificationBit(notificationBit), _source(source), _isEnabled(false)
+	{
+	}
+
+	esp_err_t DataReadyLine::Install(TaskHandle_t task)
+	{
+		// The service is shared by all lines. Installing it again only reports ESP_ERR_INVALID_STATE.
+		static const esp_err_t serviceError = gpio_install_isr_service(0);
+		if(serviceError != ESP_OK && serviceError != ESP_ERR_INVALID_STATE)
+		{
+			PRINTI(DATA_READY_TAG, "Unable to install the GPIO ISR service.\n");
+			return serviceError;
+		}
+
+		_task = task;
+		esp_err_t error = gpio_set_direction(_pin, GPIO_MODE_INPUT);
+		if(error == ESP_OK) error = gpio_intr_disable(_pin);
+		if(error == ESP_OK) error = gpio_set_intr_type(_pin, _activeLevel);
+		if(error == ESP_OK) error = gpio_isr_handler_add(_pin, Isr, this);
+		if(error != ESP_OK)
+		{
+			PRINTI(DATA_READY_TAG, "Unable to install the interrupt of GPIO %d.\n", static_cast<int>(_pin));
+		}
+		return error;
+	}
+
+	esp_err_t DataReadyLine::InstallTimer(TaskHandle_t task, int64_t periodUs)
+	{
+		const esp_timer_create_args_t timerArgs =
+		{
+			.callback        = TimerCallback,
+			.arg             = this,
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+			.dispatch_method = ESP_TIMER_ISR,
+#else
+			.dispatch_method = ESP_TIMER_TASK,
+#endif
+			.name            = "DataReady",
+		};
+		_task        = task;
+		_timerPeriod = periodUs;
+		const esp_err_t error = esp_timer_create(&timerArgs, &_timer);
+		if(error != ESP_OK)
+		{
+			PRINTI(DATA_READY_TAG, "Unable to create the timer of a simulated line.\n");
+		}
+		return error;
+	}
+
+	void DataReadyLine::Enable()
+	{
+		_isEnabled = true;
+		if(_timer)
+		{
+			DISCARD esp_timer_start_periodic(_timer, _timerPeriod);
+			return;
+		}
+		DISCARD gpio_intr_enable(_pin);
+	}
+
+	void DataReadyLine::Disable()
+	{
+		_isEnabled = false;
+		if(_timer)
+		{
+			DISCARD esp_timer_stop(_timer);
+			return;
+		}
+		DISCARD gpio_intr_disable(_pin);
+	}
+
+	void DataReadyLine::Rearm()
+	{
+		if(_isEnabled && !_timer)
+		{
+			DISCARD gpio_intr_enable(_pin);
+		}
+	}
+
+	int64_t DataReadyLine::AssertedAt() const
+	{
+		return _assertedAt;
+	}
+
+	void DataReadyLine::Isr(void* arg)
+	{
+		auto line = static_cast<DataReadyLine*>(arg);
+		line->_assertedAt = esp_timer_get_time();
+		util::gTrace.Record(util::TraceEvent::IsrEntry, line->_source);
+		DISCARD gpio_intr_disable(line->_pin);
+
+		BaseType_t hasWokenTask = pdFALSE;
+		DISCARD xTaskNotifyFromISR(line->_task, line->_notificationBit, eSetBits, &hasWokenTask);
+		portYIELD_FROM_ISR(hasWokenTask);
+	}
+
+	void DataReadyLine::TimerCallback(void* arg)
+	{
+		auto line = static_cast<DataReadyLine*>(arg);
+		line->_assertedAt = esp_timer_get_time();
+		util::gTrace.Record(util::TraceEvent::IsrEntry, line->_source);
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+		BaseType_t hasWokenTask = pdFALSE;
+		DISCARD xTaskNotifyFromISR(line->_task, line->_notificationBit, eSetBits, &hasWokenTask);
+		portYIELD_FROM_ISR(hasWokenTask);
+#else
+		DISCARD xTaskNotify(line->_task, line->_notificationBit, eSetBits);
+#endif
+	}
+
+	DeadlineMonitor::DeadlineMonitor(const ascii_t* source, util::Metric metric, int64_t deadline)
+		: _source(source), _metric(metric), _deadline(deadline), _lateSince(0), _lateReads(0)
+	{
+	}
+
+	void DeadlineMonitor::Check(DataReadyLine const& line)
+	{
+		const int64_t now       = esp_timer_get_time();
+		const int64_t assertion = line.AssertedAt();
+		if(now - assertion > _deadline)
+		{
+			util::gMetrics.Add(_metric);
+			if(_lateReads++ == 0)
+			{
+				_lateSince = assertion;
+			}
+			return;
+		}
+		if(_lateReads)
+		{
+			ascii_t text[config::Annotations::MAX_TEXT_LENGTH];
+			DISCARD std::snprintf(text, std::size(text), "%s %lu", _source, static_cast<unsigned long>(_lateReads));
+			DISCARD file::gAnnotations.Push(file::AnnotationWriter::Kind::DeadlineMiss, _lateSince, now - _lateSince, text);
+			_lateReads = 0;
+		}
+	}
+
+	void DeadlineMonitor::SetDeadline(int64_t deadline)
+	{
+		_deadline = deadline;
+	}
+
+	MissedFrameCounter::MissedFrameCounter(util::Metric metric, int64_t period)
+		: _metric(metric), _period(period), _previousAssertion(0), _isStarted(false)
+	{
+	}
+
+	void MissedFrameCounter::Reset()
+	{
+		_isStarted = false;
+	}
+
+	void MissedFrameCounter::SetPeriod(int64_t period)
+	{
+		_period = period;
+		Reset();
+	}
+
+	uint32_t MissedFrameCounter::Check(DataReadyLine const& line)
+	{
+		const int64_t assertion = line.AssertedAt();
+		const int64_t elapsed   = assertion - _previousAssertion;
+		_previousAssertion      = assertion;
+		if(!_isStarted)
+		{
+			_isStarted = true;
+			return 0;
+		}
+		// Rounded, so the jitter of the interrupt latency doesn't count as a frame.
+		const int64_t periods = (elapsed + _period / 2) / _period;
+		if(periods <= 1) return 0;
+		const auto missed = static_cast<uint32_t>(periods - 1);
+		util::gMetrics.Add(_metric, static_cast<util::Metrics::value_type>(missed));
+		return missed;
+	}
+
+	DriftEstimator::DriftEstimator(util::Metric metric, int64_t period)
+		: _metric(metric), _period(period), _firstAssertion(0), _firstSamples(0), _isStarted(false)
+	{
+	}
+
+	void DriftEstimator::Reset()
+	{
+		_isStarted = false;
+	}
+
+	void DriftEstimator::SetPeriod(int64_t period)
+	{
+		_period = period;
+		Reset();
+	}
+
+	void DriftEstimator::Update(int64_t assertedAt, uint32_t samples)
+	{
+		if(!_isStarted)
+		{
+			_firstAssertion = assertedAt;
+			_firstSamples   = samples;
+			_isStarted      = true;
+			return;
+		}
+		const int64_t elapsed  = assertedAt - _firstAssertion;
+		const int64_t expected = static_cast<int64_t>(samples - _firstSamples) * _period;
+		if(elapsed <= 0) return;
+		util::gMetrics.Set(_metric, static_cast<util::Metrics::value_type>((expected - elapsed) * 1'000'000 / elapsed));
+	}
+}
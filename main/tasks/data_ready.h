@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+
+#include "driver/gpio.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "../util/defines.h"
+#include "../util/metrics.h"
+#include "../util/trace.h"
+#include "../util/types.h"
+
+namespace sys
+{
+	/**
+	 * \brief Data ready line of a sensor, which notifies the sampling task directly from its ISR.
+	 *
+	 * The line is level triggered. The ISR masks its interrupt and sets 'notificationBit' in the notification value
+	 * of the task. The task reads all pending data and calls Rearm() afterwards. So a line, which stays asserted
+	 * because not all data was read, can neither be missed nor flood the CPU with interrupts.
+	 *
+	 * A line installed with InstallTimer() has no pin. It is asserted periodically by an esp_timer instead, which drives
+	 * the synthetic sensors.
+	 */
+	class DataReadyLine
+	{
+	public:
+		DataReadyLine(gpio_num_t pin, gpio_int_type_t activeLevel, uint32_t notificationBit, util::TraceSource source);
+
+		/**
+		 * \brief Configures the pin and registers the ISR for 'task'. The interrupt stays disabled until Enable().
+		 */
+		NODISCARD esp_err_t Install(TaskHandle_t task);
+		/**
+		 * \brief Asserts the line every 'periodUs' instead of on the pin, while it is enabled.
+		 */
+		NODISCARD esp_err_t InstallTimer(TaskHandle_t task, int64_t periodUs);
+		void Enable();
+		void Disable();
+		void Rearm();
+
+		int64_t AssertedAt() const; // Time of the last interrupt (in us)
+
+	private:
+		static void Isr(void* line);
+		static void TimerCallback(void* line);
+
+		volatile int64_t   _assertedAt;
+		TaskHandle_t       _task;
+		esp_timer_handle_t _timer;
+		int64_t            _timerPeriod;
+		gpio_num_t         _pin;
+		gpio_int_type_t    _activeLevel;
+		uint32_t           _notificationBit;
+		util::TraceSource  _source;
+		bool               _isEnabled;
+	};
+
+	/**
+	 * \brief Detects reads, which start later than 'deadline' after their data ready line was asserted. For a sensor
+	 * without a FIFO, the next sample has overwritten the data by then. Every late read is counted in 'metric' and a run
+	 * of late reads is annotated once with its duration.
+	 */
+	class DeadlineMonitor
+	{
+	public:
+		DeadlineMonitor(const ascii_t* source, util::Metric metric, int64_t deadline);
+
+		void Check(DataReadyLine const& line); // Call at the beginning of the read.
+		void SetDeadline(int64_t deadline);
+
+	private:
+		const ascii_t* _source;
+		util::Metric   _metric;
+		int64_t        _deadline;
+		int64_t        _lateSince;
+		uint32_t       _lateReads;
+	};
+
+	/**
+	 * \brief Counts the frames of a sensor without FIFO, which were overwritten before they were read. Its data ready
+	 * line is asserted once per sample period, so n periods between two assertions mean n - 1 lost frames.
+	 */
+	class MissedFrameCounter
+	{
+	public:
+		MissedFrameCounter(util::Metric metric, int64_t period);
+
+		void     Reset(); // Call when the measurement was restarted.
+		void     SetPeriod(int64_t period); // Also resets the counter.
+		uint32_t Check(DataReadyLine const& line); // Frames missed before the current one. Call once per frame.
+
+	private:
+		util::Metric _metric;
+		int64_t      _period;
+		int64_t      _previousAssertion;
+		bool         _isStarted;
+	};
+
+	/**
+	 * \brief Estimates how much the sample clock of a sensor deviates from esp_timer. Compares the time between the first
+	 * and the latest data ready assertion with the number of samples in between and exports the deviation to 'metric'.
+	 */
+	class DriftEstimator
+	{
+	public:
+		DriftEstimator(util::Metric metric, int64_t period);
+
+		void Reset(); // Starts a new estimate, e.g. when the measurement was restarted.
+		void Update(int64_t assertedAt, uint32_t samples);
+		void SetPeriod(int64_t period); // Also resets the estimate.
+
+	private:
+		util::Metric _metric;
+		int64_t      _period;
+		int64_t      _firstAssertion;
+		uint32_t     _firstSamples;
+		bool         _isStarted;
+	};
+}
@@ -0,0 +1,167 @@
+#include "health_monitor.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+#include "esp_util/i2cDevice.hpp"
+#include "esp_util/spiDevice.hpp"
+
+#include "../network/bdf_annotations.h"
+
+#define HEALTH_TAG "[Health:]"
+
+namespace sys
+{
+	HealthMonitor gHealthMonitor;
+
+	namespace
+	{
+		constexpr const ascii_t* SENSOR_NAMES[] = {"MAX30102", "ADS1299", "BHI160"};
+		static_assert(std::size(SENSOR_NAMES) == HealthMonitor::Sensor::Count);
+
+		constexpr util::Metric SAMPLE_METRICS[] = {util::Metric::MAX30102Samples, util::Metric::ADS1299Samples, util::Metric::BHI160Samples};
+		constexpr util::Metric RATE_METRICS[]   = {util::Metric::MAX30102Rate, util::Metric::ADS1299Rate, util::Metric::BHI160Rate};
+		// Samples replaced by padding. The BHI160 doesn't pad.
+		constexpr util::Metric PADDING_METRICS[] = {util::Metric::MAX30102Padding, util::Metric::ADS1299MissedFrames, util::Metric::Count};
+
+		util::Metrics::value_type padded_samples(size_t sensor)
+		{
+			return PADDING_METRICS[sensor] == util::Metric::Count ? 0 : util::gMetrics.Get(PADDING_METRICS[sensor]);
+		}
+	}
+
+	HealthMonitor::HealthMonitor()
+		: _snapshots{}, _newest(0), _count(0), _violations(0),
+		  _expectedRates{config::MAX30102::SAMPLE_RATE, config::ADS1299::SAMPLE_RATE, config::BHI160::SAMPLE_RATE},
+		  _isEnabled(false), _isRestartPending(false)
+	{
+	}
+
+	bool HealthMonitor::Start(uint32_t periodMs)
+	{
+		const esp_timer_create_args_t args =
+		{
+			.callback        = TimerCallback,
+			.arg             = this,
+			.dispatch_method = ESP_TIMER_TASK,
+			.name            = "Health",
+		};
+		esp_timer_handle_t timer = nullptr;
+		if(esp_timer_create(&args, &timer) != ESP_OK || esp_timer_start_periodic(timer, periodMs * 1'000ull) != ESP_OK)
+		{
+			PRINTI(HEALTH_TAG, "Unable to start the health monitor.\n");
+			return false;
+		}
+		return true;
+	}
+
+	void HealthMonitor::SetExpectedRate(Sensor sensor, size_t sampleRate)
+	{
+		_expectedRates[sensor].store(sampleRate, std::memory_order_relaxed);
+	}
+
+	void HealthMonitor::Enable()
+	{
+		_isRestartPending.store(true, std::memory_order_relaxed);
+		_isEnabled.store(true, std::memory_order_release);
+	}
+
+	void HealthMonitor::Disable()
+	{
+		_isEnabled.store(false, std::memory_order_relaxed);
+	}
+
+	void HealthMonitor::TimerCallback(void* monitor)
+	{
+		static_cast<HealthMonitor*>(monitor)->Check();
+	}
+
+	void HealthMonitor::Check()
+	{
+		const snapshot current
+		{
+			.time          = esp_timer_get_time(),
+			.samples       = {util::gMetrics.Get(SAMPLE_METRICS[0]), util::gMetrics.Get(SAMPLE_METRICS[1]), util::gMetrics.Get(SAMPLE_METRICS[2])},
+			.padding       = {padded_samples(Sensor::MAX30102), padded_samples(Sensor::ADS1299), padded_samples(Sensor::BHI160)},
+			.i2cErrors     = esp::i2cErrorCount.load(std::memory_order_relaxed),
+			.spiErrors     = esp::spiErrorCount.load(std::memory_order_relaxed),
+			.i2cBusyTimeUs = esp::i2cBusyTimeUs.load(std::memory_order_relaxed),
+		};
+		util::gMetrics.Set(util::Metric::I2CErrors, static_cast<count_t>(current.i2cErrors));
+		util::gMetrics.Set(util::Metric::SPIErrors, static_cast<count_t>(current.spiErrors));
+
+		if(!_isEnabled.load(std::memory_order_acquire)) return;
+		if(_isRestartPending.exchange(false, std::memory_order_relaxed))
+		{
+			// The counters restarted with the ring buffers, so older snapshots can't be compared anymore. A new
+			// recording gets its own annotations, so conditions are reported again.
+			_count      = 0;
+			_violations = 0;
+		}
+
+		_newest             = (_newest + 1) % SNAPSHOTS;
+		_snapshots[_newest] = current;
+		_count              = std::min(_count + 1, SNAPSHOTS);
+		if(_count < 2) return;
+
+		const size_t oldest = (_newest + SNAPSHOTS - (_count - 1)) % SNAPSHOTS;
+		Evaluate(_snapshots[oldest], _snapshots[_newest]);
+	}
+
+	void HealthMonitor::Evaluate(snapshot const& oldest, snapshot const& newest)
+	{
+		// Thresholds only apply to a full window. A shorter one would flag the latency of the first samples.
+		const bool    isWindowFull = _count == SNAPSHOTS;
+		const time_us duration     = newest.time - oldest.time;
+		ascii_t       text[config::Annotations::MAX_TEXT_LENGTH];
+
+		for(size_t sensor = 0; sensor < Sensor::Count; sensor++)
+		{
+			const uint32_t written  = util::Metrics::Delta(newest.samples[sensor], oldest.samples[sensor]);
+			const uint32_t real     = written - util::Metrics::Delta(newest.padding[sensor], oldest.padding[sensor]);
+			const count_t  rate     = static_cast<count_t>(static_cast<int64_t>(real) * 1'000'000 / duration);
+			const size_t   expected = _expectedRates[sensor].load(std::memory_order_relaxed);
+			util::gMetrics.Set(RATE_METRICS[sensor], rate);
+			if(!isWindowFull) continue;
+
+			DISCARD std::snprintf(text, std::size(text), "%s rate %ld/%u", SENSOR_NAMES[sensor], static_cast<long>(rate), static_cast<unsigned>(expected));
+			Report(static_cast<Condition>(Condition::MAX30102Rate + sensor), static_cast<uint64_t>(rate) * 1'000 < expected * config::Health::MIN_RATE_PERMILLE, text);
+		}
+
+		const uint32_t written         = util::Metrics::Delta(newest.samples[Sensor::MAX30102], oldest.samples[Sensor::MAX30102]);
+		const uint32_t padding         = util::Metrics::Delta(newest.padding[Sensor::MAX30102], oldest.padding[Sensor::MAX30102]);
+		const count_t  paddingPermille = written > 0 ? static_cast<count_t>(static_cast<int64_t>(padding) * 1'000 / written) : 0;
+		util::gMetrics.Set(util::Metric::MAX30102PaddingPermille, paddingPermille);
+		const uint32_t i2cBusyTime = newest.i2cBusyTimeUs - oldest.i2cBusyTimeUs;
+		util::gMetrics.Set(util::Metric::I2COccupancyPermille, static_cast<count_t>(static_cast<int64_t>(i2cBusyTime) * 1'000 / duration));
+
+		if(!isWindowFull) return;
+		DISCARD std::snprintf(text, std::size(text), "MAX30102 padding %ld ppt", static_cast<long>(paddingPermille));
+		Report(Condition::MAX30102Padding, static_cast<uint32_t>(paddingPermille) > config::Health::MAX_PADDING_PERMILLE, text);
+
+		const uint32_t i2cErrors = newest.i2cErrors - oldest.i2cErrors;
+		DISCARD std::snprintf(text, std::size(text), "I2C errors %lu", static_cast<unsigned long>(i2cErrors));
+		Report(Condition::I2CErrors, i2cErrors > config::Health::MAX_BUS_ERRORS, text);
+		const uint32_t spiErrors = newest.spiErrors - oldest.spiErrors;
+		DISCARD std::snprintf(text, std::size(text), "SPI errors %lu", static_cast<unsigned long>(spiErrors));
+		Report(Condition::SPIErrors, spiErrors > config::Health::MAX_BUS_ERRORS, text);
+	}
+
+	void HealthMonitor::Report(Condition condition, bool isViolated, const ascii_t* text)
+	{
+		const uint32_t bit         = 1u << condition;
+		const bool     wasViolated = _violations & bit;
+		if(isViolated == wasViolated) return;
+
+		_violations ^= bit;
+		if(isViolated)
+		{
+			util::gMetrics.Add(util::Metric::HealthEvents);
+		}
+		ascii_t annotation[config::Annotations::MAX_TEXT_LENGTH];
+		DISCARD std::snprintf(annotation, std::size(annotation), "%s%s", isViolated ? "" : "ok ", text);
+		DISCARD file::gAnnotations.Push(file::AnnotationWriter::Kind::Health, esp_timer_get_time(), 0, annotation);
+		PRINTI(HEALTH_TAG, "%s\n", annotation);
+	}
+}
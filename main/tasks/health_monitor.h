@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "esp_timer.h"
+
+#include "../config/devices.h"
+#include "../util/defines.h"
+#include "../util/metrics.h"
+#include "../util/types.h"
+
+namespace sys
+{
+	/**
+	 * \brief Checks whether the sensors deliver their configured rates. Every period it takes a snapshot of the sample,
+	 * padding and bus error counters and compares the newest one with the oldest of a sliding window:
+	 *  - Real samples per second of every sensor (written samples minus padding), exported to the *Rate gauges.
+	 *  - Share of padding in the samples of the MAX30102, which pads FIFO overflows.
+	 *  - Failed transfers on the I2C and the SPI bus, and the occupancy of the I2C bus (exported only).
+	 * Crossing a threshold of config::Health and returning below it is annotated and printed once per transition.
+	 *
+	 * The snapshots live in a fixed ring and the checks run on the esp_timer task, so the acquisition tasks only
+	 * update their counters.
+	 */
+	class HealthMonitor
+	{
+	public:
+		enum Sensor : uint8_t
+		{
+			MAX30102,
+			ADS1299,
+			BHI160,
+			Count
+		};
+
+		HealthMonitor();
+
+		/**
+		 * \brief Runs the checks every 'periodMs' from the esp_timer task.
+		 */
+		bool Start(uint32_t periodMs);
+		void SetExpectedRate(Sensor sensor, size_t sampleRate);
+		/**
+		 * \brief Starts a new window. Call after the ring buffers were reset for a measurement.
+		 */
+		void Enable();
+		void Disable(); // Only the bus error counters are updated until the next Enable().
+
+	private:
+		using time_us = int64_t;
+		using count_t = util::Metrics::value_type;
+
+		struct snapshot
+		{
+			time_us  time;
+			count_t  samples[Sensor::Count]; // Written into the ring buffer, including padding
+			count_t  padding[Sensor::Count]; // Part of the samples
+			uint32_t i2cErrors;
+			uint32_t spiErrors;
+			uint32_t i2cBusyTimeUs;
+		};
+
+		// Thresholds, which are tracked for transitions. One bit each.
+		enum Condition : uint8_t
+		{
+			MAX30102Rate,
+			ADS1299Rate,
+			BHI160Rate,
+			MAX30102Padding,
+			I2CErrors,
+			SPIErrors,
+		};
+
+		static void TimerCallback(void* monitor);
+		void Check();
+		void Evaluate(snapshot const& oldest, snapshot const& newest);
+		void Report(Condition condition, bool isViolated, const ascii_t* text);
+
+		static constexpr size_t SNAPSHOTS = config::Health::WINDOW_PERIODS + 1;
+
+		snapshot            _snapshots[SNAPSHOTS];
+		size_t              _newest;
+		size_t              _count;
+		uint32_t            _violations; // Bit per Condition
+		std::atomic<size_t> _expectedRates[Sensor::Count];
+		std::atomic<bool>   _isEnabled;
+		std::atomic<bool>   _isRestartPending;
+	};
+
+	extern HealthMonitor gHealthMonitor;
+}
@@ -0,0 +1,95 @@
+#include "heart_rate_monitor.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+#include "../network/bdf_annotations.h"
+
+#define HEART_RATE_TAG "[Heart Rate:]"
+
+namespace sys
+{
+	namespace
+	{
+		constexpr int64_t DIGITS_PER_BPM = config::HeartRate::DIGITAL_MAXIMUM / config::HeartRate::PHYSICAL_MAXIMUM;
+		constexpr int64_t NODE_PERIOD_US = 1'000'000 / config::HeartRate::SAMPLE_RATE;
+		constexpr int64_t TIMEOUT_US     = config::HeartRate::TIMEOUT_MS * 1'000ll;
+	}
+
+	HeartRateMonitor::HeartRateMonitor()
+		: _detector(), _sampleRate(0), _samplesPerNode(1), _count(0), _heartRate(0), _lastBeat(0), _hasBeat(false),
+		  _underlyingBuffer{}, _buffer(), _mutexBuffer()
+	{
+		_buffer = mem::RingBuffer(&_mutexBuffer,
+								  _underlyingBuffer,
+								  sizeof(node_t),
+								  std::size(_underlyingBuffer),
+								  config::HeartRate::CHANNEL_COUNT);
+		DISCARD SetSampleRate(config::ADS1299::SAMPLE_RATE);
+	}
+
+	bool HeartRateMonitor::SetSampleRate(size_t sampleRate)
+	{
+		if(sampleRate % config::HeartRate::SAMPLE_RATE || !_detector.SetSampleRate(sampleRate))
+		{
+			PRINTI(HEART_RATE_TAG, "No detection at %u SPS.\n", static_cast<unsigned>(sampleRate));
+			return false;
+		}
+		_sampleRate     = sampleRate;
+		_samplesPerNode = static_cast<uint32_t>(sampleRate / config::HeartRate::SAMPLE_RATE);
+		Reset();
+		return true;
+	}
+
+	void HeartRateMonitor::Reset()
+	{
+		_detector.Reset();
+		_count     = 0;
+		_heartRate = 0;
+		_hasBeat   = false;
+	}
+
+	void HeartRateMonitor::Process(int32_t sample, time_us timestamp, bool isPadding)
+	{
+		dsp::QRSDetector::beat beat{};
+		if(isPadding ? _detector.Conceal(beat) : _detector.Process(sample, beat))
+		{
+			Annotate(beat, timestamp);
+		}
+		if(_hasBeat && timestamp - _lastBeat > TIMEOUT_US)
+		{
+			_heartRate = 0;
+			_hasBeat   = false;
+		}
+
+		if(++_count < _samplesPerNode) return;
+		_count = 0;
+		*static_cast<node_t*>(_buffer.CurrentWrite()) = node_t(_heartRate);
+		_buffer.WriteAdvance();
+		_buffer.Stamp(timestamp, NODE_PERIOD_US);
+	}
+
+	mem::RingBuffer* HeartRateMonitor::RingBuffer()
+	{
+		return &_buffer;
+	}
+
+	void HeartRateMonitor::Annotate(dsp::QRSDetector::beat const& beat, time_us timestamp)
+	{
+		// The detector reports a beat a while after its R peak: Go back from the current sample.
+		const int64_t age  = _detector.Samples() - 1 - beat.sample;
+		const time_us peak = timestamp - age * 1'000'000 / static_cast<int64_t>(_sampleRate);
+
+		ascii_t text[config::Annotations::MAX_TEXT_LENGTH]{};
+		if(beat.interval)
+		{
+			const int64_t digits = (60 * DIGITS_PER_BPM * static_cast<int64_t>(_sampleRate) + beat.interval / 2) / beat.interval;
+			_heartRate = static_cast<int32_t>(std::min<int64_t>(digits, config::HeartRate::DIGITAL_MAXIMUM));
+			DISCARD std::snprintf(text, std::size(text), "%ld.%02ld bpm", static_cast<long>(_heartRate / DIGITS_PER_BPM), static_cast<long>(_heartRate % DIGITS_PER_BPM));
+		}
+		_lastBeat = peak;
+		_hasBeat  = true;
+		DISCARD file::gAnnotations.Push(file::AnnotationWriter::Kind::Beat, peak, 0, text);
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "../config/devices.h"
+#include "../dsp/qrs_detector.h"
+#include "../memory/int.h"
+#include "../memory/ring_buffer.h"
+#include "../util/defines.h"
+
+namespace sys
+{
+	/**
+	 * \brief Heart rate from one ADS1299 channel (QRS_DETECTION): Feeds every ECG sample into a dsp::QRSDetector,
+	 * annotates each beat at the time of its R peak and writes the instantaneous heart rate into a ring buffer of its
+	 * own at config::HeartRate::SAMPLE_RATE. The rate is held between the beats and drops to 0 after TIMEOUT_MS.
+	 *
+	 * Runs in the SPI acquisition task, right after the ECG samples were written, so the heart rate nodes are stamped
+	 * on the timeline of the ECG.
+	 */
+	class HeartRateMonitor
+	{
+	public:
+		using time_us = mem::RingBuffer::time_us;
+
+		HeartRateMonitor();
+
+		bool SetSampleRate(size_t sampleRate); // Of the ECG. Also resets.
+		void Reset(); // Restarts the detection, e.g. for a new measurement.
+		/**
+		 * \brief Processes one ECG sample, which was sampled at 'timestamp'. Padding doesn't reach the detector, it
+		 * repeats the previous sample instead.
+		 */
+		void Process(int32_t sample, time_us timestamp, bool isPadding);
+
+		mem::RingBuffer* RingBuffer();
+
+	private:
+		void Annotate(dsp::QRSDetector::beat const& beat, time_us timestamp);
+
+		using node_t = mem::int24_t;
+
+		dsp::QRSDetector  _detector;
+		size_t            _sampleRate;     // Of the ECG
+		uint32_t          _samplesPerNode; // ECG samples per heart rate node
+		uint32_t          _count;          // ECG samples since the last node
+		int32_t           _heartRate;      // in digits of config::HeartRate
+		time_us           _lastBeat;       // R peak of the previous beat
+		bool              _hasBeat;
+		node_t            _underlyingBuffer[config::HeartRate::SAMPLES_IN_RING_BUFFER]; // Don't use directly! Use _buffer instead.
+		mem::RingBuffer   _buffer;
+		StaticSemaphore_t _mutexBuffer;
+	};
+}
@@ -0,0 +1,82 @@
+#include "oximetry_monitor.h"
+
+#include <algorithm>
+#include <iterator>
+
+#define OXIMETRY_TAG "[Oximetry:]"
+
+namespace sys
+{
+	namespace
+	{
+		constexpr int64_t DIGITS_PER_BPM = config::Oximetry::DIGITAL_MAXIMUM / config::Oximetry::PHYSICAL_MAXIMUM;
+		constexpr int64_t NODE_PERIOD_US = 1'000'000 / config::Oximetry::SAMPLE_RATE;
+		constexpr int64_t TIMEOUT_US     = config::Oximetry::TIMEOUT_MS * 1'000ll;
+		static_assert(DIGITS_PER_BPM == 100, "The estimator reports SpO2 in 0.01 %.");
+	}
+
+	OximetryMonitor::OximetryMonitor()
+		: _estimator({config::Oximetry::CALIBRATION_A, config::Oximetry::CALIBRATION_B, config::Oximetry::CALIBRATION_C}),
+		  _sampleRate(0), _samplesPerNode(1), _count(0), _saturation(0), _pulseRate(0), _lastBeat(0), _hasBeat(false),
+		  _underlyingBuffer{}, _buffer(), _mutexBuffer()
+	{
+		_buffer = mem::RingBuffer(&_mutexBuffer,
+								  _underlyingBuffer,
+								  sizeof(node_t),
+								  std::size(_underlyingBuffer),
+								  config::Oximetry::CHANNEL_COUNT);
+		DISCARD SetSampleRate(config::MAX30102::SAMPLE_RATE);
+	}
+
+	bool OximetryMonitor::SetSampleRate(size_t sampleRate)
+	{
+		if(sampleRate % config::Oximetry::SAMPLE_RATE || !_estimator.SetSampleRate(sampleRate))
+		{
+			PRINTI(OXIMETRY_TAG, "No estimation at %u SPS.\n", static_cast<unsigned>(sampleRate));
+			return false;
+		}
+		_sampleRate     = sampleRate;
+		_samplesPerNode = static_cast<uint32_t>(sampleRate / config::Oximetry::SAMPLE_RATE);
+		Reset();
+		return true;
+	}
+
+	void OximetryMonitor::Reset()
+	{
+		_estimator.Reset();
+		_count      = 0;
+		_saturation = 0;
+		_pulseRate  = 0;
+		_hasBeat    = false;
+	}
+
+	void OximetryMonitor::Process(int32_t red, int32_t infrared, time_us timestamp, bool isPadding)
+	{
+		dsp::SpO2Estimator::estimate estimate{};
+		if(isPadding ? _estimator.Conceal(estimate) : _estimator.Process(red, infrared, estimate))
+		{
+			const int64_t digits = (60 * DIGITS_PER_BPM * static_cast<int64_t>(_sampleRate) + estimate.period / 2) / estimate.period;
+			_saturation = estimate.saturation;
+			_pulseRate  = static_cast<int32_t>(std::min<int64_t>(digits, config::Oximetry::DIGITAL_MAXIMUM));
+			_lastBeat   = timestamp;
+			_hasBeat    = true;
+		}
+		if(_hasBeat && timestamp - _lastBeat > TIMEOUT_US)
+		{
+			_saturation = 0;
+			_pulseRate  = 0;
+			_hasBeat    = false;
+		}
+
+		if(++_count < _samplesPerNode) return;
+		_count = 0;
+		*static_cast<node_t*>(_buffer.CurrentWrite()) = node_t{.saturation = _saturation, .pulseRate = _pulseRate};
+		_buffer.WriteAdvance();
+		_buffer.Stamp(timestamp, NODE_PERIOD_US);
+	}
+
+	mem::RingBuffer* OximetryMonitor::RingBuffer()
+	{
+		return &_buffer;
+	}
+}
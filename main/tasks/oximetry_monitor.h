@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "../config/devices.h"
+#include "../dsp/spo2_estimator.h"
+#include "../memory/int.h"
+#include "../memory/ring_buffer.h"
+#include "../util/defines.h"
+
+namespace sys
+{
+	/**
+	 * \brief SpO2 and pulse rate from the MAX30102 (SPO2_ESTIMATION): Feeds every red and infrared sample into a
+	 * dsp::SpO2Estimator and writes both estimates into a ring buffer of its own at config::Oximetry::SAMPLE_RATE. They
+	 * are held between the beats and drop to 0 after TIMEOUT_MS.
+	 *
+	 * Runs in the I2C acquisition task, right after the PPG samples were written, so the nodes are stamped on the
+	 * timeline of the PPG.
+	 */
+	class OximetryMonitor
+	{
+	public:
+		using time_us = mem::RingBuffer::time_us;
+
+		OximetryMonitor();
+
+		bool SetSampleRate(size_t sampleRate); // Of the MAX30102. Also resets.
+		void Reset(); // Restarts the estimation, e.g. for a new measurement.
+		/**
+		 * \brief Processes one PPG sample, which was sampled at 'timestamp'. Padding doesn't reach the estimator, it
+		 * repeats the previous sample instead.
+		 */
+		void Process(int32_t red, int32_t infrared, time_us timestamp, bool isPadding);
+
+		mem::RingBuffer* RingBuffer();
+
+	private:
+		struct node_t
+		{
+			mem::int24_t saturation;
+			mem::int24_t pulseRate;
+		};
+
+		dsp::SpO2Estimator _estimator;
+		size_t             _sampleRate;     // Of the PPG
+		uint32_t           _samplesPerNode; // PPG samples per node
+		uint32_t           _count;          // PPG samples since the last node
+		int32_t            _saturation;     // in digits of config::Oximetry
+		int32_t            _pulseRate;      // in digits of config::Oximetry
+		time_us            _lastBeat;
+		bool               _hasBeat;
+		node_t             _underlyingBuffer[config::Oximetry::SAMPLES_IN_RING_BUFFER]; // Don't use directly! Use _buffer instead.
+		mem::RingBuffer    _buffer;
+		StaticSemaphore_t  _mutexBuffer;
+	};
+}
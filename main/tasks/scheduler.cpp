@@ -0,0 +1,263 @@
+#include "scheduler.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <limits>
+
+#include "../config/task.h"
+#include "../util/metrics.h"
+
+#define SCHEDULER_TAG "[Scheduler:]"
+
+namespace config
+{
+	TaskHandle_t SchedulerDispatch = nullptr;
+}
+
+namespace sys
+{
+	Scheduler gScheduler;
+
+	namespace
+	{
+		size_t jitter_bucket(Scheduler::time_us lateness)
+		{
+			if(lateness <= 0) return 0;
+			const auto width = static_cast<size_t>(std::bit_width(static_cast<uint64_t>(lateness)));
+			return std::min(width, Scheduler::BUCKETS - 1);
+		}
+
+		void idle_job(void*)
+		{
+		}
+	}
+
+	Scheduler::Scheduler()
+		: _jobs{}, _timer(nullptr), _task(nullptr), _lock(portMUX_INITIALIZER_UNLOCKED)
+	{
+	}
+
+	bool Scheduler::Start()
+	{
+		if(_task) return true;
+
+		const esp_timer_create_args_t timerArgs =
+		{
+			.callback        = TimerCallback,
+			.arg             = this,
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+			.dispatch_method = ESP_TIMER_ISR,
+#else
+			.dispatch_method = ESP_TIMER_TASK,
+#endif
+			.name            = "Scheduler",
+		};
+		if(esp_timer_create(&timerArgs, &_timer) != ESP_OK)
+		{
+			PRINTI(SCHEDULER_TAG, "Unable to create the timer.\n");
+			return false;
+		}
+
+#if PIN_SCHEDULER_DISPATCH
+		const BaseType_t result = xTaskCreatePinnedToCore(
+#else
+		const BaseType_t result = xTaskCreate(
+#endif
+			DispatchTask,
+			"SchedulerDispatchTask",
+			config::SCHEDULER_DISPATCH_TASK_STACK_SIZE,
+			this,
+			config::SCHEDULER_DISPATCH_TASK_PRIORITY,
+			&_task
+#if PIN_SCHEDULER_DISPATCH
+			,config::SCHEDULER_DISPATCH_TASK_CORE
+#endif
+		);
+		if(result != pdPASS)
+		{
+			PRINTI(SCHEDULER_TAG, "Unable to create the dispatch task.\n");
+			return false;
+		}
+		config::SchedulerDispatch = _task;
+		Wake(); // Arms the timer for jobs which were added before.
+		return true;
+	}
+
+	Scheduler::job_id Scheduler::Add(const char* name, time_us period, callback function, void* arg)
+	{
+		job_id id = INVALID_JOB;
+		portENTER_CRITICAL(&_lock);
+		for(job_id slot = 0; slot < std::size(_jobs); slot++)
+		{
+			if(!_jobs[slot].function)
+			{
+				_jobs[slot] = job
+				{
+					.name       = name,
+					.period     = period,
+					.deadline   = esp_timer_get_time() + period,
+					.function   = function,
+					.arg        = arg,
+					.statistics = {},
+				};
+				id = slot;
+				break;
+			}
+		}
+		portEXIT_CRITICAL(&_lock);
+
+		if(id == INVALID_JOB)
+		{
+			PRINTI(SCHEDULER_TAG, "No free slot for job '%s'.\n", name);
+			return id;
+		}
+		Wake(); // The new deadline might be the earliest one.
+		return id;
+	}
+
+	void Scheduler::Remove(job_id job)
+	{
+		if(job >= std::size(_jobs)) return;
+		portENTER_CRITICAL(&_lock);
+		_jobs[job].function = nullptr;
+		portEXIT_CRITICAL(&_lock);
+	}
+
+	Scheduler::jitter_statistics Scheduler::Statistics(job_id job) const
+	{
+		portENTER_CRITICAL(&_lock);
+		const jitter_statistics statistics = _jobs[job].statistics;
+		portEXIT_CRITICAL(&_lock);
+		return statistics;
+	}
+
+	void Scheduler::PrintStatistics() const
+	{
+		for(job_id id = 0; id < std::size(_jobs); id++)
+		{
+			portENTER_CRITICAL(&_lock);
+			const job current = _jobs[id];
+			portEXIT_CRITICAL(&_lock);
+			if(!current.function) continue;
+
+			jitter_statistics const& statistics = current.statistics;
+			PRINTI(SCHEDULER_TAG, "'%s' (%lld us): %lu runs, %lu overruns, lateness mean %lld us, max %lld us\n",
+				   current.name,
+				   current.period,
+				   static_cast<unsigned long>(statistics.runs),
+				   static_cast<unsigned long>(statistics.overruns),
+				   statistics.runs ? statistics.sum / statistics.runs : 0,
+				   statistics.maximum);
+			for(size_t bucket = 0; bucket < BUCKETS; bucket++)
+			{
+				if(!statistics.histogram[bucket]) continue;
+				PRINTI(SCHEDULER_TAG, "  < %7lld us: %lu\n", 1ll << bucket, static_cast<unsigned long>(statistics.histogram[bucket]));
+			}
+		}
+	}
+
+	void Scheduler::TimerCallback(void* scheduler)
+	{
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+		BaseType_t hasWokenTask = pdFALSE;
+		vTaskNotifyGiveFromISR(static_cast<Scheduler*>(scheduler)->_task, &hasWokenTask);
+		portYIELD_FROM_ISR(hasWokenTask);
+#else
+		static_cast<Scheduler*>(scheduler)->Wake();
+#endif
+	}
+
+	void Scheduler::DispatchTask(void* scheduler)
+	{
+		while(true)
+		{
+			DISCARD ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+			static_cast<Scheduler*>(scheduler)->Dispatch();
+		}
+	}
+
+	void Scheduler::Wake()
+	{
+		if(_task)
+		{
+			DISCARD xTaskNotifyGive(_task);
+		}
+	}
+
+	void Scheduler::Dispatch()
+	{
+		time_us earliestDeadline = std::numeric_limits<time_us>::max();
+		for(job_id id = 0; id < std::size(_jobs); id++)
+		{
+			job& current = _jobs[id];
+
+			portENTER_CRITICAL(&_lock);
+			const callback function = current.function;
+			void* const    arg      = current.arg;
+			const time_us  deadline = current.deadline;
+			portEXIT_CRITICAL(&_lock);
+			if(!function) continue;
+
+			time_us now          = esp_timer_get_time();
+			time_us nextDeadline = deadline;
+			if(deadline <= now)
+			{
+				function(arg);
+
+				const time_us lateness = now - deadline;
+				portENTER_CRITICAL(&_lock);
+				jitter_statistics& statistics = current.statistics;
+				statistics.histogram[jitter_bucket(lateness)]++;
+				statistics.runs++;
+				statistics.sum     += lateness;
+				statistics.maximum  = std::max(statistics.maximum, lateness);
+
+				// Keep the phase: The next deadline only depends on the previous one, never on the time of the run.
+				current.deadline += current.period;
+				now = esp_timer_get_time();
+				if(current.deadline <= now)
+				{
+					const time_us missed = (now - current.deadline) / current.period + 1;
+					current.deadline   += missed * current.period;
+					statistics.overruns += missed;
+					util::gMetrics.Add(util::Metric::SchedulerOverruns, missed);
+				}
+				nextDeadline = current.deadline;
+				portEXIT_CRITICAL(&_lock);
+				util::gMetrics.Set(util::Metric::SchedulerMaxLateness, std::max<time_us>(util::gMetrics.Get(util::Metric::SchedulerMaxLateness), lateness));
+			}
+			earliestDeadline = std::min(earliestDeadline, nextDeadline);
+		}
+
+		if(earliestDeadline == std::numeric_limits<time_us>::max()) return;
+		DISCARD esp_timer_stop(_timer);
+		const time_us timeout = std::max<time_us>(earliestDeadline - esp_timer_get_time(), 0);
+		if(esp_timer_start_once(_timer, timeout) != ESP_OK)
+		{
+			PRINTI(SCHEDULER_TAG, "Unable to arm the timer.\n");
+		}
+	}
+
+	void run_jitter_benchmark(uint32_t durationMs)
+	{
+		static constexpr Scheduler::time_us PERIODS[] = {250, 1'000, 4'000, 10'000}; // in us
+		static constexpr const char*        NAMES[]   = {"Benchmark 250us", "Benchmark 1ms", "Benchmark 4ms", "Benchmark 10ms"};
+
+		if(!gScheduler.Start()) return;
+		Scheduler::job_id jobs[std::size(PERIODS)];
+		for(size_t index = 0; index < std::size(PERIODS); index++)
+		{
+			jobs[index] = gScheduler.Add(NAMES[index], PERIODS[index], idle_job);
+		}
+
+		vTaskDelay(pdMS_TO_TICKS(durationMs));
+		PRINTI(SCHEDULER_TAG, "Jitter benchmark after %lu ms:\n", static_cast<unsigned long>(durationMs));
+		gScheduler.PrintStatistics();
+
+		for(Scheduler::job_id job : jobs)
+		{
+			gScheduler.Remove(job);
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "../config/devices.h"
+#include "../util/defines.h"
+
+namespace sys
+{
+	/**
+	 * \brief Runs periodic jobs with microsecond periods. Used for sources without a data ready line.
+	 *
+	 * A single one-shot esp_timer is armed for the earliest deadline. Its callback only wakes the dispatch task, which
+	 * runs all due jobs. Deadlines are absolute (previous deadline + period), so the lateness of one run doesn't drift
+	 * into the following ones. Periods which are missed completely are skipped and counted as overruns. The lateness
+	 * of every run is recorded in a histogram per job.
+	 */
+	class Scheduler
+	{
+	public:
+		using time_us  = int64_t;
+		using callback = void (*)(void* arg);
+		using job_id   = uint8_t;
+
+		static constexpr job_id INVALID_JOB = 0xFF;
+		static constexpr size_t BUCKETS     = config::Scheduler::JITTER_HISTOGRAM_BUCKETS;
+
+		/**
+		 * \brief Lateness of the runs of a job. Bucket 0 counts runs which were less than 1 us late,
+		 * bucket b counts [2^(b-1), 2^b) us and the last bucket everything above.
+		 */
+		struct jitter_statistics
+		{
+			uint32_t histogram[BUCKETS];
+			uint32_t runs;
+			uint32_t overruns;
+			time_us  maximum;
+			time_us  sum;
+		};
+
+		Scheduler();
+
+		/**
+		 * \brief Creates the timer and the dispatch task.
+		 */
+		bool Start();
+		/**
+		 * \brief Adds a job, which first runs one period from now.
+		 * \return The id of the job or INVALID_JOB if all slots are taken.
+		 */
+		job_id Add(const char* name, time_us period, callback function, void* arg = nullptr);
+		void Remove(job_id job);
+
+		NODISCARD jitter_statistics Statistics(job_id job) const;
+		void PrintStatistics() const;
+
+	private:
+		struct job
+		{
+			const char*       name;
+			time_us           period;
+			time_us           deadline;
+			callback          function;
+			void*             arg;
+			jitter_statistics statistics;
+		};
+
+		static void TimerCallback(void* scheduler);
+		static void DispatchTask(void* scheduler);
+		void Dispatch();
+		void Wake();
+
+		job                   _jobs[config::Scheduler::MAX_JOBS];
+		esp_timer_handle_t    _timer;
+		TaskHandle_t          _task;
+		mutable portMUX_TYPE  _lock;
+	};
+
+	/**
+	 * \brief Runs idle jobs of several periods for 'durationMs' and prints their jitter histograms.
+	 */
+	void run_jitter_benchmark(uint32_t durationMs);
+
+	extern Scheduler gScheduler;
+}
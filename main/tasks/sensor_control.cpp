@@ -8,20 +8,39 @@
 #include "../devices/MCP3561.hpp"
 #include "../devices/PCF8574.hpp"
 #include "../devices/TSC2003.hpp"
+#include "../devices/Synthetic.hpp"
+#include "../dsp/decimator.h"
+#include "../dsp/ecg_filter.h"
 #include "../network/bdf_plus.h"
+#include "../network/bdf_annotations.h"
+#include "../network/session_config.h"
 #include "../util/utils.h"
 
 #include "sensor_control.h"
 #include "../config/task.h"
-#include <freertos/timers.h>
+#include "../util/metrics.h"
+#include "../util/boot_profile.h"
+#include "../util/trace.h"
+#include "data_ready.h"
+#include "health_monitor.h"
+#include "heart_rate_monitor.h"
+#include "oximetry_monitor.h"
+#include "startup_barrier.h"
+#include "scheduler.h"
+#include "esp_cpu.h"
 #include "esp_timer.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include <cassert>
+#include <cmath>
 #include <cstdio>
 
 #define SENSOR_CONTROL_TAG "[Sensor Control:]"
 
 namespace config
 {
-	EventGroupHandle_t SensorControlEventGroup = nullptr;
+	TaskHandle_t SPIAcquisition = nullptr;
+	TaskHandle_t I2CAcquisition = nullptr;
 }
 
 namespace sys
@@ -30,113 +49,647 @@ namespace sys
 	esp::spiHost<config::ADS1299::Config> boardSPI;
 	volatile esp::i2cMaster<config::I2C0_Config> boardI2C;
 	// Devices
+#if USE_SYNTHETIC_SENSORS
+	device::SyntheticMAX30102 pulseOxiMeter;
+	device::SyntheticADS1299  ecg;
+	device::SyntheticBHI160   imu;
+	device::SyntheticMCP3561  adc;
+#else
 	device::MAX30102 pulseOxiMeter;
 	device::ADS1299  ecg(boardSPI);
 	device::BHI160   imu;
-	device::PCF8574  ioExpander;
 	device::MCP3561  adc(boardSPI);
+#endif
+	device::PCF8574  ioExpander;
 	device::TSC2003  touchScreenController;
 
-	consteval TickType_t sample_rate_to_ticks(TickType_t const& sampleRate)
+	/**
+	 * \brief Bits of the boot event group. Each acquisition task sets its bit, once the devices on its bus are initialized.
+	 */
+	struct BootEvent
 	{
-		constexpr TickType_t OFFSET = 2;
-		// configTICK_RATE_HZ is 100 Hz. So its rounded up to a multiple of 10ms
-		const TickType_t multiples = configTICK_RATE_HZ / sampleRate;
-		if(configTICK_RATE_HZ % sampleRate != 0)
+		enum : EventBits_t
 		{
-			return multiples + 1 + OFFSET;
-		}
-		return multiples + OFFSET;
+			SPIDevicesReady = 1 << 0,
+			I2CDevicesReady = 1 << 1,
+			All             = SPIDevicesReady | I2CDevicesReady,
+		};
+	};
+
+	/**
+	 * \brief Bits of the session event group. Each acquisition task sets its bit, once it programmed the pending sample
+	 * rates into the sensors on its bus.
+	 */
+	struct SessionEvent
+	{
+		enum : EventBits_t
+		{
+			SPIRatesApplied = 1 << 0,
+			I2CRatesApplied = 1 << 1,
+			All             = SPIRatesApplied | I2CRatesApplied,
+		};
+	};
+
+	void annotate_reset(const ascii_t* device)
+	{
+		DISCARD file::gAnnotations.Push(file::AnnotationWriter::Kind::SensorReset, esp_timer_get_time(), 0, device);
 	}
 
-	void oxi_meter_timer_callback(TimerHandle_t)
+	void annotate_sample_rate(const ascii_t* device, size_t sampleRate)
 	{
-		xEventGroupSetBits(config::SensorControlEventGroup, SensorControlEvent::PulseOximeterReady);
+		ascii_t text[config::Annotations::MAX_TEXT_LENGTH];
+		DISCARD std::snprintf(text, std::size(text), "%s %u", device, static_cast<unsigned>(sampleRate));
+		DISCARD file::gAnnotations.Push(file::AnnotationWriter::Kind::RateChange, esp_timer_get_time(), 0, text);
 	}
 
-	TimerHandle_t create_oxi_meter_timer()
+	// Data ready lines
+	DataReadyLine pulseOxiMeterLine(config::MAX30102::INTERRUPT_PIN, GPIO_INTR_LOW_LEVEL, SensorControlEvent::PulseOximeterReady, util::TraceSource::MAX30102);
+	DataReadyLine ecgLine(config::ADS1299::N_DRDY_PIN, GPIO_INTR_LOW_LEVEL, SensorControlEvent::ElectrocardiogramReady, util::TraceSource::ADS1299);
+	DataReadyLine imuLine(config::BHI160::INTERRUPT_PIN, GPIO_INTR_HIGH_LEVEL, SensorControlEvent::InertialMeasurementUnitReady, util::TraceSource::BHI160);
+	DataReadyLine adcLine(config::MCP3561::IRQ_PIN, GPIO_INTR_LOW_LEVEL, SensorControlEvent::AnalogDigitalConverterReady, util::TraceSource::MCP3561);
+	// Sample periods (in us). All but the one of the ADC follow the session configuration.
+	int64_t           pulseOxiMeterPeriod = 1'000'000 / config::MAX30102::SAMPLE_RATE;
+	int64_t           ecgPeriod           = 1'000'000 / config::ADS1299::SAMPLE_RATE; // Of the decimated samples
+	int64_t           ecgFramePeriod      = ecgPeriod / config::ADS1299::DECIMATION;   // Of the data ready assertions
+	int64_t           imuPeriod           = 1'000'000 / config::BHI160::SAMPLE_RATE;
+	constexpr int64_t ADC_PERIOD          = 1'000'000 / config::MCP3561::SAMPLE_RATE;
+	// Deadline misses: A read later than one sample period after the data ready assertion
+	DeadlineMonitor pulseOxiMeterDeadline("MAX30102", util::Metric::MAX30102DeadlineMisses, pulseOxiMeterPeriod);
+	DeadlineMonitor ecgDeadline("ADS1299", util::Metric::ADS1299DeadlineMisses, ecgFramePeriod);
+	DeadlineMonitor imuDeadline("BHI160", util::Metric::BHI160DeadlineMisses, imuPeriod);
+	DeadlineMonitor adcDeadline("MCP3561", util::Metric::MCP3561DeadlineMisses, ADC_PERIOD);
+	// Timebase: Every sample is stamped with the esp_timer time of its data ready assertion.
+	mem::RingBuffer::time_us pulseOxiMeterTimestamps[config::MAX30102::SAMPLES_IN_RING_BUFFER];
+	mem::RingBuffer::time_us ecgTimestamps[config::ADS1299::ECG_SAMPLES_IN_RING_BUFFER];
+	mem::RingBuffer::time_us imuTimestamps[config::BHI160::SAMPLES_IN_RING_BUFFER];
+	DriftEstimator pulseOxiMeterDrift(util::Metric::MAX30102ClockDrift, pulseOxiMeterPeriod);
+	DriftEstimator ecgDrift(util::Metric::ADS1299ClockDrift, ecgPeriod);
+	// The ADS1299 has no FIFO: A frame, which isn't read within its period, is overwritten.
+	MissedFrameCounter ecgMissedFrames(util::Metric::ADS1299MissedFrames, ecgFramePeriod);
+	// ADS1299 front end: Detached electrodes from the status word of every frame and a periodic noise capture
+	file::LeadOffTracker ecgLeadOff("ADS1299", config::ADS1299::LEAD_OFF_HOLD_MS * 1'000ll);
+	int64_t              ecgNextNoiseCapture = 0;
+	// Optional processing of the ADS1299 channels (ECG_FILTERING, QRS_DETECTION)
+	dsp::ECGFilter           ecgFilter;
+	HeartRateMonitor         heartRate;
+	mem::RingBuffer::time_us heartRateTimestamps[config::HeartRate::SAMPLES_IN_RING_BUFFER];
+	// Optional processing of the MAX30102 channels (SPO2_ESTIMATION)
+	OximetryMonitor          oximetry;
+	mem::RingBuffer::time_us oximetryTimestamps[config::Oximetry::SAMPLES_IN_RING_BUFFER];
+	DriftEstimator imuDrift(util::Metric::BHI160ClockDrift, imuPeriod);
+	// BDF headers. They are rebuilt, whenever a session changes the rates or channels.
+	file::bdf_signal_header_t adsHeaders[config::ADS1299::CHANNEL_COUNT];
+	file::bdf_signal_header_t pulseOxiMeterHeaders[config::MAX30102::CHANNEL_COUNT];
+	file::bdf_signal_header_t imuHeaders[config::BHI160::CHANNEL_COUNT];
+	file::bdf_signal_header_t heartRateHeaders[config::HeartRate::CHANNEL_COUNT];
+	file::bdf_signal_header_t oximetryHeaders[config::Oximetry::CHANNEL_COUNT];
+	// Session configuration: Written by configure_session, applied by the sensor control task. The sample rates are
+	// programmed by the acquisition task of each bus, so no transfer of a read is interrupted.
+	net::SessionConfig activeSession  = net::SessionConfig::Defaults();
+	net::SessionConfig pendingSession = net::SessionConfig::Defaults();
+	bool               isSessionApplied = false;
+	bool               isSPISessionApplied = false; // Written by the SPI acquisition task before it sets its session event
+	bool               isI2CSessionApplied = false; // Written by the I2C acquisition task before it sets its session event
+	StaticSemaphore_t  sessionAppliedBuffer;
+	SemaphoreHandle_t  sessionApplied = nullptr; // Created by the sensor control task
+	StaticEventGroup_t sessionEventsBuffer;
+	EventGroupHandle_t sessionEvents  = nullptr; // Created by the sensor control task
+
+	/**
+	 * \brief Installs the data ready line of a sensor. Synthetic sensors are asserted by a timer instead of their pin.
+	 */
+	void install_line(DataReadyLine& line, TaskHandle_t task)
 	{
-		pulseOxiMeter.Init();
-		return xTimerCreate("Oxi timer", 
-							sample_rate_to_ticks(config::MAX30102::SAMPLE_RATE),
-							true, 
-							nullptr, 
-							oxi_meter_timer_callback);
+#if USE_SYNTHETIC_SENSORS
+		DISCARD line.InstallTimer(task, config::Synthetic::TICK_US);
+#else
+		DISCARD line.Install(task);
+#endif
 	}
 
-	uint32_t ecg_count = 0;
-	void ecg_timer_callback(TimerHandle_t)
+	void init_pulse_oximeter()
 	{
-		xEventGroupSetBits(config::SensorControlEventGroup, SensorControlEvent::ElectrocardiogramReady);
+		const util::BootProfile::Scope profile("MAX30102");
+		pulseOxiMeter.Init();
+		annotate_reset("MAX30102");
+		if constexpr(USE_SYNTHETIC_SENSORS || config::MAX30102::INTERRUPT_PIN_VERIFIED)
+		{
+			install_line(pulseOxiMeterLine, config::I2CAcquisition);
+		}
+		else
+		{
+			DISCARD pulseOxiMeterLine.InstallTimer(config::I2CAcquisition, config::MAX30102::POLL_PERIOD_US);
+		}
 	}
 
-	TimerHandle_t create_ecg_timer()
+	void init_ecg()
 	{
+		const util::BootProfile::Scope profile("ADS1299");
+		if constexpr(ECG_FILTERING)
+		{
+			DISCARD dsp::ECGFilter::SelfTest();
+		}
+		if constexpr(config::ADS1299::BENCHMARK_DECIMATION)
+		{
+			dsp::benchmark_decimators<config::ADS1299::DECIMATION_TAPS_PER_PHASE, config::ADS1299::CHANNEL_COUNT>([] { return esp_cpu_get_cycle_count(); }, [](size_t ratio, double cycles)
+			{
+				PRINTI(SENSOR_CONTROL_TAG, "Decimation 1:%u: %.0f cycles per sample and channel\n", static_cast<unsigned>(ratio), cycles);
+			});
+		}
 		ecg.Init();
-		return xTimerCreate("ECG timer", 
-							sample_rate_to_ticks(config::ADS1299::SAMPLE_RATE), 
-							true, 
-							nullptr, 
-							ecg_timer_callback);
+		annotate_reset("ADS1299");
+		install_line(ecgLine, config::SPIAcquisition);
 	}
 
-	uint32_t imu_count = 0;
-	void imu_timer_callback(TimerHandle_t)
+	void init_imu()
 	{
-		xEventGroupSetBits(config::SensorControlEventGroup, SensorControlEvent::InertialMeasurementUnitReady);
+		const util::BootProfile::Scope profile("BHI160");
+		imu.Init();
+		annotate_reset("BHI160");
+		install_line(imuLine, config::I2CAcquisition);
 	}
 
-	TimerHandle_t create_imu_timer()
+	void init_adc()
 	{
-		imu.Init();
-		return xTimerCreate("IMU timer", 
-							sample_rate_to_ticks(config::BHI160::SAMPLE_RATE), 
-							true, 
-							nullptr, 
-							imu_timer_callback);
+		const util::BootProfile::Scope profile("MCP3561");
+		adc.Init();
+		install_line(adcLine, config::SPIAcquisition);
+	}
+
+	/**
+	 * \brief Stamps the samples of the current read with the assertion time of 'line'.
+	 */
+	void stamp(mem::RingBuffer* buffer, DataReadyLine const& line, DriftEstimator& drift, int64_t period, util::TraceSource source)
+	{
+		const int64_t assertedAt = line.AssertedAt();
+		buffer->Stamp(assertedAt, period);
+		drift.Update(assertedAt, buffer->Written());
+		util::gTrace.Record(util::TraceEvent::RingWrite, source, static_cast<uint16_t>(buffer->Written()));
+	}
+
+	void mark_first_sample(bool& isMarked, const ascii_t* stage)
+	{
+		if(isMarked) return;
+		util::gBootProfile.Mark(stage);
+		isMarked = true;
 	}
 
-	uint32_t adc_count = 0;
-	void adc_timer_callback(TimerHandle_t h)
+	/**
+	 * \brief Feeds the samples written since 'firstNode' into the oximetry monitor. The ones before 'written' are
+	 * padding. Runs after the stamp, so it sees the sent samples at their time.
+	 */
+	void estimate_oximetry(mem::RingBuffer::size_type firstNode, mem::RingBuffer::size_type written)
 	{
-		if(adc.HasData())
+		mem::RingBuffer* buffer     = pulseOxiMeter.RingBuffer();
+		const auto       samples    = buffer->Written() - firstNode;
+		const auto       padding    = written - firstNode;
+		const int64_t    assertedAt = pulseOxiMeterLine.AssertedAt();
+		const uint32_t   start      = esp_cpu_get_cycle_count();
+		for(auto age = samples; age; --age)
 		{
-			adc.CaptureData();
+			const auto* sample = static_cast<const mem::int24_t*>(buffer->WrittenNode(age)); // Red, infrared
+			oximetry.Process(static_cast<int32_t>(sample[0]), static_cast<int32_t>(sample[1]),
+							 assertedAt - static_cast<int64_t>(age - 1) * pulseOxiMeterPeriod, samples - age < padding);
 		}
-		else
+		const uint32_t cycles = esp_cpu_get_cycle_count() - start;
+		if(samples)
 		{
-			adc.InsertPadding();
+			util::gMetrics.Set(util::Metric::SpO2Cycles, static_cast<util::Metrics::value_type>(cycles / samples));
 		}
 	}
 
-	TimerHandle_t create_adc_timer()
+	void read_pulse_oximeter()
 	{
-		adc.Init();
-		return xTimerCreate("ADC timer", 
-							sample_rate_to_ticks(config::MCP3561::SAMPLE_RATE), 
-							true, 
-							nullptr, 
-							adc_timer_callback);
+		const util::TraceScope trace(util::TraceEvent::ReadBegin, util::TraceEvent::ReadEnd, util::TraceSource::MAX30102);
+		pulseOxiMeterDeadline.Check(pulseOxiMeterLine);
+		const auto firstNode = pulseOxiMeter.RingBuffer()->Written();
+		// Two transactions per interrupt: The status with the FIFO pointers, then all pending samples in one burst. Pad
+		// the samples which were lost by an overflow of the sensor FIFO, before the remaining ones.
+		for(uint32_t lostSamples = pulseOxiMeter.ReadStatus(); lostSamples; --lostSamples)
+		{
+			pulseOxiMeter.InsertPadding();
+			util::gMetrics.Add(util::Metric::MAX30102Padding);
+		}
+		const auto written = pulseOxiMeter.RingBuffer()->Written();
+		DISCARD pulseOxiMeter.ReadData();
+		stamp(pulseOxiMeter.RingBuffer(), pulseOxiMeterLine, pulseOxiMeterDrift, pulseOxiMeterPeriod, util::TraceSource::MAX30102);
+		util::gMetrics.Set(util::Metric::MAX30102Samples, pulseOxiMeter.RingBuffer()->Written());
+		if constexpr(SPO2_ESTIMATION)
+		{
+			estimate_oximetry(firstNode, written);
+		}
+		static bool isFirstSampleMarked = false;
+		mark_first_sample(isFirstSampleMarked, "First MAX30102 sample");
+		pulseOxiMeterLine.Rearm();
+	}
+
+	/**
+	 * \brief Reports the RMS noise of the enabled channels in the last input-shorted capture. The worst channel is
+	 * annotated and exported in nV.
+	 */
+	void report_ecg_noise()
+	{
+		mem::RingBuffer* noise  = ecg.NoiseRingBuffer();
+		const auto       frames = noise->Size();
+		if(frames < 2) return;
+
+		const auto channelMask  = ecg.ECGRingBuffer()->ChannelMask();
+		float      worstNoise   = 0.f; // in nV
+		size_t     worstChannel = 0;
+		for(size_t channel = 0; channel < config::ADS1299::CHANNEL_COUNT; channel++)
+		{
+			if(!(channelMask & (1u << channel))) continue;
+
+			int64_t sum        = 0;
+			int64_t sumSquares = 0;
+			for(mem::RingBuffer::size_type frame = 0; frame < frames; frame++)
+			{
+				const auto value = static_cast<int32_t>(static_cast<const mem::int24_t*>(noise->NodeAt(frame))[channel]);
+				sum        += value;
+				sumSquares += static_cast<int64_t>(value) * value;
+			}
+			const float variance = static_cast<float>(sumSquares - sum * sum / frames) / frames;
+			const auto  gain     = config::ADS1299::GAIN_FACTORS[util::to_underlying(config::ADS1299::CHANNELS[channel % config::ADS1299::CHANNELS_PER_CHIP].gain)];
+			const float lsb      = 2.f * config::ADS1299::REFERENCE_VOLTAGE / gain / (1 << 24) * 1e9f;
+			const float rms      = std::sqrt(variance) * lsb;
+			if(rms >= worstNoise)
+			{
+				worstNoise   = rms;
+				worstChannel = channel;
+			}
+		}
+		noise->ReadAdvance(frames);
+
+		util::gMetrics.Set(util::Metric::ADS1299Noise, static_cast<util::Metrics::value_type>(worstNoise));
+		ascii_t text[config::Annotations::MAX_TEXT_LENGTH];
+		DISCARD std::snprintf(text, std::size(text), "ADS1299 Ch%u %.2f uVrms", static_cast<unsigned>(worstChannel + 1), worstNoise / 1'000.f);
+		DISCARD file::gAnnotations.Push(file::AnnotationWriter::Kind::Noise, esp_timer_get_time(), 0, text);
 	}
 
-	void sensor_control_task(WRITE_ONLY void* outView)
+	/**
+	 * \brief Tracks the detached electrodes and starts a noise capture every NOISE_PERIOD_MS. Both skip the frames of a
+	 * running capture, whose inputs are shorted.
+	 */
+	void check_ecg_front_end(bool wasCapturingNoise)
 	{
-		ioExpander.Init();
-		touchScreenController.Init();
+		if(wasCapturingNoise)
+		{
+			if(!ecg.IsCapturingNoise()) report_ecg_noise();
+			return;
+		}
+
+		const int64_t assertedAt = ecgLine.AssertedAt();
+		util::gMetrics.Set(util::Metric::ADS1299LeadOff, static_cast<util::Metrics::value_type>(ecg.LeadOff()));
+		ecgLeadOff.Update(ecg.LeadOff(), assertedAt);
+		if(assertedAt >= ecgNextNoiseCapture && ecg.StartNoiseCapture())
+		{
+			ecgNextNoiseCapture = assertedAt + config::ADS1299::NOISE_PERIOD_MS * 1'000ll;
+		}
+	}
+
+	/**
+	 * \brief Filters the samples written since 'written' in place. They aren't stamped yet, so the transmitter never
+	 * sees raw samples. Padding isn't filtered.
+	 */
+	void filter_ecg(mem::RingBuffer::size_type written)
+	{
+		mem::RingBuffer* buffer  = ecg.ECGRingBuffer();
+		const auto       samples = buffer->Written() - written;
+		const auto       mask    = buffer->ChannelMask();
+		const uint32_t   start   = esp_cpu_get_cycle_count();
+		for(auto age = samples; age; --age)
+		{
+			ecgFilter.Process(static_cast<mem::int24_t*>(buffer->WrittenNode(age)), mask);
+		}
+		const uint32_t cycles = esp_cpu_get_cycle_count() - start;
+		if(samples && buffer->EnabledChannelCount())
+		{
+			util::gMetrics.Set(util::Metric::ECGFilterCycles, static_cast<util::Metrics::value_type>(cycles / (samples * buffer->EnabledChannelCount())));
+		}
+	}
+
+	/**
+	 * \brief Feeds the samples written since 'firstNode' into the heart rate monitor. The ones before 'written' and
+	 * all of them, if the read failed, are padding. Runs after the filter and the stamp, so it sees the sent samples at
+	 * their time.
+	 */
+	void detect_beats(mem::RingBuffer::size_type firstNode, mem::RingBuffer::size_type written, bool isSample)
+	{
+		mem::RingBuffer* buffer     = ecg.ECGRingBuffer();
+		const auto       samples    = buffer->Written() - firstNode;
+		const auto       padding    = isSample ? written - firstNode : samples;
+		const int64_t    assertedAt = ecgLine.AssertedAt();
+		const uint32_t   start      = esp_cpu_get_cycle_count();
+		for(auto age = samples; age; --age)
+		{
+			const auto sample = static_cast<const mem::int24_t*>(buffer->WrittenNode(age))[config::HeartRate::CHANNEL];
+			heartRate.Process(static_cast<int32_t>(sample), assertedAt - static_cast<int64_t>(age - 1) * ecgPeriod, samples - age < padding);
+		}
+		const uint32_t cycles = esp_cpu_get_cycle_count() - start;
+		if(samples)
+		{
+			util::gMetrics.Set(util::Metric::QRSCycles, static_cast<util::Metrics::value_type>(cycles / samples));
+		}
+	}
 
-		// Create Event Group
-		StaticEventGroup_t eventGroup;
-		config::SensorControlEventGroup = xEventGroupCreateStatic(&eventGroup);
-		configASSERT(config::SensorControlEventGroup);
+	void read_ecg()
+	{
+		const util::TraceScope trace(util::TraceEvent::ReadBegin, util::TraceEvent::ReadEnd, util::TraceSource::ADS1299);
+		ecgDeadline.Check(ecgLine);
+		const auto firstNode = ecg.ECGRingBuffer()->Written();
+		if constexpr(!USE_SYNTHETIC_SENSORS)
+		{
+			// Pad the overwritten frames, so the following samples keep their place on the timeline.
+			for(uint32_t missedFrames = ecgMissedFrames.Check(ecgLine); missedFrames; --missedFrames)
+			{
+				ecg.InsertPadding();
+			}
+		}
+		// The frames of a noise capture are padded on purpose.
+		const bool isCapturingNoise = ecg.IsCapturingNoise();
+		const auto written          = ecg.ECGRingBuffer()->Written();
+		const bool isSample         = ecg.CaptureData();
+		if(isSample)
+		{
+			if constexpr(ECG_FILTERING)
+			{
+				filter_ecg(written);
+			}
+		}
+		else if(!isCapturingNoise)
+		{
+			util::gMetrics.Add(util::Metric::ADS1299MissedFrames);
+		}
+		check_ecg_front_end(isCapturingNoise);
+		// With oversampling only every DECIMATION-th frame writes a sample. It's stamped with the assertion of that frame.
+		if(ecg.ECGRingBuffer()->Written() != firstNode)
+		{
+			if constexpr(config::ADS1299::DECIMATION > 1)
+			{
+				util::gMetrics.Set(util::Metric::DecimatorCycles, ecg.DecimationCycles());
+			}
+			stamp(ecg.ECGRingBuffer(), ecgLine, ecgDrift, ecgPeriod, util::TraceSource::ADS1299);
+			util::gMetrics.Set(util::Metric::ADS1299Samples, ecg.ECGRingBuffer()->Written());
+			static bool isFirstSampleMarked = false;
+			mark_first_sample(isFirstSampleMarked, "First ADS1299 sample");
+			if constexpr(QRS_DETECTION)
+			{
+				detect_beats(firstNode, written, isSample);
+			}
+		}
+		ecgLine.Rearm();
+	}
 
-		// Create Timers
-		const std::array timers = 
+	void read_imu()
+	{
+		const util::TraceScope trace(util::TraceEvent::ReadBegin, util::TraceEvent::ReadEnd, util::TraceSource::BHI160);
+		imuDeadline.Check(imuLine);
+		while(imu.HasData())
 		{
-			create_oxi_meter_timer(),
-			create_ecg_timer(),
-			create_imu_timer(),
+			imu.GetData();
+		}
+		util::gMetrics.Set(util::Metric::BHI160FIFOLevel, imu.FIFOLevel());
+		stamp(imu.RingBuffer(), imuLine, imuDrift, imuPeriod, util::TraceSource::BHI160);
+		util::gMetrics.Set(util::Metric::BHI160Samples, imu.RingBuffer()->Written());
+		static bool isFirstSampleMarked = false;
+		mark_first_sample(isFirstSampleMarked, "First BHI160 sample");
+		imuLine.Rearm();
+	}
+
+	void read_adc()
+	{
+		const util::TraceScope trace(util::TraceEvent::ReadBegin, util::TraceEvent::ReadEnd, util::TraceSource::MCP3561);
+		adcDeadline.Check(adcLine);
+		adc.CaptureData();
+		util::gMetrics.Set(util::Metric::MCP3561Samples, adc.RingBuffer()->Written());
+		static bool isFirstSampleMarked = false;
+		mark_first_sample(isFirstSampleMarked, "First MCP3561 sample");
+		adcLine.Rearm();
+	}
+
+	/**
+	 * \brief Programs the pending sample rate of a sensor, unless it is already running. A sensor which rejects the rate
+	 * keeps the previous one, so the headers are built from the rates which are actually running.
+	 */
+	template<typename SetRate>
+	bool apply_sample_rate(net::SessionConfig::Sensor sensor, SetRate setRate)
+	{
+		net::SessionConfig::sensor&       pending = pendingSession.sensors[sensor];
+		net::SessionConfig::sensor const& active  = activeSession.sensors[sensor];
+		if(pending.sampleRate == active.sampleRate || setRate(pending.sampleRate)) return true;
+		pending.sampleRate = active.sampleRate;
+		return false;
+	}
+
+	void apply_spi_session()
+	{
+		isSPISessionApplied = apply_sample_rate(net::SessionConfig::Sensor::ADS1299, [](size_t rate) { return ecg.SetSampleRate(rate); });
+		DISCARD xEventGroupSetBits(sessionEvents, SessionEvent::SPIRatesApplied);
+	}
+
+	void apply_i2c_session()
+	{
+		const bool isOximeterApplied = apply_sample_rate(net::SessionConfig::Sensor::MAX30102, [](size_t rate) { return pulseOxiMeter.SetSampleRate(rate); });
+		DISCARD apply_sample_rate(net::SessionConfig::Sensor::BHI160, [](size_t rate) { imu.SetSampleRate(static_cast<uint16_t>(rate)); return true; });
+		isI2CSessionApplied = isOximeterApplied;
+		DISCARD xEventGroupSetBits(sessionEvents, SessionEvent::I2CRatesApplied);
+	}
+
+	/**
+	 * \brief Initializes the sensors on the SPI bus and reads them, whenever their data ready line is asserted.
+	 */
+	void spi_acquisition_task(void* bootEvents)
+	{
+		init_ecg();
+		//init_adc();
+		DISCARD xEventGroupSetBits(static_cast<EventGroupHandle_t>(bootEvents), BootEvent::SPIDevicesReady);
+
+		while(true)
+		{
+			uint32_t bits = 0;
+			DISCARD xTaskNotifyWait(0, SensorControlEvent::Any, &bits, portMAX_DELAY);
+			util::gTrace.Record(util::TraceEvent::TaskWake, util::TraceSource::SPIAcquisition);
+			if(bits & SensorControlEvent::ElectrocardiogramReady)
+			{
+				read_ecg();
+			}
+			if(bits & SensorControlEvent::AnalogDigitalConverterReady)
+			{
+				read_adc();
+			}
+			if(bits & SensorControlEvent::ApplySession)
+			{
+				apply_spi_session();
+			}
+		}
+	}
+
+	/**
+	 * \brief Initializes the devices on the I2C bus and reads the sensors, whenever their data ready line is asserted.
+	 */
+	void i2c_acquisition_task(void* bootEvents)
+	{
+		// The IO expander and the touch screen controller have no synthetic replacement.
+		if constexpr(!USE_SYNTHETIC_SENSORS)
+		{
+			{
+				const util::BootProfile::Scope profile("PCF8574");
+				ioExpander.Init();
+			}
+			{
+				const util::BootProfile::Scope profile("TSC2003");
+				touchScreenController.Init();
+			}
+		}
+		init_pulse_oximeter();
+		init_imu();
+		DISCARD xEventGroupSetBits(static_cast<EventGroupHandle_t>(bootEvents), BootEvent::I2CDevicesReady);
+
+		while(true)
+		{
+			uint32_t bits = 0;
+			DISCARD xTaskNotifyWait(0, SensorControlEvent::Any, &bits, portMAX_DELAY);
+			util::gTrace.Record(util::TraceEvent::TaskWake, util::TraceSource::I2CAcquisition);
+			if(bits & SensorControlEvent::PulseOximeterReady)
+			{
+				read_pulse_oximeter();
+			}
+			if(bits & SensorControlEvent::InertialMeasurementUnitReady)
+			{
+				read_imu();
+			}
+			if(bits & SensorControlEvent::ApplySession)
+			{
+				apply_i2c_session();
+			}
+		}
+	}
+
+	/**
+	 * \brief Applies the session settings of one sensor to its timing and its ring buffer. The BDF headers are only
+	 * valid for the enabled channels and the samples of the new rate in a record.
+	 */
+	template<typename DeviceType, size_t Count>
+	void apply_session(net::SessionConfig::sensor const& settings, mem::RingBuffer* buffer, file::bdf_signal_header_t(&headers)[Count],
+					   int64_t& period, DeadlineMonitor& deadline, DriftEstimator& drift)
+	{
+		const uint32_t nodesInBDFRecord = config::nodes_in_bdf_record(settings.sampleRate);
+		file::createBDFHeader<DeviceType>(headers, nodesInBDFRecord, settings.channelMask);
+		buffer->SetBDF(headers, nodesInBDFRecord, settings.channelMask);
+		buffer->Reset();
+		period = 1'000'000 / settings.sampleRate;
+		deadline.SetDeadline(period);
+		drift.SetPeriod(period);
+	}
+
+	/**
+	 * \brief Hands the sample rates of 'pendingSession' to the acquisition tasks, which program them between two reads
+	 * on their bus, and waits for both. Then the timing and the ring buffers follow the rates which are running.
+	 */
+	bool apply_pending_session()
+	{
+		using Sensor = net::SessionConfig::Sensor;
+		net::SessionConfig::sensor (&pending)[Sensor::Count] = pendingSession.sensors;
+		net::SessionConfig::sensor (&active)[Sensor::Count]  = activeSession.sensors;
+
+		DISCARD xEventGroupClearBits(sessionEvents, SessionEvent::All);
+		DISCARD xTaskNotify(config::SPIAcquisition, SensorControlEvent::ApplySession, eSetBits);
+		DISCARD xTaskNotify(config::I2CAcquisition, SensorControlEvent::ApplySession, eSetBits);
+		DISCARD xEventGroupWaitBits(sessionEvents, SessionEvent::All, pdTRUE, pdTRUE, portMAX_DELAY);
+		const bool isApplied = isSPISessionApplied && isI2CSessionApplied;
+		pending[Sensor::ADS1299].channelMask &= ecg.AvailableChannels();
+		activeSession = pendingSession;
+
+		apply_session<config::MAX30102>(active[Sensor::MAX30102], pulseOxiMeter.RingBuffer(), pulseOxiMeterHeaders, pulseOxiMeterPeriod, pulseOxiMeterDeadline, pulseOxiMeterDrift);
+		apply_session<config::ADS1299>(active[Sensor::ADS1299], ecg.ECGRingBuffer(), adsHeaders, ecgPeriod, ecgDeadline, ecgDrift);
+		DISCARD ecgFilter.SetSampleRate(active[Sensor::ADS1299].sampleRate);
+		if constexpr(QRS_DETECTION)
+		{
+			// The heart rate has a fixed rate. Only its channel follows the session.
+			DISCARD heartRate.SetSampleRate(active[Sensor::ADS1299].sampleRate);
+			file::createBDFHeader<config::HeartRate>(heartRateHeaders, config::HeartRate::NODES_IN_BDF_RECORD, active[Sensor::HeartRate].channelMask);
+			heartRate.RingBuffer()->SetBDF(heartRateHeaders, config::HeartRate::NODES_IN_BDF_RECORD, active[Sensor::HeartRate].channelMask);
+		}
+		if constexpr(SPO2_ESTIMATION)
+		{
+			// Same as the heart rate: A fixed rate, only the channels follow the session.
+			DISCARD oximetry.SetSampleRate(active[Sensor::MAX30102].sampleRate);
+			file::createBDFHeader<config::Oximetry>(oximetryHeaders, config::Oximetry::NODES_IN_BDF_RECORD, active[Sensor::Oximetry].channelMask);
+			oximetry.RingBuffer()->SetBDF(oximetryHeaders, config::Oximetry::NODES_IN_BDF_RECORD, active[Sensor::Oximetry].channelMask);
+		}
+		ecgFramePeriod = ecgPeriod / config::ADS1299::DECIMATION;
+		ecgDeadline.SetDeadline(ecgFramePeriod);
+		ecgMissedFrames.SetPeriod(ecgFramePeriod);
+		apply_session<config::BHI160>(active[Sensor::BHI160], imu.RingBuffer(), imuHeaders, imuPeriod, imuDeadline, imuDrift);
+		gHealthMonitor.SetExpectedRate(HealthMonitor::MAX30102, active[Sensor::MAX30102].sampleRate);
+		gHealthMonitor.SetExpectedRate(HealthMonitor::ADS1299, active[Sensor::ADS1299].sampleRate);
+		gHealthMonitor.SetExpectedRate(HealthMonitor::BHI160, active[Sensor::BHI160].sampleRate);
+		PRINTI(SENSOR_CONTROL_TAG, "Session: MAX30102 %lu SPS, ADS1299 %lu SPS, BHI160 %lu SPS\n",
+			   static_cast<unsigned long>(active[Sensor::MAX30102].sampleRate),
+			   static_cast<unsigned long>(active[Sensor::ADS1299].sampleRate),
+			   static_cast<unsigned long>(active[Sensor::BHI160].sampleRate));
+		return isApplied;
+	}
+
+	bool configure_session(net::SessionConfig const& session)
+	{
+		pendingSession = session;
+		DISCARD xTaskNotify(config::SensorControl, SensorControlEvent::Reconfigure, eSetBits);
+		DISCARD xSemaphoreTake(sessionApplied, portMAX_DELAY);
+		return isSessionApplied;
+	}
+
+	bool create_acquisition_task(TaskFunction_t task, const char* name, uint32_t stackSize, uint32_t priority, EventGroupHandle_t bootEvents, TaskHandle_t* handle)
+	{
+#if PIN_ACQUISITION
+		const BaseType_t result = xTaskCreatePinnedToCore(task, name, stackSize, bootEvents, priority, handle, config::ACQUISITION_TASK_CORE);
+#else
+		const BaseType_t result = xTaskCreate(task, name, stackSize, bootEvents, priority, handle);
+#endif
+		if(result != pdPASS)
+		{
+			PRINTI(SENSOR_CONTROL_TAG, "Unable to create the %s.\n", name);
+			return false;
+		}
+		return true;
+	}
+
+	void sensor_control_task(void*)
+	{
+		// One task per bus: Sensors on different buses don't wait for each other and the faster bus preempts the slower one.
+		// Both initialize their devices first, so the settle delays of one bus overlap with the transfers on the other.
+		// Each sensor signals the task of its bus directly through its data ready line.
+		const EventGroupHandle_t bootEvents = xEventGroupCreate();
+		assert(bootEvents && "[Sensor Control:] **Fatal** Could not allocate the boot event group!");
+		sessionApplied = xSemaphoreCreateBinaryStatic(&sessionAppliedBuffer);
+		sessionEvents  = xEventGroupCreateStatic(&sessionEventsBuffer);
+		DISCARD create_acquisition_task(spi_acquisition_task, "SPIAcquisitionTask", config::SPI_ACQUISITION_TASK_STACK_SIZE, config::SPI_ACQUISITION_TASK_PRIORITY, bootEvents, &config::SPIAcquisition);
+		DISCARD create_acquisition_task(i2c_acquisition_task, "I2CAcquisitionTask", config::I2C_ACQUISITION_TASK_STACK_SIZE, config::I2C_ACQUISITION_TASK_PRIORITY, bootEvents, &config::I2CAcquisition);
+		DISCARD xEventGroupWaitBits(bootEvents, BootEvent::All, pdFALSE, pdTRUE, portMAX_DELAY);
+		vEventGroupDelete(bootEvents);
+
+		// Poll the devices without a usable data ready line.
+		DISCARD gScheduler.Start();
+		if constexpr(!USE_SYNTHETIC_SENSORS)
+		{
+			DISCARD gScheduler.Add("TSC2003", config::TSC2003::POLL_PERIOD_US, [](void*) { touchScreenController.Handler(); });
+			DISCARD gScheduler.Add("PCF8574", config::PCFB574::POLL_PERIOD_US, [](void*) { ioExpander.PollTransferData(); });
+		}
+		DISCARD gHealthMonitor.Start(config::Health::PERIOD_MS);
+
+		const std::array lines = 
+		{
+			&pulseOxiMeterLine,
+			&ecgLine,
+			&imuLine,
+			//&adcLine,
+		};
+		const std::array drifts =
+		{
+			&pulseOxiMeterDrift,
+			&ecgDrift,
+			&imuDrift,
 		};
-		//timers[3] = create_adc_timer();
 
 		// Create Sensor View
 		mem::RingBufferView::handle sensorBuffers[] =
@@ -145,79 +698,94 @@ namespace sys
 			ecg.ECGRingBuffer(),
 			imu.RingBuffer(),
 			//adc.RingBuffer(),
+#if QRS_DETECTION
+			heartRate.RingBuffer(),
+#endif
+#if SPO2_ESTIMATION
+			oximetry.RingBuffer(),
+#endif
 		};
+		static_assert(std::size(sensorBuffers) == config::BDF::SENSOR_BUFFERS);
 		mem::RingBufferView ringBufferView = mem::RingBufferView(sensorBuffers, std::size(sensorBuffers));
 
-		// Create BDF Headers
-		file::bdf_signal_header_t adsHeaders[config::ADS1299::CHANNEL_COUNT];
-		file::bdf_signal_header_t pulseOxiMeterHeaders[config::MAX30102::CHANNEL_COUNT];
-		file::bdf_signal_header_t imuHeaders[config::BHI160::CHANNEL_COUNT];
-		file::createBDFHeader<config::ADS1299>(adsHeaders);
+		// Create BDF Headers. Only the channels of the chained ADS1299s, which answered, are sent.
+		using Sensor = net::SessionConfig::Sensor;
+		activeSession.sensors[Sensor::ADS1299].channelMask &= ecg.AvailableChannels();
+		pendingSession = activeSession;
+		file::createBDFHeader<config::ADS1299>(adsHeaders, config::ADS1299::NODES_IN_BDF_RECORD, activeSession.sensors[Sensor::ADS1299].channelMask);
 		file::createBDFHeader<config::MAX30102>(pulseOxiMeterHeaders);
 		file::createBDFHeader<config::BHI160>(imuHeaders);
 		sensorBuffers[0]->SetBDF(pulseOxiMeterHeaders, config::MAX30102::NODES_IN_BDF_RECORD);
-		sensorBuffers[1]->SetBDF(adsHeaders, config::ADS1299::NODES_IN_BDF_RECORD);
+		sensorBuffers[1]->SetBDF(adsHeaders, config::ADS1299::NODES_IN_BDF_RECORD, activeSession.sensors[Sensor::ADS1299].channelMask);
 		sensorBuffers[2]->SetBDF(imuHeaders, config::BHI160::NODES_IN_BDF_RECORD);
+		sensorBuffers[0]->SetTimestamps(pulseOxiMeterTimestamps);
+		sensorBuffers[1]->SetTimestamps(ecgTimestamps);
+		sensorBuffers[2]->SetTimestamps(imuTimestamps);
+		sensorBuffers[2]->SetHeldChannels(config::BHI160::HELD_CHANNELS);
+		if constexpr(QRS_DETECTION)
+		{
+			file::createBDFHeader<config::HeartRate>(heartRateHeaders);
+			heartRate.RingBuffer()->SetBDF(heartRateHeaders, config::HeartRate::NODES_IN_BDF_RECORD);
+			heartRate.RingBuffer()->SetTimestamps(heartRateTimestamps);
+			heartRate.RingBuffer()->SetHeldChannels(config::HeartRate::HELD_CHANNELS);
+		}
+		if constexpr(SPO2_ESTIMATION)
+		{
+			file::createBDFHeader<config::Oximetry>(oximetryHeaders);
+			oximetry.RingBuffer()->SetBDF(oximetryHeaders, config::Oximetry::NODES_IN_BDF_RECORD);
+			oximetry.RingBuffer()->SetTimestamps(oximetryTimestamps);
+			oximetry.RingBuffer()->SetHeldChannels(config::Oximetry::HELD_CHANNELS);
+		}
 
-		// Pass back ring buffer.
-		*static_cast<mem::RingBufferView*>(outView) = ringBufferView;
+		// Pass the ring buffers to the transmitter.
+		gStartup.PublishView(ringBufferView);
 
-		auto startTimer = [&]
+		auto startMeasurement = [&]
 		{
 			ringBufferView.ResetAll();
-			std::ranges::for_each(timers, [](TimerHandle_t const& timer)
-			{
-				if(!xTimerStart(timer, NO_DELAY))
-				{
-					PRINTI(SENSOR_CONTROL_TAG, "Unable to start timer '%s'.", pcTimerGetName(timer));
-				}
-			});
+			std::ranges::for_each(drifts, [](DriftEstimator* drift) { drift->Reset(); });
+			ecgMissedFrames.Reset();
+			ecgLeadOff.Reset();
+			ecgFilter.Reset();
+			heartRate.Reset();
+			oximetry.Reset();
+			ecgNextNoiseCapture = esp_timer_get_time() + config::ADS1299::NOISE_PERIOD_MS * 1'000ll;
+			annotate_sample_rate("MAX30102", activeSession.sensors[Sensor::MAX30102].sampleRate);
+			annotate_sample_rate("ADS1299", activeSession.sensors[Sensor::ADS1299].sampleRate);
+			annotate_sample_rate("BHI160", activeSession.sensors[Sensor::BHI160].sampleRate);
+			std::ranges::for_each(lines, [](DataReadyLine* line) { line->Enable(); });
+			gHealthMonitor.Enable();
 		};
-		auto stopTimer = [&]
+		auto stopMeasurement = [&]
 		{
-			std::ranges::for_each(timers, [](TimerHandle_t const& timer)
-			{
-				if(!xTimerStop(timer, NO_DELAY))
-				{
-					PRINTI(SENSOR_CONTROL_TAG, "Unable to stop timer '%s'.", pcTimerGetName(timer));
-				}
-			});
+			gHealthMonitor.Disable();
+			std::ranges::for_each(lines, [](DataReadyLine* line) { line->Disable(); });
 		};
 
 		/**
 		 * \brief Sensor control loop
 		 */
-		bool isMeasuring = true;
 		while (true)
 		{
-			// Check for events
-			EventBits_t bits = xEventGroupWaitBits(config::SensorControlEventGroup, SensorControlEvent::Any, true, false, portMAX_DELAY);
+			// Wait for commands
+			uint32_t bits = 0;
+			DISCARD xTaskNotifyWait(0, SensorControlEvent::StartMeasurement | SensorControlEvent::StopMeasurement | SensorControlEvent::Reconfigure, &bits, portMAX_DELAY);
+			util::gTrace.Record(util::TraceEvent::TaskWake, util::TraceSource::SensorControl);
 
-			if(bits & SensorControlEvent::StartMeasurement)
+			// Stop before a reconfiguration and start after it, so no sensor is read while its rate changes.
+			if(bits & (SensorControlEvent::StopMeasurement | SensorControlEvent::Reconfigure))
 			{
-				startTimer();
+				stopMeasurement();
 			}
-			if(bits & SensorControlEvent::StopMeasurement)
-			{
-				stopTimer();
-			}
-			if(bits & SensorControlEvent::PulseOximeterReady)
+			if(bits & SensorControlEvent::Reconfigure)
 			{
-				pulseOxiMeter.HasData() ? pulseOxiMeter.ReadData() : pulseOxiMeter.InsertPadding();
+				isSessionApplied = apply_pending_session();
+				DISCARD xSemaphoreGive(sessionApplied);
 			}
-			/*
-			if(bits & SensorControlEvent::ElectrocardiogramReady)
-			{
-				ecg.HasData() ? ecg.CaptureData() : ecg.InsertPadding();
-			}
-			if(bits & SensorControlEvent::InertialMeasurementUnitReady)
+			if(bits & SensorControlEvent::StartMeasurement)
 			{
-				imu.HasData() ? imu.GetData() : imu.InsertPadding();
+				startMeasurement();
 			}
-			*/
-			// Do touch screen and display controlling
-			//touchScreenController.Handler();
-			//YIELD_FOR(150); 
 		}
 	}
 }
@@ -2,11 +2,22 @@
 
 #include "../util/defines.h"
 
+namespace net
+{
+	struct SessionConfig;
+}
+
 namespace sys
 {
 	/**
-	 * \brief Task for initializing and controlling sensors
-	 * \param outView View of ring buffers.
+	 * \brief Task for initializing and controlling sensors. Publishes the view of the ring buffers through gStartup.
+	 */
+	void sensor_control_task(void*);
+
+	/**
+	 * \brief Applies 'session' to the sensors, ring buffers and BDF headers. Blocks until the sensor control task is done.
+	 * A running measurement is stopped for it and has to be started again.
+	 * \return false if a sensor rejected its sample rate. It keeps its previous one then.
 	 */
-	void sensor_control_task(WRITE_ONLY void* outView);
+	bool configure_session(net::SessionConfig const& session);
 }
\ No newline at end of file
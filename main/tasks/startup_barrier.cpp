@@ -0,0 +1,41 @@
+#include "startup_barrier.h"
+
+#include <cassert>
+
+namespace sys
+{
+	StartupBarrier gStartup;
+
+	StartupBarrier::StartupBarrier()
+		: _eventGroupBuffer{}, _events(nullptr), _view()
+	{
+	}
+
+	void StartupBarrier::Init()
+	{
+		_events = xEventGroupCreateStatic(&_eventGroupBuffer);
+	}
+
+	void StartupBarrier::PublishView(mem::RingBufferView const& view)
+	{
+		assert(!(xEventGroupGetBits(_events) & Event::SensorsReady) && "[Startup:] The view can only be published once!");
+		_view = view;
+		DISCARD xEventGroupSetBits(_events, Event::SensorsReady);
+	}
+
+	mem::RingBufferView const& StartupBarrier::WaitForView() const
+	{
+		DISCARD xEventGroupWaitBits(_events, Event::SensorsReady, pdFALSE, pdTRUE, portMAX_DELAY);
+		return _view;
+	}
+
+	void StartupBarrier::SignalNetworkReady()
+	{
+		DISCARD xEventGroupSetBits(_events, Event::NetworkReady);
+	}
+
+	void StartupBarrier::WaitForAll() const
+	{
+		DISCARD xEventGroupWaitBits(_events, Event::All, pdFALSE, pdTRUE, portMAX_DELAY);
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+#include "../memory/ring_buffer.h"
+#include "../util/defines.h"
+
+namespace sys
+{
+	/**
+	 * \brief Hands the ring buffer view from the sensor control task to the transmitter and lets app_main wait for the
+	 * end of the boot. All parties block on one event group instead of polling shared memory.
+	 *
+	 * The view is written exactly once before SensorsReady is set. Setting and waiting for event bits are
+	 * synchronization points, so a task which returned from WaitForView() sees the complete view. Afterwards it is
+	 * only read.
+	 */
+	class StartupBarrier
+	{
+	public:
+		struct Event
+		{
+			enum : EventBits_t
+			{
+				SensorsReady = 1 << 0, // The view is published.
+				NetworkReady = 1 << 1, // Wi-Fi is associated and has an address.
+				All          = SensorsReady | NetworkReady,
+			};
+		};
+
+		StartupBarrier();
+
+		/**
+		 * \brief Creates the event group. Call before any of the tasks are created.
+		 */
+		void Init();
+		void PublishView(mem::RingBufferView const& view); // Sensor control task, once
+		NODISCARD mem::RingBufferView const& WaitForView() const;
+		void SignalNetworkReady();
+		void WaitForAll() const;
+
+	private:
+		StaticEventGroup_t  _eventGroupBuffer;
+		EventGroupHandle_t  _events;
+		mem::RingBufferView _view;
+	};
+
+	extern StartupBarrier gStartup;
+}
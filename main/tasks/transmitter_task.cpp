@@ -3,17 +3,22 @@
 #include <cassert>
 
 #include "../config/task.h"
+#include "../config/devices.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 #include "../memory/ring_buffer.h"
 #include "../util/time.h"
+#include "../util/metrics.h"
+#include "../util/boot_profile.h"
+#include "startup_barrier.h"
 
 #include "../network/wifi.hpp"
 #include "../network/bdf_plus.h"
 #include "../network/tcp_client.h"
 #include "../network/telemetry_transmitter.h"
 #include "../memory/nvs.h"
+#include "../storage/sd_card.h"
 
 
 #define TELEMETRY_TAG "[TelemetryTask:]"
@@ -38,18 +43,25 @@ namespace sys
 {
 	long GetDataRecordCountFromClient(net::TCPClient const& client);
 
-	void transmitter_task(void* view)
+	void transmitter_task(void*)
 	{
 		esp_util::nvs_init();
+		util::gMetrics.StartPeriodicLog(config::Metrics::LOG_PERIOD_MS);
+		if constexpr(config::Recorder::ENABLED)
+		{
+			DISCARD storage::mount_sd_card();
+		}
 		// Establish wifi connection
 		char const* ssid = "WLAN-Q3Q83P_EXT";
 		char const* pw   = "1115344978197496";
-		net::connect(ssid, pw);
-		net::wait_for_connection();
+		{
+			const util::BootProfile::Scope profile("Wi-Fi");
+			net::connect(ssid, pw);
+			net::wait_for_connection();
+		}
 		net::print_ip_info();
-		const mem::RingBufferView ringBufferView = *static_cast<mem::RingBufferView*>(view);
-		*static_cast<mem::RingBufferView*>(view) = mem::RingBufferView();
-		net::TelemetryTransmitter telemetry(&ringBufferView);
+		gStartup.SignalNetworkReady();
+		net::TelemetryTransmitter telemetry(&gStartup.WaitForView());
 		while (true)
 		{
 			if(!telemetry.FindServer())
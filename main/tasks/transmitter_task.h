@@ -2,5 +2,8 @@
 
 namespace sys
 {
-	void transmitter_task(void* view);
+	/**
+	 * \brief Connects to Wi-Fi while the sensors are initialized and sends their ring buffers once gStartup published them.
+	 */
+	void transmitter_task(void*);
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "boot_profile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#define BOOT_TAG "[Boot:]"
+
+namespace util
+{
+	BootProfile gBootProfile;
+
+	BootProfile::Scope::Scope(const ascii_t* stage)
+		: _stage(stage), _start(esp_timer_get_time())
+	{
+	}
+
+	BootProfile::Scope::~Scope()
+	{
+		gBootProfile.Record(_stage, _start, esp_timer_get_time());
+	}
+
+	BootProfile::BootProfile()
+		: _stages{}, _count(0), _completed(0)
+	{
+	}
+
+	void BootProfile::Record(const ascii_t* name, time_us start, time_us end)
+	{
+		const size_t index = _count.fetch_add(1, std::memory_order_relaxed);
+		if(index >= std::size(_stages))
+		{
+			PRINTI(BOOT_TAG, "No slot left for stage '%s'.\n", name);
+			return;
+		}
+		_stages[index] = stage
+		{
+			.name  = name,
+			.start = start,
+			.end   = end,
+			.core  = static_cast<int>(xPortGetCoreID()),
+		};
+		_completed.fetch_add(1, std::memory_order_release);
+	}
+
+	void BootProfile::Mark(const ascii_t* name)
+	{
+		const time_us now = esp_timer_get_time();
+		Record(name, now, now);
+		PRINTI(BOOT_TAG, "%s after %lld us\n", name, now);
+	}
+
+	void BootProfile::Print() const
+	{
+		const size_t count = std::min<size_t>(_completed.load(std::memory_order_acquire), std::size(_stages));
+		if(!count) return;
+
+		time_us first = std::numeric_limits<time_us>::max(), last = 0, busy = 0;
+		PRINTI(BOOT_TAG, "%-24s %4s %10s %10s\n", "Stage", "Core", "Start/us", "Took/us");
+		for(size_t index = 0; index < count; index++)
+		{
+			stage const& current = _stages[index];
+			PRINTI(BOOT_TAG, "%-24s %4d %10lld %10lld\n", current.name, current.core, current.start, current.end - current.start);
+			if(current.end == current.start) continue; // Marks aren't part of the initialization.
+			first = std::min(first, current.start);
+			last  = std::max(last, current.end);
+			busy += current.end - current.start;
+		}
+		if(!busy) return;
+		// If the stages ran one after another, busy would be the elapsed time. Everything above it was overlapped.
+		PRINTI(BOOT_TAG, "Ready after %lld us. Stages took %lld us, at least %lld us of them overlapped.\n",
+			   last, busy, std::max<time_us>(busy - (last - first), 0));
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "../config/devices.h"
+#include "defines.h"
+#include "types.h"
+
+namespace util
+{
+	/**
+	 * \brief Records how long each step of the boot took and on which core it ran. Times are taken from esp_timer, so
+	 * they start shortly after the second stage bootloader handed over to the application.
+	 *
+	 * Recording is lock free and can be done from several initialization tasks at once. Print() shows every stage and
+	 * how much the stages overlapped.
+	 */
+	class BootProfile
+	{
+	public:
+		using time_us = int64_t;
+
+		/**
+		 * \brief Records the time between its construction and destruction as one stage.
+		 */
+		class Scope
+		{
+		public:
+			explicit Scope(const ascii_t* stage);
+			~Scope();
+
+			Scope(Scope const&)            = delete;
+			Scope& operator=(Scope const&) = delete;
+
+		private:
+			const ascii_t* _stage;
+			time_us        _start;
+		};
+
+		BootProfile();
+
+		void Record(const ascii_t* stage, time_us start, time_us end);
+		/**
+		 * \brief Records a single point in time (e.g. the first sample of a sensor) and prints it right away.
+		 */
+		void Mark(const ascii_t* stage);
+
+		void Print() const;
+
+	private:
+		struct stage
+		{
+			const ascii_t* name;
+			time_us        start;
+			time_us        end;
+			int            core;
+		};
+
+		stage               _stages[config::BootProfile::MAX_STAGES];
+		std::atomic<size_t> _count;
+		std::atomic<size_t> _completed; // Stages which are fully written
+	};
+
+	extern BootProfile gBootProfile;
+}
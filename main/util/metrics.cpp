@@ -0,0 +1,135 @@
+#include "metrics.h"
+
+#include <cstdio>
+
+#include "esp_timer.h"
+
+#define METRICS_TAG "[Metrics:]"
+
+namespace util
+{
+	namespace
+	{
+		enum class Kind : uint8_t
+		{
+			Counter,
+			Gauge,
+		};
+
+		struct metric_info
+		{
+			const char* name;
+			Kind        kind;
+		};
+
+		constexpr metric_info METRIC_INFOS[] =
+		{
+			{"records sent",       Kind::Counter},
+			{"sends",              Kind::Counter},
+			{"bytes sent",         Kind::Counter},
+			{"records per send",   Kind::Gauge},
+			{"MAX30102 samples",   Kind::Counter},
+			{"ADS1299 samples",    Kind::Counter},
+			{"BHI160 samples",     Kind::Counter},
+			{"MCP3561 samples",    Kind::Counter},
+			{"MAX30102 late",      Kind::Counter},
+			{"ADS1299 late",       Kind::Counter},
+			{"BHI160 late",        Kind::Counter},
+			{"MCP3561 late",       Kind::Counter},
+			{"MAX30102 drift ppm", Kind::Gauge},
+			{"ADS1299 drift ppm",  Kind::Gauge},
+			{"BHI160 drift ppm",   Kind::Gauge},
+			{"sched. overruns",    Kind::Counter},
+			{"sched. lateness",    Kind::Gauge},
+			{"MAX30102 padding",   Kind::Counter},
+			{"ADS1299 missed",     Kind::Counter},
+			{"BHI160 FIFO bytes",  Kind::Gauge},
+			{"ADS1299 lead-off",   Kind::Gauge},
+			{"ADS1299 noise nV",   Kind::Gauge},
+			{"ECG filter cycles",  Kind::Gauge},
+			{"decimator cycles",   Kind::Gauge},
+			{"QRS cycles",         Kind::Gauge},
+			{"SpO2 cycles",        Kind::Gauge},
+			{"I2C errors",         Kind::Counter},
+			{"SPI errors",         Kind::Counter},
+			{"I2C occupancy ppt",  Kind::Gauge},
+			{"MAX30102 rate",      Kind::Gauge},
+			{"ADS1299 rate",       Kind::Gauge},
+			{"BHI160 rate",        Kind::Gauge},
+			{"MAX30102 pad. ppt",  Kind::Gauge},
+			{"health events",      Kind::Counter},
+		};
+		static_assert(std::size(METRIC_INFOS) == static_cast<size_t>(Metric::Count), "Every metric needs a name and a kind.");
+
+		void log_callback(void* metrics)
+		{
+			static_cast<Metrics*>(metrics)->Log();
+		}
+	}
+
+	Metrics gMetrics;
+
+	Metrics::Metrics()
+		: _values{}, _loggedValues{}, _loggedAt(0)
+	{
+	}
+
+	void Metrics::Add(Metric metric, value_type value)
+	{
+		_values[static_cast<size_t>(metric)].fetch_add(value, std::memory_order_relaxed);
+	}
+
+	void Metrics::Set(Metric metric, value_type value)
+	{
+		_values[static_cast<size_t>(metric)].store(value, std::memory_order_relaxed);
+	}
+
+	Metrics::value_type Metrics::Get(Metric metric) const
+	{
+		return _values[static_cast<size_t>(metric)].load(std::memory_order_relaxed);
+	}
+
+	uint32_t Metrics::Delta(value_type newer, value_type older)
+	{
+		// Unsigned subtraction can't overflow, e.g. once more than 2 GB were sent.
+		return static_cast<uint32_t>(newer) - static_cast<uint32_t>(older);
+	}
+
+	void Metrics::Log()
+	{
+		const time_us now     = esp_timer_get_time();
+		const float   seconds = (now - _loggedAt) / 1'000'000.f;
+		_loggedAt = now;
+
+		for(size_t index = 0; index < COUNT; index++)
+		{
+			const value_type value = _values[index].load(std::memory_order_relaxed);
+			if(METRIC_INFOS[index].kind == Kind::Counter)
+			{
+				PRINTI(METRICS_TAG, "%-18s %10lu (%.1f/s)\n", METRIC_INFOS[index].name, static_cast<unsigned long>(static_cast<uint32_t>(value)),
+					   seconds > 0.f ? Delta(value, _loggedValues[index]) / seconds : 0.f);
+				_loggedValues[index] = value;
+			}
+			else
+			{
+				PRINTI(METRICS_TAG, "%-18s %10ld\n", METRIC_INFOS[index].name, static_cast<long>(value));
+			}
+		}
+	}
+
+	void Metrics::StartPeriodicLog(uint32_t periodMs)
+	{
+		const esp_timer_create_args_t args =
+		{
+			.callback        = log_callback,
+			.arg             = this,
+			.dispatch_method = ESP_TIMER_TASK,
+			.name            = "Metrics log",
+		};
+		esp_timer_handle_t timer = nullptr;
+		if(esp_timer_create(&args, &timer) != ESP_OK || esp_timer_start_periodic(timer, periodMs * 1'000ull) != ESP_OK)
+		{
+			PRINTI(METRICS_TAG, "Unable to start the periodic log.\n");
+		}
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "defines.h"
+
+namespace util
+{
+	enum class Metric : uint8_t
+	{
+		// Transmission
+		RecordsSent,    // Counter
+		Sends,          // Counter: Calls of TCPClient::Send for data records
+		BytesSent,      // Counter: Its rate is the throughput
+		RecordsPerSend, // Gauge: Batching factor of the last send
+		// Acquisition. Their rates are the achieved sample rates.
+		MAX30102Samples, // Counter
+		ADS1299Samples,  // Counter
+		BHI160Samples,   // Counter
+		MCP3561Samples,  // Counter
+		// Reads which started later than one sample period after the data was ready
+		MAX30102DeadlineMisses, // Counter
+		ADS1299DeadlineMisses,  // Counter
+		BHI160DeadlineMisses,   // Counter
+		MCP3561DeadlineMisses,  // Counter
+		// Deviation of the sensor clocks from esp_timer. Positive if a sensor samples faster than configured.
+		MAX30102ClockDrift, // Gauge: in ppm
+		ADS1299ClockDrift,  // Gauge: in ppm
+		BHI160ClockDrift,   // Gauge: in ppm
+		// Scheduler
+		SchedulerOverruns,    // Counter: Periods which were skipped completely
+		SchedulerMaxLateness, // Gauge: in us
+		// Sensor FIFOs and frames
+		MAX30102Padding,     // Counter: Samples lost by FIFO overflows, which were replaced by padding
+		ADS1299MissedFrames, // Counter: Frames overwritten before they were read or invalid, replaced by padding
+		BHI160FIFOLevel,     // Gauge: Bytes in the FIFO at the last read
+		// Front ends and processing
+		ADS1299LeadOff,  // Gauge: Channel mask of the detached electrodes
+		ADS1299Noise,    // Gauge: RMS noise of the worst channel in the last input-shorted capture, in nV
+		ECGFilterCycles, // Gauge: CPU cycles per sample and channel of dsp::ECGFilter
+		DecimatorCycles, // Gauge: CPU cycles per decimated sample and channel of dsp::Decimator (all input frames)
+		QRSCycles,       // Gauge: CPU cycles per ECG sample of sys::HeartRateMonitor
+		SpO2Cycles,      // Gauge: CPU cycles per PPG sample of sys::OximetryMonitor
+		// Buses. Failed transfers are counted instead of aborting.
+		I2CErrors,            // Counter
+		SPIErrors,            // Counter
+		I2COccupancyPermille, // Gauge: Share of the time in I2C transfers over the window of sys::HealthMonitor
+		// Health over the sliding window of sys::HealthMonitor
+		MAX30102Rate,            // Gauge: Real samples per second
+		ADS1299Rate,             // Gauge: Real samples per second
+		BHI160Rate,              // Gauge: Real samples per second
+		MAX30102PaddingPermille, // Gauge: Share of padding in the written samples
+		HealthEvents,            // Counter: Thresholds which were crossed
+
+		Count
+	};
+
+	/**
+	 * \brief Registry of named counters and gauges. Updating is lock free and can be done from any task.
+	 * Log() prints all metrics; counters additionally with their rate since the previous Log().
+	 * Counters wrap at 2^32. Their rates are right as long as less than that is added between logs.
+	 */
+	class Metrics
+	{
+	public:
+		using value_type = int32_t;
+		using time_us    = int64_t;
+
+		Metrics();
+
+		void Add(Metric metric, value_type value = 1);
+		void Set(Metric metric, value_type value);
+		NODISCARD value_type Get(Metric metric) const;
+		/**
+		 * \brief Increase of a counter from 'older' to 'newer', modulo 2^32. Right across a wrap of the counter.
+		 */
+		NODISCARD static uint32_t Delta(value_type newer, value_type older);
+
+		void Log();
+		/**
+		 * \brief Calls Log() every 'periodMs' from the esp_timer task.
+		 */
+		void StartPeriodicLog(uint32_t periodMs);
+
+	private:
+		static constexpr auto COUNT = static_cast<size_t>(Metric::Count);
+
+		std::atomic<value_type> _values[COUNT];
+		value_type              _loggedValues[COUNT]; // Counter values at the previous Log()
+		time_us                 _loggedAt;
+	};
+
+	extern Metrics gMetrics;
+}
@@ -0,0 +1,57 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace util
+{
+	Trace gTrace;
+
+	Trace::Trace()
+		: _events{}, _heads{}, _isEnabled(config::Trace::ENABLED)
+	{
+	}
+
+	Trace::dump_header Trace::Freeze()
+	{
+		_isEnabled.store(false, std::memory_order_relaxed);
+
+		dump_header header{};
+		std::memcpy(header.magic, DUMP_MAGIC, sizeof(header.magic));
+		header.version = DUMP_VERSION;
+		header.cores   = CORES;
+		for(size_t core = 0; core < CORES; core++)
+		{
+			header.events[core]      = StoredEvents(core);
+			header.overwritten[core] = _heads[core].load(std::memory_order_relaxed) - header.events[core];
+		}
+		return header;
+	}
+
+	std::span<const Trace::event> Trace::Events(size_t core, size_t part) const
+	{
+		const uint32_t head = _heads[core].load(std::memory_order_relaxed);
+		if(head <= EVENTS)
+		{
+			return part == 0 ? std::span<const event>(_events[core], head) : std::span<const event>();
+		}
+		// The oldest event is the one, which gets overwritten next.
+		const size_t oldest = head & (EVENTS - 1);
+		return part == 0 ? std::span<const event>(_events[core] + oldest, EVENTS - oldest)
+		                 : std::span<const event>(_events[core], oldest);
+	}
+
+	void Trace::Resume()
+	{
+		for(auto& head : _heads)
+		{
+			head.store(0, std::memory_order_relaxed);
+		}
+		_isEnabled.store(config::Trace::ENABLED, std::memory_order_relaxed);
+	}
+
+	uint32_t Trace::StoredEvents(size_t core) const
+	{
+		return std::min<uint32_t>(_heads[core].load(std::memory_order_relaxed), EVENTS);
+	}
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <span>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#include "../config/devices.h"
+#include "defines.h"
+
+namespace util
+{
+	enum class TraceEvent : uint8_t
+	{
+		IsrEntry,    // Data ready interrupt of a sensor
+		ReadBegin,   // Driver read of a sensor
+		ReadEnd,
+		RingWrite,   // Samples of a read were stamped. Value: Samples written so far (lower 16 bits)
+		RecordReady, // A data record was assembled. Value: Bytes of the record (lower 16 bits)
+		SendBegin,   // Value: Records in the send
+		SendEnd,
+		TaskWake,    // A task returned from waiting for its notification.
+	};
+
+	enum class TraceSource : uint8_t
+	{
+		MAX30102,
+		ADS1299,
+		BHI160,
+		MCP3561,
+		SPIAcquisition,
+		I2CAcquisition,
+		SensorControl,
+		Transmitter,
+	};
+
+	/**
+	 * \brief Lock free trace of fixed size binary events. Every core writes into its own ring, which overwrites the oldest
+	 * events once it is full. Tasks and ISRs of the same core reserve their slots atomically, so recording is safe
+	 * from both and takes well below 1 us.
+	 *
+	 * With config::Trace::ENABLED set to false, Record() compiles to nothing.
+	 */
+	class Trace
+	{
+	public:
+		static constexpr size_t CORES  = portNUM_PROCESSORS;
+		static constexpr size_t EVENTS = config::Trace::ENABLED ? config::Trace::EVENTS_PER_CORE : 1;
+		static_assert(std::has_single_bit(EVENTS), "The ring index has to wrap with a mask.");
+
+		struct event
+		{
+			uint32_t    time;   // esp_timer time (in us), lower 32 bits
+			TraceEvent  type;
+			TraceSource source;
+			uint16_t    value;
+		};
+		static_assert(sizeof(event) == 8);
+
+		/**
+		 * \brief Header of a dump. It is followed by the events of every core in chronological order.
+		 */
+		struct dump_header
+		{
+			char     magic[8];          // "EDUTRACE"
+			uint32_t version;
+			uint32_t cores;
+			uint32_t events[CORES];     // Events in the dump per core
+			uint32_t overwritten[CORES]; // Events lost per core, because the ring was full
+		};
+		static constexpr char     DUMP_MAGIC[8] = {'E', 'D', 'U', 'T', 'R', 'A', 'C', 'E'};
+		static constexpr uint32_t DUMP_VERSION  = 1;
+
+		Trace();
+
+		void Record(TraceEvent type, TraceSource source, uint16_t value = 0)
+		{
+			if constexpr(config::Trace::ENABLED)
+			{
+				if(!_isEnabled.load(std::memory_order_relaxed)) return;
+				const size_t   core  = xPortGetCoreID();
+				const uint32_t index = _heads[core].fetch_add(1, std::memory_order_relaxed);
+				_events[core][index & (EVENTS - 1)] = event
+				{
+					.time   = static_cast<uint32_t>(esp_timer_get_time()),
+					.type   = type,
+					.source = source,
+					.value  = value,
+				};
+			}
+		}
+
+		/**
+		 * \brief Stops recording and returns the header of a dump of the current events.
+		 */
+		NODISCARD dump_header Freeze();
+		/**
+		 * \brief Events of 'core' in chronological order. The ring wraps, so they are split into two parts.
+		 * Only valid while the trace is frozen.
+		 */
+		NODISCARD std::span<const event> Events(size_t core, size_t part) const;
+		/**
+		 * \brief Discards all events and continues recording.
+		 */
+		void Resume();
+
+	private:
+		NODISCARD uint32_t StoredEvents(size_t core) const;
+
+		event                 _events[CORES][EVENTS];
+		std::atomic<uint32_t> _heads[CORES]; // Events recorded since the last Resume()
+		std::atomic<bool>     _isEnabled;
+	};
+
+	extern Trace gTrace;
+
+	/**
+	 * \brief Records a pair of events around its lifetime, e.g. ReadBegin and ReadEnd.
+	 */
+	class TraceScope
+	{
+	public:
+		TraceScope(TraceEvent begin, TraceEvent end, TraceSource source)
+			: _end(end), _source(source)
+		{
+			gTrace.Record(begin, source);
+		}
+		~TraceScope()
+		{
+			gTrace.Record(_end, _source);
+		}
+
+		TraceScope(TraceScope const&)            = delete;
+		TraceScope& operator=(TraceScope const&) = delete;
+
+	private:
+		TraceEvent  _end;
+		TraceSource _source;
+	};
+}
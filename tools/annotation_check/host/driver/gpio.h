@@ -0,0 +1,28 @@
+#pragma once
+// Host stand-in for the pins and pull-ups named in main/config. Only the names are needed.
+
+enum gpio_num_t
+{
+	GPIO_NUM_0  = 0,
+	GPIO_NUM_2  = 2,
+	GPIO_NUM_4  = 4,
+	GPIO_NUM_5  = 5,
+	GPIO_NUM_15 = 15,
+	GPIO_NUM_18 = 18,
+	GPIO_NUM_19 = 19,
+	GPIO_NUM_21 = 21,
+	GPIO_NUM_22 = 22,
+	GPIO_NUM_23 = 23,
+	GPIO_NUM_27 = 27,
+	GPIO_NUM_33 = 33,
+	GPIO_NUM_34 = 34,
+	GPIO_NUM_35 = 35,
+	GPIO_NUM_36 = 36,
+	GPIO_NUM_39 = 39,
+};
+
+enum gpio_pullup_t
+{
+	GPIO_PULLUP_DISABLE = 0,
+	GPIO_PULLUP_ENABLE  = 1,
+};
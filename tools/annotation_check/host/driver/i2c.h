@@ -0,0 +1,8 @@
+#pragma once
+#include "gpio.h"
+
+enum i2c_port_t
+{
+	I2C_NUM_0 = 0,
+	I2C_NUM_1 = 1,
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+enum spi_host_device_t
+{
+	SPI1_HOST = 0,
+	SPI2_HOST = 1,
+	SPI3_HOST = 2,
+};
+#define VSPI_HOST SPI3_HOST
+
+enum spi_dma_chan_t
+{
+	SPI_DMA_DISABLED = 0,
+	SPI_DMA_CH_AUTO  = 3,
+};
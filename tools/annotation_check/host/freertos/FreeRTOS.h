@@ -0,0 +1,11 @@
+#pragma once
+// Host stand-in for the critical sections of file::AnnotationWriter. The check runs single threaded.
+
+struct portMUX_TYPE
+{
+	int owner;
+};
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL_SAFE(mux) ((void)(mux))
+#define portEXIT_CRITICAL_SAFE(mux)  ((void)(mux))
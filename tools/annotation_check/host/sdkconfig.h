@@ -0,0 +1,4 @@
+#pragma once
+// Host stand-in for the options of sdkconfig, which main/config reads.
+
+#define CONFIG_LWIP_TCP_SND_BUF_DEFAULT 5744
@@ -0,0 +1,300 @@
+/**
+ * annotation_check: Round trip of the BDF+ annotations of the firmware (main/network/bdf_annotations.h) on the build
+ * host.
+ *
+ * Usage: annotation_check [--records N] [--keep] [FILE]
+ *
+ * Pushes annotations into file::gAnnotations, directly and through file::GapTracker, and writes the annotation signal
+ * of N data records with AnnotationWriter::WriteRecord into a BDF+ file, as the transmitter does. The file is read back
+ * with the reader and the TAL parser of bdf_inspect. Every record has to start with its time-keeping TAL and every
+ * pushed annotation has to come back once, in order, with its onset, duration and text. Also covers the replacement
+ * of control characters, truncated texts, annotations which wait for a later record and the report of dropped ones.
+ */
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "network/bdf_annotations.h"
+#include "network/bdf_plus.h"
+#include "../bdf_inspect/bdf_reader.h"
+
+namespace
+{
+	using time_us = file::AnnotationWriter::time_us;
+	using Kind    = file::AnnotationWriter::Kind;
+
+	constexpr time_us     START          = 5'000'000; // esp_timer time of the first record
+	constexpr time_us     RECORD_US      = config::RECORD_DURATION_MS * 1'000ll;
+	constexpr std::size_t DATA_SAMPLES   = 10;        // Of the data signal, which only numbers the records
+	constexpr std::size_t TAL_BYTES      = config::Annotations::NODES_IN_BDF_RECORD * 3;
+	constexpr std::size_t MAX_TEXT       = config::Annotations::MAX_TEXT_LENGTH - 1;
+	constexpr std::size_t OVERFLOWING    = 4;         // Pushed beyond a full queue
+
+	struct annotation
+	{
+		time_us     onset; // Relative to START
+		time_us     duration;
+		std::string text;  // As in the file, with the name of the kind
+	};
+
+	/**
+	 * \brief Reads a TAL time like "+12.0045" in us. Returns false if it isn't one.
+	 */
+	bool parse_time(std::string_view text, bool isSigned, time_us& us)
+	{
+		if(isSigned)
+		{
+			if(text.empty() || text.front() != '+') return false;
+			text.remove_prefix(1);
+		}
+		const std::size_t point   = text.find('.');
+		const std::string seconds(text.substr(0, point));
+		std::string       fraction(point == std::string_view::npos ? "" : text.substr(point + 1));
+		if(seconds.empty() || fraction.size() > 6 || (point != std::string_view::npos && fraction.empty())) return false;
+		fraction.resize(6, '0');
+		char* end = nullptr;
+		us = std::strtoll(seconds.c_str(), &end, 10) * 1'000'000;
+		if(*end != '\0') return false;
+		us += std::strtoll(fraction.c_str(), &end, 10);
+		return *end == '\0';
+	}
+
+	/**
+	 * \brief Pushes the annotations of record 'record' and appends the ones, which have to come back, to 'expected'.
+	 */
+	void push_annotations(std::size_t record, file::GapTracker& ecgGaps, file::GapTracker& imuGaps, std::vector<annotation>& expected)
+	{
+		const time_us recordStart = START + static_cast<time_us>(record) * RECORD_US;
+		auto push = [&](Kind kind, const char* name, time_us timestamp, time_us duration, const char* text, std::string result)
+		{
+			DISCARD file::gAnnotations.Push(kind, timestamp, duration, text);
+			expected.push_back(annotation{.onset = timestamp - START, .duration = duration, .text = std::string(name) + " " + result});
+		};
+		auto gap = [&](const char* source, time_us start, time_us duration, unsigned long samples)
+		{
+			expected.push_back(annotation{.onset = start - START, .duration = duration, .text = "Gap " + std::string(source) + " " + std::to_string(samples)});
+		};
+
+		switch(record)
+		{
+		case 1:
+			push(Kind::SensorReset, "Reset", recordStart + 1, 0, "ADS1299", "ADS1299");
+			push(Kind::RateChange, "Rate", recordStart + 123'456, 0, "ADS1299 1000 SPS", "ADS1299 1000 SPS");
+			break;
+		case 2:
+			// Control characters would end the TAL.
+			push(Kind::UserMarker, "Marker", recordStart + 50'000, 0, "Eyes\x14open\tnow\x15", "Eyes open now ");
+			push(Kind::UserMarker, "Marker", recordStart + 60'000, 0, "A marker text, which is longer than an annotation can be",
+				 std::string("A marker text, which is longer than an annotation can be").substr(0, MAX_TEXT));
+			break;
+		case 3:
+		{
+			// Padding within the record, as mem::Resampler reports it: 5 of 50 points.
+			const time_us spacing = RECORD_US / 50;
+			for(time_us point = 10; point < 50; point++)
+			{
+				const time_us time = recordStart + point * spacing;
+				if(point >= 20 && point < 25) ecgGaps.Padding(time);
+				else ecgGaps.Sample(time);
+			}
+			ecgGaps.Close(recordStart + RECORD_US);
+			gap("ECG Ch 1", recordStart + 20 * spacing, 5 * spacing, 5);
+			// A stalled sensor is padded up to the end of the record and annotated per record.
+			for(time_us point = 40; point < 50; point++) imuGaps.Padding(recordStart + point * spacing);
+			imuGaps.Close(recordStart + RECORD_US);
+			gap("Acceleration X", recordStart + 40 * spacing, 10 * spacing, 10);
+			break;
+		}
+		case 4:
+		{
+			const time_us spacing = RECORD_US / 50;
+			for(time_us point = 0; point < 3; point++) imuGaps.Padding(recordStart + point * spacing);
+			imuGaps.Sample(recordStart + 3 * spacing);
+			imuGaps.Close(recordStart + RECORD_US);
+			gap("Acceleration X", recordStart, 3 * spacing, 3);
+			push(Kind::DeadlineMiss, "Late", recordStart + 7, 1'500, "BHI160 1500 us", "BHI160 1500 us");
+			break;
+		}
+		case 6:
+			// More than fit into one record and into the queue. The ones beyond its capacity are dropped and reported.
+			for(std::size_t index = 0; index < config::Annotations::MAX_PENDING; index++)
+			{
+				const std::string text = std::to_string(60 + index); // bpm
+				push(Kind::Beat, "Beat", recordStart + static_cast<time_us>(index) * 1'000, 0, text.c_str(), text);
+			}
+			for(std::size_t index = 0; index < OVERFLOWING; index++)
+			{
+				DISCARD file::gAnnotations.Push(Kind::Beat, recordStart, 0, "Dropped");
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	std::vector<util::byte> headers(std::size_t records)
+	{
+		file::bdf_header_t general{};
+		file::create_general_header(&general, config::DURATION_OF_MEASUREMENT, static_cast<int32_t>(records), 2);
+		file::make_bdf_plus(&general);
+		file::bdf_signal_header_t signals[2]{};
+		file::create_signal_header(&signals[0], "Record", "None", "", 0, 8'388'607, 0, 8'388'607, "None", DATA_SAMPLES);
+		file::create_annotation_header(&signals[1], config::Annotations::NODES_IN_BDF_RECORD);
+
+		// Attribute by attribute, as the transmitter sends them.
+		constexpr std::size_t SIZES[] = {16, 80, 8, 8, 8, 8, 8, 80, 8, 32};
+		std::vector<util::byte> result(general.data, general.data + sizeof general.data);
+		std::size_t offset = 0;
+		for(std::size_t size : SIZES)
+		{
+			for(auto const& signal : signals)
+			{
+				result.insert(result.end(), signal.data + offset, signal.data + offset + size);
+			}
+			offset += size;
+		}
+		return result;
+	}
+
+	int usage(const char* program)
+	{
+		std::fprintf(stderr, "Usage: %s [--records N] [--keep] [FILE]\n", program);
+		return EXIT_FAILURE;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::size_t records = 20;
+	bool        isKept  = false;
+	const char* path    = "annotation_check.bdf";
+	for(int arg = 1; arg < argc; arg++)
+	{
+		if(!std::strcmp(argv[arg], "--records") && arg + 1 < argc) records = std::strtoul(argv[++arg], nullptr, 10);
+		else if(!std::strcmp(argv[arg], "--keep"))                  isKept  = true;
+		else if(argv[arg][0] != '-')                                path    = argv[arg];
+		else return usage(argv[0]);
+	}
+	if(records < 10) return usage(argv[0]); // The annotations are pushed until record 6 and need a few to drain.
+
+	// Write the file. An annotation pushed before Begin keeps its time and is clamped to the start of the recording.
+	std::vector<annotation> expected;
+	DISCARD file::gAnnotations.Push(Kind::Health, START - 1'000, 0, "Before the start");
+	expected.push_back(annotation{.onset = 0, .duration = 0, .text = "Health Before the start"});
+	file::gAnnotations.Begin(START);
+	file::GapTracker ecgGaps, imuGaps;
+	ecgGaps.Begin("ECG Ch 1");
+	imuGaps.Begin("Acceleration X");
+
+	FILE* stream = std::fopen(path, "wb");
+	if(!stream)
+	{
+		std::fprintf(stderr, "Can't create '%s'.\n", path);
+		return EXIT_FAILURE;
+	}
+	const std::vector<util::byte> header = headers(records);
+	bool isWritten = std::fwrite(header.data(), 1, header.size(), stream) == header.size();
+	for(std::size_t record = 0; record < records && isWritten; record++)
+	{
+		push_annotations(record, ecgGaps, imuGaps, expected);
+		util::byte data[DATA_SAMPLES * 3 + TAL_BYTES]{};
+		for(std::size_t sample = 0; sample < DATA_SAMPLES; sample++)
+		{
+			data[sample * 3] = static_cast<util::byte>(record);
+		}
+		file::gAnnotations.WriteRecord(config::DURATION_OF_MEASUREMENT, std::span(reinterpret_cast<ascii_t*>(data + DATA_SAMPLES * 3), TAL_BYTES));
+		isWritten = std::fwrite(data, 1, sizeof data, stream) == sizeof data;
+	}
+	isWritten = std::fclose(stream) == 0 && isWritten;
+	if(!isWritten)
+	{
+		std::fprintf(stderr, "Writing '%s' failed.\n", path);
+		return EXIT_FAILURE;
+	}
+
+	// Read it back.
+	std::vector<std::string> issues;
+	std::vector<annotation>  found;
+	std::size_t              overflows = 0;
+	file::BDFReader          reader;
+	if(!reader.Open(path))
+	{
+		issues.push_back("The reader can't open the file.");
+	}
+	else
+	{
+		issues.insert(issues.end(), reader.Issues().begin(), reader.Issues().end());
+		if(!reader.IsBDFPlus()) issues.push_back("The file isn't BDF+.");
+		if(reader.Records() != records) issues.push_back("The reader finds " + std::to_string(reader.Records()) + " records.");
+		for(std::size_t record = 0; record < reader.Records() && reader.Signals().size() == 2; record++)
+		{
+			const std::string where = "Record " + std::to_string(record) + ": ";
+			std::vector<file::bdf_tal_t> tals;
+			if(!file::parse_tals(reader.Samples(reader.Record(record), 1), tals)) issues.push_back(where + "Malformed TAL.");
+
+			time_us onset = -1;
+			if(tals.empty() || !tals.front().texts.empty() || !tals.front().duration.empty() || !parse_time(tals.front().onset, true, onset) ||
+			   onset != static_cast<time_us>(record) * RECORD_US)
+			{
+				issues.push_back(where + "The first TAL doesn't keep the time of the record.");
+			}
+			for(std::size_t index = 1; index < tals.size(); index++)
+			{
+				annotation result{.onset = 0, .duration = 0, .text = {}};
+				if(!parse_time(tals[index].onset, true, result.onset) ||
+				   (!tals[index].duration.empty() && !parse_time(tals[index].duration, false, result.duration)) || tals[index].texts.size() != 1)
+				{
+					issues.push_back(where + "TAL " + std::to_string(index) + " can't be parsed.");
+					continue;
+				}
+				result.text = tals[index].texts.front();
+				if(result.text.starts_with("Overflow "))
+				{
+					overflows++;
+					if(result.text != "Overflow " + std::to_string(OVERFLOWING) + " dropped") issues.push_back(where + "'" + result.text + "'");
+					continue;
+				}
+				found.push_back(std::move(result));
+			}
+		}
+	}
+
+	for(std::size_t index = 0; index < std::max(expected.size(), found.size()); index++)
+	{
+		if(index >= found.size())
+		{
+			issues.push_back("Missing: '" + expected[index].text + "'");
+		}
+		else if(index >= expected.size())
+		{
+			issues.push_back("Unexpected: '" + found[index].text + "'");
+		}
+		else if(found[index].text != expected[index].text || found[index].onset != expected[index].onset || found[index].duration != expected[index].duration)
+		{
+			issues.push_back("'" + found[index].text + "' at " + std::to_string(found[index].onset) + " us for " + std::to_string(found[index].duration) +
+							 " us instead of '" + expected[index].text + "' at " + std::to_string(expected[index].onset) + " us for " +
+							 std::to_string(expected[index].duration) + " us");
+		}
+	}
+	if(overflows != 1) issues.push_back(std::to_string(overflows) + " reports of dropped annotations instead of 1.");
+	if(file::gAnnotations.Dropped() != OVERFLOWING) issues.push_back(std::to_string(file::gAnnotations.Dropped()) + " dropped annotations.");
+
+	std::printf("%zu records with %zu Bytes of TALs: %zu of %zu annotations read back, %zu dropped and reported\n",
+				records, TAL_BYTES, found.size(), expected.size(), static_cast<std::size_t>(file::gAnnotations.Dropped()));
+	for(std::string const& issue : issues)
+	{
+		std::printf("Issue: %s\n", issue.c_str());
+	}
+	std::printf(issues.empty() ? "OK: Time-keeping TALs, onsets, durations and texts match.\n" : "FAILED\n");
+
+	if(!isKept)
+	{
+		DISCARD std::remove(path);
+	}
+	return issues.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,400 @@
+#include "bdf_reader.h"
+
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace file
+{
+	namespace
+	{
+		constexpr std::size_t HEADER_SIZE = sizeof(bdf_header_t);
+
+		std::string_view trimmed(const ascii_t* field, std::size_t size)
+		{
+			std::string_view view(field, size);
+			while(!view.empty() && view.back() == ' ')
+			{
+				view.remove_suffix(1);
+			}
+			return view;
+		}
+
+		template<std::size_t Size>
+		std::string_view trimmed(const ascii_t(&field)[Size])
+		{
+			return trimmed(field, Size);
+		}
+
+		template<typename T>
+		bool parse(std::string_view text, OUT T& value)
+		{
+			auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+			return error == std::errc() && end == text.data() + text.size();
+		}
+
+		bool is_printable(const ascii_t* field, std::size_t size)
+		{
+			for(std::size_t i = 0; i < size; i++)
+			{
+				if(field[i] < ' ' || field[i] > '~') return false;
+			}
+			return true;
+		}
+
+		bool is_date_or_time(std::string_view text)
+		{
+			// dd.mm.yy or hh.mm.ss
+			return text.size() == 8 && text[2] == '.' && text[5] == '.' &&
+				   std::isdigit(text[0]) && std::isdigit(text[1]) &&
+				   std::isdigit(text[3]) && std::isdigit(text[4]) &&
+				   std::isdigit(text[6]) && std::isdigit(text[7]);
+		}
+	}
+
+	MappedFile::MappedFile()
+		: _data(nullptr), _size(0), _fd(-1)
+	{
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	bool MappedFile::Open(const char* path)
+	{
+		Close();
+		_fd = open(path, O_RDONLY);
+		if(_fd < 0) return false;
+
+		struct stat info{};
+		if(fstat(_fd, &info) != 0 || info.st_size <= 0)
+		{
+			Close();
+			return false;
+		}
+		_size = static_cast<std::size_t>(info.st_size);
+		_data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+		if(_data == MAP_FAILED)
+		{
+			_data = nullptr;
+			Close();
+			return false;
+		}
+		// Records are read front to back exactly once. The advice values are no flags and can't be combined.
+		// MADV_WILLNEED is left out on purpose: It would read all of a multi-GB recording ahead at once.
+		DISCARD madvise(_data, _size, MADV_SEQUENTIAL);
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if(_data)
+		{
+			munmap(_data, _size);
+			_data = nullptr;
+		}
+		if(_fd >= 0)
+		{
+			close(_fd);
+			_fd = -1;
+		}
+		_size = 0;
+	}
+
+	std::span<util::byte const> MappedFile::Data() const
+	{
+		return { static_cast<util::byte const*>(_data), _size };
+	}
+
+	BDFReader::BDFReader()
+		: _header(nullptr), _durationOfDataRecord(0.0), _headerSize(0), _recordSize(0), _records(0), _isBDFPlus(false)
+	{
+	}
+
+	bool BDFReader::Open(const char* path)
+	{
+		_signals.clear();
+		_issues.clear();
+		_header     = nullptr;
+		_recordSize = 0;
+		_records    = 0;
+
+		if(!_file.Open(path))
+		{
+			Issue(std::string("Unable to map '") + path + "'.");
+			return false;
+		}
+		if(_file.Data().size() < HEADER_SIZE)
+		{
+			Issue("File is smaller than the general header.");
+			return false;
+		}
+		_header = reinterpret_cast<bdf_header_t const*>(_file.Data().data());
+		if(!ValidateGeneralHeader())
+		{
+			return false;
+		}
+		ReadSignalHeaders();
+		if(!_recordSize)
+		{
+			Issue("Data records are empty.");
+			return false;
+		}
+
+		const std::size_t dataSize = _file.Data().size() - _headerSize;
+		_records = dataSize / _recordSize;
+		if(dataSize % _recordSize)
+		{
+			Issue("Trailing " + std::to_string(dataSize % _recordSize) + " Bytes don't form a complete data record.");
+		}
+
+		int64_t declaredRecords = 0;
+		if(!parse(trimmed(_header->number_of_data_records), declaredRecords))
+		{
+			Issue("number_of_data_records is not a number.");
+		}
+		else if(declaredRecords != -1 && static_cast<std::size_t>(declaredRecords) != _records)
+		{
+			Issue("number_of_data_records is " + std::to_string(declaredRecords) + ", but the file holds " + std::to_string(_records) + " records.");
+		}
+		return true;
+	}
+
+	bool BDFReader::ValidateGeneralHeader()
+	{
+		static constexpr ascii_t VERSION[] = "\xff" "BIOSEMI";
+		if(std::memcmp(_header->version, VERSION, sizeof _header->version) != 0)
+		{
+			Issue("version is not \\xffBIOSEMI.");
+		}
+		if(!is_printable(_header->data + sizeof _header->version, HEADER_SIZE - sizeof _header->version))
+		{
+			Issue("General header contains non-printable characters.");
+		}
+		if(!is_date_or_time(trimmed(_header->startdate_of_recording)))
+		{
+			Issue("startdate_of_recording is not dd.mm.yy.");
+		}
+		if(!is_date_or_time(trimmed(_header->starttime_of_recording)))
+		{
+			Issue("starttime_of_recording is not hh.mm.ss.");
+		}
+
+		const std::string_view format = trimmed(_header->version_of_dataformat);
+		_isBDFPlus = format == "BDF+C" || format == "BDF+D";
+		if(!_isBDFPlus && format != "24BIT")
+		{
+			Issue("version_of_dataformat '" + std::string(format) + "' is neither 24BIT nor BDF+C/D.");
+		}
+
+		std::string_view duration = trimmed(_header->duration_of_a_data_record);
+		if(!parse(duration, _durationOfDataRecord) || _durationOfDataRecord <= 0.0)
+		{
+			Issue("duration_of_a_data_record '" + std::string(duration) + "' is not a positive number.");
+			return false;
+		}
+
+		uint32_t signals = 0;
+		if(!parse(trimmed(_header->number_of_signal_headers), signals) || !signals)
+		{
+			Issue("number_of_signal_headers is not a positive number.");
+			return false;
+		}
+		_headerSize = (1 + static_cast<std::size_t>(signals)) * HEADER_SIZE;
+		_signals.resize(signals);
+
+		std::size_t declaredHeaderSize = 0;
+		if(!parse(trimmed(_header->number_of_bytes_in_header_record), declaredHeaderSize) || declaredHeaderSize != _headerSize)
+		{
+			Issue("number_of_bytes_in_header_record doesn't match " + std::to_string(signals) + " signals.");
+		}
+		if(_file.Data().size() < _headerSize)
+		{
+			Issue("File is smaller than its signal headers.");
+			return false;
+		}
+		return true;
+	}
+
+	void BDFReader::ReadSignalHeaders()
+	{
+		// The signal headers are stored attribute wise: All labels, then all transducer types and so on.
+		const std::size_t count = _signals.size();
+		const ascii_t*    base  = reinterpret_cast<const ascii_t*>(_file.Data().data()) + HEADER_SIZE;
+		auto attribute = [&, offset = std::size_t(0)](std::size_t size) mutable
+		{
+			const ascii_t* begin = base + offset;
+			offset += size * count;
+			return begin;
+		};
+
+		bdf_signal_header_t const* layout = nullptr;
+		const ascii_t* labels              = attribute(sizeof layout->label);
+		const ascii_t* transducerTypes     = attribute(sizeof layout->transducer_type);
+		const ascii_t* physicalDimensions  = attribute(sizeof layout->physical_dimension);
+		const ascii_t* physicalMinima      = attribute(sizeof layout->physical_minimum);
+		const ascii_t* physicalMaxima      = attribute(sizeof layout->physical_maximum);
+		const ascii_t* digitalMinima       = attribute(sizeof layout->digital_minimum);
+		const ascii_t* digitalMaxima       = attribute(sizeof layout->digital_maximum);
+		const ascii_t* preFilterings       = attribute(sizeof layout->pre_filtering);
+		const ascii_t* samples             = attribute(sizeof layout->nr_of_samples_in_signal);
+		DISCARD transducerTypes;
+		DISCARD preFilterings;
+
+		if(!is_printable(base, _headerSize - HEADER_SIZE))
+		{
+			Issue("Signal headers contain non-printable characters.");
+		}
+
+		for(std::size_t index = 0; index < count; index++)
+		{
+			bdf_signal_t& signal = _signals[index];
+			auto field = [index](const ascii_t* attribute, std::size_t size)
+			{
+				return trimmed(attribute + index * size, size);
+			};
+			const std::string prefix = "Signal " + std::to_string(index + 1) + ": ";
+
+			signal.label              = field(labels, sizeof layout->label);
+			signal.physical_dimension = field(physicalDimensions, sizeof layout->physical_dimension);
+			signal.is_annotation      = signal.label == ANNOTATION_LABEL;
+			if(!parse(field(physicalMinima, sizeof layout->physical_minimum), signal.physical_minimum) ||
+			   !parse(field(physicalMaxima, sizeof layout->physical_maximum), signal.physical_maximum))
+			{
+				Issue(prefix + "physical range is not a number.");
+			}
+			else if(signal.physical_minimum == signal.physical_maximum)
+			{
+				Issue(prefix + "physical range is empty.");
+			}
+			if(!parse(field(digitalMinima, sizeof layout->digital_minimum), signal.digital_minimum) ||
+			   !parse(field(digitalMaxima, sizeof layout->digital_maximum), signal.digital_maximum))
+			{
+				Issue(prefix + "digital range is not a number.");
+			}
+			else if(signal.digital_minimum >= signal.digital_maximum ||
+					signal.digital_minimum < -8'388'608 || signal.digital_maximum > 8'388'607)
+			{
+				Issue(prefix + "digital range is not an ascending 24-Bit range.");
+			}
+			if(!parse(field(samples, sizeof layout->nr_of_samples_in_signal), signal.nr_of_samples_in_signal) ||
+			   !signal.nr_of_samples_in_signal)
+			{
+				Issue(prefix + "nr_of_samples_in_signal is not a positive number.");
+				signal.nr_of_samples_in_signal = 0;
+			}
+			if(signal.is_annotation && !_isBDFPlus)
+			{
+				Issue(prefix + "annotation signal in a file which isn't BDF+.");
+			}
+
+			signal.offset_in_record = _recordSize;
+			_recordSize += signal.nr_of_samples_in_signal * SAMPLE_SIZE;
+		}
+	}
+
+	void BDFReader::Issue(std::string issue)
+	{
+		_issues.push_back(std::move(issue));
+	}
+
+	std::vector<std::string> const& BDFReader::Issues() const
+	{
+		return _issues;
+	}
+
+	std::vector<bdf_signal_t> const& BDFReader::Signals() const
+	{
+		return _signals;
+	}
+
+	bdf_header_t const& BDFReader::Header() const
+	{
+		return *_header;
+	}
+
+	bool BDFReader::IsBDFPlus() const
+	{
+		return _isBDFPlus;
+	}
+
+	double BDFReader::DurationOfDataRecord() const
+	{
+		return _durationOfDataRecord;
+	}
+
+	std::size_t BDFReader::RecordSize() const
+	{
+		return _recordSize;
+	}
+
+	std::size_t BDFReader::Records() const
+	{
+		return _records;
+	}
+
+	std::size_t BDFReader::FileSize() const
+	{
+		return _file.Data().size();
+	}
+
+	std::span<util::byte const> BDFReader::Record(std::size_t record) const
+	{
+		return _file.Data().subspan(_headerSize + record * _recordSize, _recordSize);
+	}
+
+	std::span<util::byte const> BDFReader::Samples(std::span<util::byte const> record, std::size_t signal) const
+	{
+		bdf_signal_t const& info = _signals[signal];
+		return record.subspan(info.offset_in_record, info.nr_of_samples_in_signal * SAMPLE_SIZE);
+	}
+
+	bool parse_tals(std::span<util::byte const> samples, std::vector<bdf_tal_t>& tals)
+	{
+		bool             isWellFormed = true;
+		std::string_view rest(reinterpret_cast<const ascii_t*>(samples.data()), samples.size());
+		while(!rest.empty() && rest.front() != '\0')
+		{
+			const std::size_t end = rest.find('\0');
+			std::string_view  tal = rest.substr(0, end);
+			rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 1);
+
+			const std::size_t timeEnd = tal.find('\x14');
+			if(timeEnd == std::string_view::npos || (tal.front() != '+' && tal.front() != '-'))
+			{
+				isWellFormed = false;
+				continue;
+			}
+			const std::string_view time          = tal.substr(0, timeEnd);
+			const std::size_t      durationStart = time.find('\x15');
+			bdf_tal_t              parsed
+			{
+				.onset    = time.substr(0, durationStart),
+				.duration = durationStart == std::string_view::npos ? std::string_view() : time.substr(durationStart + 1),
+				.texts    = {},
+			};
+			std::string_view texts = tal.substr(timeEnd + 1);
+			while(!texts.empty())
+			{
+				const std::size_t textEnd = texts.find('\x14');
+				if(textEnd == std::string_view::npos)
+				{
+					isWellFormed = false; // Unterminated text
+					break;
+				}
+				if(textEnd) parsed.texts.push_back(texts.substr(0, textEnd));
+				texts.remove_prefix(textEnd + 1);
+			}
+			tals.push_back(std::move(parsed));
+		}
+		return isWellFormed;
+	}
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../../main/network/bdf_plus.h"
+
+namespace file
+{
+	/**
+	 * \brief Read only memory mapping of a whole file.
+	 */
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+		MappedFile(MappedFile const&) = delete;
+		MappedFile& operator=(MappedFile const&) = delete;
+
+		bool Open(const char* path);
+		void Close();
+
+		std::span<util::byte const> Data() const;
+
+	private:
+		void*       _data;
+		std::size_t _size;
+		int         _fd;
+	};
+
+	/**
+	 * \brief Signal header of a BDF file in parsed form.
+	 */
+	struct bdf_signal_t
+	{
+		std::string label;
+		std::string physical_dimension;
+		int32_t     physical_minimum;
+		int32_t     physical_maximum;
+		int32_t     digital_minimum;
+		int32_t     digital_maximum;
+		uint32_t    nr_of_samples_in_signal;
+		std::size_t offset_in_record; // in Bytes
+		bool        is_annotation;
+	};
+
+	/**
+	 * \brief Time-stamped Annotation List (TAL) of a BDF+ annotation signal. Views into the signal.
+	 */
+	struct bdf_tal_t
+	{
+		std::string_view              onset;    // e.g. "+12.004", in seconds
+		std::string_view              duration; // Empty if the TAL has none
+		std::vector<std::string_view> texts;    // Empty for the time-keeping TAL of a record
+	};
+
+	/**
+	 * \brief Parses the TALs of one annotation signal: "+onset[\x15duration]\x14text\x14...\x14\0", up to the
+	 * zero filled rest.
+	 * \return false if a TAL is malformed. It is skipped, the others are still appended to 'tals'.
+	 */
+	bool parse_tals(std::span<util::byte const> samples, std::vector<bdf_tal_t>& tals);
+
+	/**
+	 * \brief Memory mapped reader of BDF/BDF+ files as written by the firmware (see create_general_header and
+	 * create_signal_header). Open() validates the headers. Records are accessed in place without copying.
+	 */
+	class BDFReader
+	{
+	public:
+		static constexpr std::size_t SAMPLE_SIZE = 3; // 24-Bit little endian
+
+		BDFReader();
+
+		/**
+		 * \brief Maps the file and validates its headers.
+		 * \return false if the file can't be read as BDF at all. Other violations are collected in Issues().
+		 */
+		bool Open(const char* path);
+
+		std::vector<std::string> const& Issues() const;
+		std::vector<bdf_signal_t> const& Signals() const;
+		bdf_header_t const& Header() const;
+
+		bool        IsBDFPlus() const;
+		double      DurationOfDataRecord() const; // in seconds
+		std::size_t RecordSize() const;           // in Bytes
+		std::size_t Records() const;              // Complete records in the file
+		std::size_t FileSize() const;
+
+		std::span<util::byte const> Record(std::size_t record) const;
+		std::span<util::byte const> Samples(std::span<util::byte const> record, std::size_t signal) const;
+
+		static int32_t Sample(util::byte const* sample)
+		{
+			// Sign extension of the 24-Bit value.
+			return static_cast<int32_t>(static_cast<uint32_t>(sample[0]) << 8 |
+										static_cast<uint32_t>(sample[1]) << 16 |
+										static_cast<uint32_t>(sample[2]) << 24) >> 8;
+		}
+
+	private:
+		bool ValidateGeneralHeader();
+		void ReadSignalHeaders();
+		void Issue(std::string issue);
+
+		MappedFile                _file;
+		bdf_header_t const*       _header;
+		std::vector<bdf_signal_t> _signals;
+		std::vector<std::string>  _issues;
+		double                    _durationOfDataRecord;
+		std::size_t               _headerSize;
+		std::size_t               _recordSize;
+		std::size_t               _records;
+		bool                      _isBDFPlus;
+	};
+}
@@ -0,0 +1,188 @@
+/**
+ * bdf_inspect: Validates a BDF/BDF+ recording of the firmware and analyzes its stream.
+ *
+ * Usage: bdf_inspect [--min-gap SAMPLES] [--annotations] FILE.bdf
+ *
+ * Reports per signal the number of samples, gaps (runs of padding zeros with at least --min-gap samples),
+ * the nominal and effective sample rate and the data throughput of the stream. With --annotations the
+ * TALs of the "BDF Annotations" signal are listed.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "bdf_reader.h"
+
+namespace
+{
+	struct signal_statistics
+	{
+		uint64_t samples       = 0;
+		uint64_t paddedSamples = 0; // Samples within gaps
+		uint64_t gaps          = 0;
+		uint64_t longestGap    = 0;
+		uint64_t run           = 0; // Current run of zeros, continues over record boundaries
+		int32_t  minimum       = INT32_MAX;
+		int32_t  maximum       = INT32_MIN;
+	};
+
+	void close_run(signal_statistics& statistics, uint64_t minGap)
+	{
+		if(statistics.run >= minGap)
+		{
+			statistics.gaps++;
+			statistics.paddedSamples += statistics.run;
+			statistics.longestGap     = std::max(statistics.longestGap, statistics.run);
+		}
+		statistics.run = 0;
+	}
+
+	void analyze_samples(std::span<util::byte const> samples, signal_statistics& statistics, uint64_t minGap)
+	{
+		int32_t minimum = statistics.minimum;
+		int32_t maximum = statistics.maximum;
+		for(std::size_t offset = 0; offset < samples.size(); offset += file::BDFReader::SAMPLE_SIZE)
+		{
+			const int32_t sample = file::BDFReader::Sample(samples.data() + offset);
+			if(sample == util::PADDING_BYTE)
+			{
+				statistics.run++;
+				continue;
+			}
+			if(statistics.run)
+			{
+				close_run(statistics, minGap);
+			}
+			minimum = std::min(minimum, sample);
+			maximum = std::max(maximum, sample);
+		}
+		statistics.minimum  = minimum;
+		statistics.maximum  = maximum;
+		statistics.samples += samples.size() / file::BDFReader::SAMPLE_SIZE;
+	}
+
+	/**
+	 * \brief Prints the annotations of one annotation signal. The time-keeping TAL is left out.
+	 */
+	void print_annotations(std::span<util::byte const> samples, std::size_t record)
+	{
+		std::vector<file::bdf_tal_t> tals;
+		if(!file::parse_tals(samples, tals))
+		{
+			std::printf("  Record %zu: malformed TAL\n", record);
+		}
+		for(file::bdf_tal_t const& tal : tals)
+		{
+			for(std::string_view text : tal.texts)
+			{
+				std::printf("  %.*ss", static_cast<int>(tal.onset.size()), tal.onset.data());
+				if(!tal.duration.empty())
+				{
+					std::printf(" (%.*ss)", static_cast<int>(tal.duration.size()), tal.duration.data());
+				}
+				std::printf(": %.*s\n", static_cast<int>(text.size()), text.data());
+			}
+		}
+	}
+
+	int usage(const char* program)
+	{
+		std::fprintf(stderr, "Usage: %s [--min-gap SAMPLES] [--annotations] FILE.bdf\n", program);
+		return EXIT_FAILURE;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const char* path          = nullptr;
+	uint64_t    minGap        = 2;
+	bool        isAnnotations = false;
+	for(int arg = 1; arg < argc; arg++)
+	{
+		if(!std::strcmp(argv[arg], "--min-gap") && arg + 1 < argc)
+		{
+			minGap = std::max(1ull, std::strtoull(argv[++arg], nullptr, 10));
+		}
+		else if(!std::strcmp(argv[arg], "--annotations"))
+		{
+			isAnnotations = true;
+		}
+		else if(!path && argv[arg][0] != '-')
+		{
+			path = argv[arg];
+		}
+		else
+		{
+			return usage(argv[0]);
+		}
+	}
+	if(!path) return usage(argv[0]);
+
+	file::BDFReader reader;
+	const bool isOpen = reader.Open(path);
+	for(auto const& issue : reader.Issues())
+	{
+		std::printf("Issue: %s\n", issue.c_str());
+	}
+	if(!isOpen) return EXIT_FAILURE;
+
+	auto const& signals  = reader.Signals();
+	const auto  start    = std::chrono::steady_clock::now();
+	const auto  records  = reader.Records();
+	const auto  duration = static_cast<double>(records) * reader.DurationOfDataRecord();
+	std::vector<signal_statistics> statistics(signals.size());
+
+	if(isAnnotations) std::printf("Annotations:\n");
+	for(std::size_t record = 0; record < records; record++)
+	{
+		auto data = reader.Record(record);
+		for(std::size_t signal = 0; signal < signals.size(); signal++)
+		{
+			if(signals[signal].is_annotation)
+			{
+				if(isAnnotations) print_annotations(reader.Samples(data, signal), record);
+				continue;
+			}
+			analyze_samples(reader.Samples(data, signal), statistics[signal], minGap);
+		}
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	std::printf("%s: %s, %zu records of %gs (%gs), %zu Bytes per record\n",
+				path, reader.IsBDFPlus() ? "BDF+" : "BDF", records, reader.DurationOfDataRecord(), duration, reader.RecordSize());
+	std::printf("%-16s %12s %10s %8s %10s %10s %10s %10s %10s\n",
+				"Signal", "Samples", "Rate[Hz]", "Eff.[Hz]", "Gaps", "Longest", "Padded[%]", "Min", "Max");
+	for(std::size_t signal = 0; signal < signals.size(); signal++)
+	{
+		if(signals[signal].is_annotation) continue;
+		auto& result = statistics[signal];
+		close_run(result, minGap);
+
+		const double nominalRate   = signals[signal].nr_of_samples_in_signal / reader.DurationOfDataRecord();
+		const double effectiveRate = duration > 0.0 ? (result.samples - result.paddedSamples) / duration : 0.0;
+		const double padded        = result.samples ? 100.0 * result.paddedSamples / result.samples : 0.0;
+		std::printf("%-16s %12llu %10.2f %8.2f %10llu %10llu %10.2f %10d %10d\n",
+					signals[signal].label.c_str(),
+					static_cast<unsigned long long>(result.samples),
+					nominalRate,
+					effectiveRate,
+					static_cast<unsigned long long>(result.gaps),
+					static_cast<unsigned long long>(result.longestGap),
+					padded,
+					result.samples > result.paddedSamples ? result.minimum : 0,
+					result.samples > result.paddedSamples ? result.maximum : 0);
+	}
+
+	const double dataSize = static_cast<double>(records) * reader.RecordSize();
+	if(duration > 0.0)
+	{
+		std::printf("Stream throughput: %.1f Bytes/s\n", dataSize / duration);
+	}
+	std::printf("Analyzed %.1f MiB in %.3fs (%.1f MiB/s)\n",
+				dataSize / (1024.0 * 1024.0), elapsed.count(), dataSize / (1024.0 * 1024.0) / std::max(elapsed.count(), 1e-9));
+	return reader.Issues().empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,53 @@
+/**
+ * dsp_bench: Measures the decimator of the ADS1299 oversampling (main/dsp/decimator.h) on the build host.
+ *
+ * Usage: dsp_bench [REPETITIONS]
+ *
+ * Prints the time per output sample and channel for the ratios 2 to 64, the best of REPETITIONS runs. The firmware
+ * measures the same on the device with config::ADS1299::BENCHMARK_DECIMATION (in CPU cycles).
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+
+#include "dsp/decimator.h"
+
+namespace
+{
+	// Mirrors config::ADS1299 of the firmware (main/config/devices.h).
+	constexpr size_t TAPS_PER_PHASE = 16;
+	constexpr size_t CHANNELS       = 4;
+
+	int64_t now_ns()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const int repetitions = argc > 1 ? std::max(1, std::atoi(argv[1])) : 5;
+
+	double best[7];
+	std::fill(std::begin(best), std::end(best), std::numeric_limits<double>::max());
+	for(int run = 0; run < repetitions; run++)
+	{
+		size_t index = 0;
+		dsp::benchmark_decimators<TAPS_PER_PHASE, CHANNELS>(now_ns, [&](size_t, double ns)
+		{
+			best[index] = std::min(best[index], ns);
+			index++;
+		});
+	}
+
+	std::printf("%zu taps per phase, %zu channels\n", TAPS_PER_PHASE, CHANNELS);
+	std::printf("%6s %12s %12s\n", "ratio", "MAC/output", "ns/output");
+	for(size_t index = 0, ratio = 2; ratio <= 64; index++, ratio *= 2)
+	{
+		std::printf("%6zu %12zu %12.1f\n", ratio, ratio * TAPS_PER_PHASE, best[index]);
+	}
+	return 0;
+}
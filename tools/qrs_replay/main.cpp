@@ -0,0 +1,354 @@
+/**
+ * qrs_replay: Replays a recorded ECG through the QRS detector of the firmware (main/dsp/qrs_detector.h) on the build
+ * host.
+ *
+ * Usage: qrs_replay [--signal INDEX] [--rate SPS] [--reference BEATS.txt] [--tolerance MS] [--beats] [--repeat N] FILE
+ *        qrs_replay --synthetic NOISE_MV [--rate SPS] [--tolerance MS] [--beats] [--repeat N]
+ *
+ * FILE is a BDF recording of the firmware or a text file with one sample per line (the first column, --rate is
+ * required). --synthetic generates 10 minutes of ECG with NOISE_MV of white noise instead, which is scored against its
+ * own beats. Prints the detected beats with --beats, the heart rate, the time per sample (best of N runs) and, with a
+ * reference, the sensitivity, the positive predictivity and the timing error of the R peaks.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <numbers>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../bdf_inspect/bdf_reader.h"
+#include "dsp/qrs_detector.h"
+
+namespace
+{
+	constexpr double LEARNING_S = 2.0; // The detector learns its levels first. Reference beats within aren't scored.
+
+	struct recording
+	{
+		std::vector<int32_t> samples;
+		double               sampleRate = 0;
+	};
+
+	/**
+	 * \brief Parameters of the synthetic ECG. The published accuracy of the detector was measured with exactly these.
+	 */
+	namespace synthetic
+	{
+		struct wave
+		{
+			double amplitude; // in mV
+			double offset;    // From the R peak, in s
+			double width;     // Standard deviation, in s
+		};
+
+		constexpr wave        BEAT[]          = {{0.15, -0.2, 0.025}, {-0.12, -0.03, 0.01}, {1.0, 0, 0.012}, {-0.25, 0.03, 0.01}, {0.35, 0.25, 0.045}}; // P, Q, R, S, T
+		constexpr double      DURATION_S      = 600;
+		constexpr double      FIRST_BEAT_S    = 1;
+		constexpr double      MIN_BPM         = 50;
+		constexpr double      MAX_BPM         = 150;
+		constexpr double      BPM_STEP        = 3;    // Standard deviation of the heart rate change per beat
+		constexpr double      PREMATURE       = 0.03; // Share of premature (ectopic) beats
+		constexpr double      PREMATURE_RR    = 0.7;  // Their RR interval relative to the current one
+		constexpr double      WANDER_MV       = 0.5;  // Baseline wander
+		constexpr double      WANDER_HZ       = 0.3;
+		constexpr double      MAINS_MV        = 0.1;
+		constexpr double      MAINS_HZ        = 50;
+		constexpr double      EMG_MV          = 0.15; // rms of the EMG bursts
+		constexpr double      EMG_PERIOD_S    = 20;   // One burst of EMG_LENGTH_S at the start of every period
+		constexpr double      EMG_LENGTH_S    = 1;
+		constexpr double      COUNTS_PER_MV   = 1'865.0 * 6; // ADS1299 at a gain of 6
+		constexpr uint32_t    SEED            = 1;
+	}
+
+	/**
+	 * \brief Sum of Gaussian waves per beat, with a random walk of the heart rate, premature beats, baseline wander,
+	 * mains, white noise of 'noise' mV rms and EMG bursts. Writes the R peak times to 'beats'.
+	 */
+	void synthesize(double noise, double sampleRate, recording& result, std::vector<double>& beats)
+	{
+		using namespace synthetic;
+		std::mt19937                           random(SEED);
+		std::normal_distribution<double>       gaussian(0, 1);
+		std::uniform_real_distribution<double> uniform(0, 1);
+
+		double bpm = (MIN_BPM + MAX_BPM) / 2;
+		for(double time = FIRST_BEAT_S; time < DURATION_S - 1;)
+		{
+			beats.push_back(time);
+			bpm = std::clamp(bpm + gaussian(random) * BPM_STEP, MIN_BPM, MAX_BPM);
+			double interval = 60 / bpm;
+			if(uniform(random) < PREMATURE) interval *= PREMATURE_RR;
+			time += interval;
+		}
+
+		const auto samples = static_cast<std::size_t>(DURATION_S * sampleRate);
+		result.sampleRate = sampleRate;
+		result.samples.resize(samples);
+		std::size_t first = 0; // Beats more than 1 s ago don't contribute anymore.
+		for(std::size_t sample = 0; sample < samples; sample++)
+		{
+			const double time  = sample / sampleRate;
+			double       value = 0;
+			while(first < beats.size() && beats[first] < time - 1) first++;
+			for(std::size_t beat = first; beat < beats.size() && beats[beat] < time + 1; beat++)
+			{
+				for(wave const& component : BEAT)
+				{
+					const double distance = time - beats[beat] - component.offset;
+					value += component.amplitude * std::exp(-distance * distance / (2 * component.width * component.width));
+				}
+			}
+			value += WANDER_MV * std::sin(2 * std::numbers::pi * WANDER_HZ * time) + MAINS_MV * std::sin(2 * std::numbers::pi * MAINS_HZ * time) + noise * gaussian(random);
+			if(std::fmod(time, EMG_PERIOD_S) < EMG_LENGTH_S) value += EMG_MV * gaussian(random);
+			result.samples[sample] = static_cast<int32_t>(value * COUNTS_PER_MV);
+		}
+		std::printf("Synthetic ECG: %zu beats, %zu samples at %g SPS, %g mV rms noise\n", beats.size(), samples, sampleRate, noise);
+	}
+
+	struct detected_beat
+	{
+		double time;     // R peak, in s
+		double interval; // Since the previous beat, in s. 0 for the first one.
+	};
+
+	bool read_bdf(const char* path, std::size_t signal, recording& result)
+	{
+		file::BDFReader reader;
+		if(!reader.Open(path)) return false;
+
+		auto const& signals = reader.Signals();
+		if(signal >= signals.size() || signals[signal].is_annotation)
+		{
+			std::fprintf(stderr, "%s has no signal %zu.\n", path, signal);
+			return false;
+		}
+		result.sampleRate = signals[signal].nr_of_samples_in_signal / reader.DurationOfDataRecord();
+		for(std::size_t record = 0; record < reader.Records(); record++)
+		{
+			const auto samples = reader.Samples(reader.Record(record), signal);
+			for(std::size_t offset = 0; offset < samples.size(); offset += file::BDFReader::SAMPLE_SIZE)
+			{
+				result.samples.push_back(file::BDFReader::Sample(samples.data() + offset));
+			}
+		}
+		std::printf("%s: Signal '%s', %zu samples at %g SPS\n", path, signals[signal].label.c_str(), result.samples.size(), result.sampleRate);
+		return true;
+	}
+
+	/**
+	 * \brief Reads the first number of every line. Lines without one (e.g. headers) are skipped.
+	 */
+	std::vector<double> read_column(const char* path)
+	{
+		std::vector<double> values;
+		FILE* stream = std::fopen(path, "r");
+		if(!stream) return values;
+
+		char line[256];
+		while(std::fgets(line, sizeof(line), stream))
+		{
+			char*        end   = nullptr;
+			const double value = std::strtod(line, &end);
+			if(end != line) values.push_back(value);
+		}
+		std::fclose(stream);
+		return values;
+	}
+
+	/**
+	 * \brief Feeds the whole recording. Padding of the firmware (zeros) is concealed, as the heart rate monitor does.
+	 */
+	std::vector<detected_beat> replay(recording const& input, dsp::QRSDetector& detector)
+	{
+		std::vector<detected_beat> beats;
+		detector.Reset();
+		for(int32_t sample : input.samples)
+		{
+			dsp::QRSDetector::beat beat{};
+			if(sample == util::PADDING_BYTE ? detector.Conceal(beat) : detector.Process(sample, beat))
+			{
+				beats.push_back(detected_beat{.time = beat.sample / input.sampleRate, .interval = beat.interval / input.sampleRate});
+			}
+		}
+		return beats;
+	}
+
+	/**
+	 * \brief Matches the beats in time order. A detection within 'tolerance' of a reference beat is a true positive.
+	 */
+	void score(std::vector<detected_beat> const& beats, std::vector<double> const& reference, double tolerance)
+	{
+		std::size_t truePositives = 0, falseNegatives = 0, falsePositives = 0;
+		double      errorSum = 0, errorSquares = 0;
+		std::vector<double> errors; // Absolute
+		std::size_t detection = 0;
+		for(double beat : reference)
+		{
+			while(detection < beats.size() && beats[detection].time < beat - tolerance)
+			{
+				if(beats[detection].time >= LEARNING_S) falsePositives++;
+				detection++;
+			}
+			if(detection < beats.size() && beats[detection].time <= beat + tolerance)
+			{
+				const double error = beats[detection].time - beat;
+				if(beat >= LEARNING_S)
+				{
+					truePositives++;
+					errorSum     += error;
+					errorSquares += error * error;
+					errors.push_back(std::fabs(error));
+				}
+				detection++;
+			}
+			else if(beat >= LEARNING_S)
+			{
+				falseNegatives++;
+			}
+		}
+		for(; detection < beats.size(); detection++)
+		{
+			if(beats[detection].time >= LEARNING_S) falsePositives++;
+		}
+
+		const double sensitivity  = truePositives + falseNegatives ? 100.0 * truePositives / (truePositives + falseNegatives) : 0.0;
+		const double predictivity = truePositives + falsePositives ? 100.0 * truePositives / (truePositives + falsePositives) : 0.0;
+		const double mean         = truePositives ? errorSum / truePositives : 0.0;
+		const double deviation    = truePositives ? std::sqrt(std::max(0.0, errorSquares / truePositives - mean * mean)) : 0.0;
+		std::printf("Reference: TP %zu, FN %zu, FP %zu, Se %.2f%%, +P %.2f%% (after the first %gs, tolerance %gms)\n",
+					truePositives, falseNegatives, falsePositives, sensitivity, predictivity, LEARNING_S, tolerance * 1'000);
+		std::sort(errors.begin(), errors.end());
+		auto percentile = [&](std::size_t percent) { return errors.empty() ? 0.0 : errors[(errors.size() - 1) * percent / 100]; };
+		std::printf("R peak error: mean %+.1fms, deviation %.1fms, p95 %.1fms, p99 %.1fms, max %.1fms\n", mean * 1'000, deviation * 1'000,
+					percentile(95) * 1'000, percentile(99) * 1'000, errors.empty() ? 0.0 : errors.back() * 1'000);
+	}
+
+	int usage(const char* program)
+	{
+		std::fprintf(stderr, "Usage: %s [--signal INDEX] [--rate SPS] [--reference BEATS.txt] [--tolerance MS] [--beats] [--repeat N] FILE\n"
+							 "       %s --synthetic NOISE_MV [--rate SPS] [--tolerance MS] [--beats] [--repeat N]\n", program, program);
+		return EXIT_FAILURE;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const char* path        = nullptr;
+	const char* reference   = nullptr;
+	std::size_t signal      = 0;
+	double      sampleRate  = 0;
+	double      toleranceMs = 150;
+	bool        isListing   = false;
+	int         repetitions = 1;
+	double      noise       = -1; // in mV rms, for --synthetic
+	for(int arg = 1; arg < argc; arg++)
+	{
+		if(!std::strcmp(argv[arg], "--signal") && arg + 1 < argc)
+		{
+			signal = std::strtoul(argv[++arg], nullptr, 10);
+		}
+		else if(!std::strcmp(argv[arg], "--rate") && arg + 1 < argc)
+		{
+			sampleRate = std::strtod(argv[++arg], nullptr);
+		}
+		else if(!std::strcmp(argv[arg], "--synthetic") && arg + 1 < argc)
+		{
+			noise = std::max(0.0, std::strtod(argv[++arg], nullptr));
+		}
+		else if(!std::strcmp(argv[arg], "--reference") && arg + 1 < argc)
+		{
+			reference = argv[++arg];
+		}
+		else if(!std::strcmp(argv[arg], "--tolerance") && arg + 1 < argc)
+		{
+			toleranceMs = std::strtod(argv[++arg], nullptr);
+		}
+		else if(!std::strcmp(argv[arg], "--repeat") && arg + 1 < argc)
+		{
+			repetitions = std::max(1, std::atoi(argv[++arg]));
+		}
+		else if(!std::strcmp(argv[arg], "--beats"))
+		{
+			isListing = true;
+		}
+		else if(!path && argv[arg][0] != '-')
+		{
+			path = argv[arg];
+		}
+		else
+		{
+			return usage(argv[0]);
+		}
+	}
+	const bool isSynthetic = noise >= 0;
+	if(isSynthetic == (path != nullptr) || (isSynthetic && reference)) return usage(argv[0]);
+
+	recording           input;
+	std::vector<double> references;
+	if(isSynthetic)
+	{
+		synthesize(noise, sampleRate > 0 ? sampleRate : dsp::QRSDetector::DETECTION_RATE, input, references);
+	}
+	else if(const std::size_t length = std::strlen(path); length > 4 && !std::strcmp(path + length - 4, ".bdf"))
+	{
+		if(!read_bdf(path, signal, input)) return EXIT_FAILURE;
+	}
+	else
+	{
+		if(sampleRate <= 0) return usage(argv[0]);
+		for(double value : read_column(path)) input.samples.push_back(static_cast<int32_t>(std::lround(value)));
+		input.sampleRate = sampleRate;
+		std::printf("%s: %zu samples at %g SPS\n", path, input.samples.size(), input.sampleRate);
+	}
+
+	dsp::QRSDetector detector;
+	if(input.sampleRate != std::floor(input.sampleRate) || !detector.SetSampleRate(static_cast<std::size_t>(input.sampleRate)))
+	{
+		std::fprintf(stderr, "The sample rate has to be a multiple of %zu SPS.\n", dsp::QRSDetector::DETECTION_RATE);
+		return EXIT_FAILURE;
+	}
+
+	std::vector<detected_beat> beats;
+	double                     best = std::numeric_limits<double>::max();
+	for(int run = 0; run < repetitions; run++)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		beats = replay(input, detector);
+		const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::min(best, elapsed.count());
+	}
+
+	if(isListing)
+	{
+		for(auto const& beat : beats)
+		{
+			std::printf("  %10.3fs", beat.time);
+			if(beat.interval > 0) std::printf(" %7.2f bpm", 60.0 / beat.interval);
+			std::printf("\n");
+		}
+	}
+	const double duration = input.samples.size() / input.sampleRate;
+	std::printf("%zu beats in %.1fs (%.1f bpm)\n", beats.size(), duration, duration > 0 ? 60.0 * beats.size() / duration : 0.0);
+	std::printf("Cost: %.1f ns per sample\n", input.samples.empty() ? 0.0 : best / input.samples.size());
+
+	if(reference)
+	{
+		references = read_column(reference);
+		if(references.empty())
+		{
+			std::fprintf(stderr, "No beat times in %s.\n", reference);
+			return EXIT_FAILURE;
+		}
+	}
+	if(!references.empty())
+	{
+		score(beats, references, toleranceMs / 1'000);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,301 @@
+/**
+ * recorder_bench: Tests and benchmarks the SD card recorder of the firmware (main/storage/bdf_recorder.h) against a
+ * regular file on the build host.
+ *
+ * Usage: recorder_bench [--records N] [--channels C] [--samples S] [--block BYTES] [--step BYTES] [--keep] [FILE]
+ *
+ * Streams a BDF file through storage::BDFRecorder and storage::PosixFile, the backend of the SD card, the same way the
+ * transmitter does: The headers, then one data record after the other. A checking backend between them verifies
+ * that every write starts at a block boundary and is a whole block, except the last one, and that the file is
+ * truncated to the streamed size. The file is read back with the reader of bdf_inspect, which checks the patched
+ * number_of_data_records and the samples. Prints the throughput and how much faster than real time it is.
+ */
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "storage/bdf_recorder.h"
+#include "storage/posix_file.h"
+#include "../bdf_inspect/bdf_reader.h"
+
+namespace
+{
+	// As config::Recorder and config::RECORD_DURATION_MS of the firmware
+	constexpr std::size_t BLOCK_SIZE         = 16 * 1024;
+	constexpr std::size_t PREALLOCATION_STEP = 4 * 1024 * 1024;
+	constexpr float       RECORD_DURATION_S  = 0.2f;
+	constexpr std::size_t SAMPLE_SIZE        = 3;
+
+	struct options
+	{
+		std::size_t records     = 20'000;
+		std::size_t channels    = 8;
+		std::size_t samples     = 50; // Per channel and record: 250 SPS
+		std::size_t blockSize   = BLOCK_SIZE;
+		std::size_t step        = PREALLOCATION_STEP;
+		bool        isKept      = false;
+		const char* path        = "recorder_bench.bdf";
+	};
+
+	/**
+	 * \brief Forwards to the POSIX backend and checks how the recorder uses it.
+	 */
+	class CheckingBackend final : public storage::Backend
+	{
+	public:
+		explicit CheckingBackend(std::size_t blockSize)
+			: _blockSize(blockSize)
+		{
+		}
+
+		bool Open(const char* path) override
+		{
+			_position = 0;
+			return _file.Open(path);
+		}
+
+		void Close() override
+		{
+			_file.Close();
+		}
+
+		bool Preallocate(size_type size) override
+		{
+			_preallocations++;
+			return _file.Preallocate(size);
+		}
+
+		bool Write(void const* data, size_type size) override
+		{
+			if(_position % _blockSize) Issue("Write at " + std::to_string(_position) + " isn't block-aligned.");
+			if(size != _blockSize)
+			{
+				if(_partialWrites++) Issue("More than the last write is shorter than a block.");
+			}
+			_writes++;
+			_position += size;
+			return _file.Write(data, size);
+		}
+
+		bool WriteAt(size_type offset, void const* data, size_type size) override
+		{
+			if(offset + size > sizeof(file::bdf_header_t)) Issue("WriteAt outside of the general header.");
+			return _file.WriteAt(offset, data, size);
+		}
+
+		bool Truncate(size_type size) override
+		{
+			if(size != _position) Issue("Truncated to " + std::to_string(size) + " instead of " + std::to_string(_position) + " Bytes.");
+			_truncatedSize = size;
+			return _file.Truncate(size);
+		}
+
+		bool Flush() override
+		{
+			return _file.Flush();
+		}
+
+		std::vector<std::string> const& Issues() const { return _issues; }
+		std::size_t Writes() const { return _writes; }
+		std::size_t Preallocations() const { return _preallocations; }
+		size_type   TruncatedSize() const { return _truncatedSize; }
+
+	private:
+		void Issue(std::string issue)
+		{
+			_issues.push_back(std::move(issue));
+		}
+
+		storage::PosixFile       _file;
+		std::size_t              _blockSize;
+		size_type                _position      = 0;
+		size_type                _truncatedSize = 0;
+		std::size_t              _writes        = 0;
+		std::size_t              _partialWrites = 0;
+		std::size_t              _preallocations = 0;
+		std::vector<std::string> _issues;
+	};
+
+	int32_t sample_value(std::size_t record, std::size_t channel, std::size_t sample, std::size_t samples)
+	{
+		// Sawtooth per channel, which covers the sign bit of the 24-Bit samples.
+		const int64_t index = static_cast<int64_t>(record * samples + sample);
+		return static_cast<int32_t>((index * 997 + static_cast<int64_t>(channel) * 65'537) % 16'777'216) - 8'388'608;
+	}
+
+	/**
+	 * \brief General header and the signal headers, attribute by attribute, as the transmitter sends them.
+	 */
+	std::vector<util::byte> headers(options const& option)
+	{
+		file::bdf_header_t general{};
+		file::create_general_header(&general, RECORD_DURATION_S, -1, static_cast<uint32_t>(option.channels));
+		std::vector<file::bdf_signal_header_t> signals(option.channels);
+		for(std::size_t channel = 0; channel < option.channels; channel++)
+		{
+			const std::string label = "Ch " + std::to_string(channel + 1);
+			file::create_signal_header(&signals[channel], label.c_str(), "Synthetic", "uV", -8'388'608, 8'388'607,
+									   -8'388'608, 8'388'607, "None", static_cast<uint32_t>(option.samples));
+		}
+
+		struct attribute
+		{
+			std::size_t offset;
+			std::size_t size;
+		};
+		constexpr attribute ATTRIBUTES[] =
+		{
+			{offsetof(file::bdf_signal_header_t, label),                   sizeof file::bdf_signal_header_t::label},
+			{offsetof(file::bdf_signal_header_t, transducer_type),         sizeof file::bdf_signal_header_t::transducer_type},
+			{offsetof(file::bdf_signal_header_t, physical_dimension),      sizeof file::bdf_signal_header_t::physical_dimension},
+			{offsetof(file::bdf_signal_header_t, physical_minimum),        sizeof file::bdf_signal_header_t::physical_minimum},
+			{offsetof(file::bdf_signal_header_t, physical_maximum),        sizeof file::bdf_signal_header_t::physical_maximum},
+			{offsetof(file::bdf_signal_header_t, digital_minimum),         sizeof file::bdf_signal_header_t::digital_minimum},
+			{offsetof(file::bdf_signal_header_t, digital_maximum),         sizeof file::bdf_signal_header_t::digital_maximum},
+			{offsetof(file::bdf_signal_header_t, pre_filtering),           sizeof file::bdf_signal_header_t::pre_filtering},
+			{offsetof(file::bdf_signal_header_t, nr_of_samples_in_signal), sizeof file::bdf_signal_header_t::nr_of_samples_in_signal},
+			{offsetof(file::bdf_signal_header_t, reserved),                sizeof file::bdf_signal_header_t::reserved},
+		};
+
+		std::vector<util::byte> result(general.data, general.data + sizeof general.data);
+		for(attribute const& field : ATTRIBUTES)
+		{
+			for(auto const& signal : signals)
+			{
+				auto const* bytes = reinterpret_cast<util::byte const*>(signal.data) + field.offset;
+				result.insert(result.end(), bytes, bytes + field.size);
+			}
+		}
+		return result;
+	}
+
+	void fill_record(std::vector<util::byte>& record, options const& option, std::size_t index)
+	{
+		util::byte* out = record.data();
+		for(std::size_t channel = 0; channel < option.channels; channel++)
+		{
+			for(std::size_t sample = 0; sample < option.samples; sample++)
+			{
+				const auto value = static_cast<uint32_t>(sample_value(index, channel, sample, option.samples));
+				*out++ = static_cast<util::byte>(value);
+				*out++ = static_cast<util::byte>(value >> 8);
+				*out++ = static_cast<util::byte>(value >> 16);
+			}
+		}
+	}
+
+	/**
+	 * \brief Compares every sample of the file with the streamed pattern. Returns the number of mismatches.
+	 */
+	std::size_t verify_samples(file::BDFReader const& reader, options const& option)
+	{
+		std::size_t mismatches = 0;
+		for(std::size_t record = 0; record < reader.Records(); record++)
+		{
+			const auto bytes = reader.Record(record);
+			for(std::size_t channel = 0; channel < option.channels; channel++)
+			{
+				const auto samples = reader.Samples(bytes, channel);
+				for(std::size_t sample = 0; sample < option.samples; sample++)
+				{
+					mismatches += file::BDFReader::Sample(samples.data() + sample * SAMPLE_SIZE) != sample_value(record, channel, sample, option.samples);
+				}
+			}
+		}
+		return mismatches;
+	}
+
+	int usage(const char* program)
+	{
+		std::fprintf(stderr, "Usage: %s [--records N] [--channels C] [--samples S] [--block BYTES] [--step BYTES] [--keep] [FILE]\n", program);
+		return EXIT_FAILURE;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	options option;
+	for(int arg = 1; arg < argc; arg++)
+	{
+		auto size = [&] { return static_cast<std::size_t>(std::strtoull(argv[++arg], nullptr, 10)); };
+		if(!std::strcmp(argv[arg], "--records") && arg + 1 < argc)       option.records   = size();
+		else if(!std::strcmp(argv[arg], "--channels") && arg + 1 < argc) option.channels  = size();
+		else if(!std::strcmp(argv[arg], "--samples") && arg + 1 < argc)  option.samples   = size();
+		else if(!std::strcmp(argv[arg], "--block") && arg + 1 < argc)    option.blockSize = size();
+		else if(!std::strcmp(argv[arg], "--step") && arg + 1 < argc)     option.step      = size();
+		else if(!std::strcmp(argv[arg], "--keep"))                       option.isKept    = true;
+		else if(argv[arg][0] != '-')                                     option.path      = argv[arg];
+		else return usage(argv[0]);
+	}
+	if(!option.channels || option.channels > 9'999 || !option.samples || !option.blockSize || !option.step) return usage(argv[0]);
+
+	const std::vector<util::byte> header = headers(option);
+	std::vector<util::byte>       record(option.channels * option.samples * SAMPLE_SIZE);
+	std::vector<util::byte>       block(option.blockSize);
+	CheckingBackend               backend(option.blockSize);
+	storage::BDFRecorder          recorder(backend, block, option.step);
+
+	const auto start = std::chrono::steady_clock::now();
+	bool isWritten   = recorder.Begin(option.path) && recorder.Append(header.data(), header.size());
+	for(std::size_t index = 0; isWritten && index < option.records; index++)
+	{
+		fill_record(record, option, index);
+		isWritten = recorder.AppendRecord(record.data(), record.size());
+	}
+	isWritten = isWritten && recorder.Close();
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	if(!isWritten)
+	{
+		std::fprintf(stderr, "Recording '%s' failed.\n", option.path);
+		return EXIT_FAILURE;
+	}
+
+	std::vector<std::string> issues = backend.Issues();
+	const std::size_t expectedSize = header.size() + option.records * record.size();
+	if(backend.TruncatedSize() != expectedSize)
+	{
+		issues.push_back("The file has " + std::to_string(backend.TruncatedSize()) + " instead of " + std::to_string(expectedSize) + " Bytes.");
+	}
+	file::BDFReader reader;
+	if(!reader.Open(option.path))
+	{
+		issues.push_back("The reader can't open the file.");
+	}
+	else
+	{
+		issues.insert(issues.end(), reader.Issues().begin(), reader.Issues().end());
+		if(reader.FileSize() != expectedSize) issues.push_back("The mapped file has " + std::to_string(reader.FileSize()) + " Bytes.");
+		if(reader.Records() != option.records) issues.push_back("The reader finds " + std::to_string(reader.Records()) + " records.");
+		const std::string declared(reader.Header().number_of_data_records, sizeof reader.Header().number_of_data_records);
+		if(std::strtoll(declared.c_str(), nullptr, 10) != static_cast<long long>(option.records))
+		{
+			issues.push_back("number_of_data_records is '" + declared + "' instead of " + std::to_string(option.records) + ".");
+		}
+		if(const std::size_t mismatches = verify_samples(reader, option))
+		{
+			issues.push_back(std::to_string(mismatches) + " samples differ from the streamed ones.");
+		}
+	}
+
+	const double megabytes = expectedSize / 1e6;
+	std::printf("%zu records of %zu channels x %zu samples (%zu Bytes each), %zu Byte blocks, %zu Byte preallocation steps\n",
+				option.records, option.channels, option.samples, record.size(), option.blockSize, option.step);
+	std::printf("Wrote %.1f MB in %zu writes and %zu preallocations: %.3f s incl. fsync, %.1f MB/s, %.0fx real time\n",
+				megabytes, backend.Writes(), backend.Preallocations(), elapsed.count(), megabytes / elapsed.count(),
+				option.records * RECORD_DURATION_S / elapsed.count());
+	for(std::string const& issue : issues)
+	{
+		std::printf("Issue: %s\n", issue.c_str());
+	}
+	std::printf(issues.empty() ? "OK: Block-aligned writes, truncated size, number_of_data_records and samples match.\n" : "FAILED\n");
+
+	if(!option.isKept)
+	{
+		DISCARD std::remove(option.path);
+	}
+	return issues.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
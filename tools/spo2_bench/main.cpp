@@ -0,0 +1,253 @@
+/**
+ * spo2_bench: Accuracy and cost of the SpO2 estimator of the firmware (main/dsp/spo2_estimator.h) on synthetic PPG on
+ * the build host.
+ *
+ * Usage: spo2_bench [--rate SPS] [--noise PERCENT] [--perfusion PERCENT] [--wander PERCENT] [--motion]
+ *                   [--seconds S] [--repeat N]
+ *
+ * Generates the red and infrared counts of a MAX30102 for a grid of known saturations and heart rates. The ratio R of
+ * every saturation comes from the inverse of the calibration curve of the firmware, so the errors are the ones of the
+ * estimation alone, not of the curve. Prints the error of SpO2 and of the pulse rate per case and the time per sample
+ * (best of N runs).
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "dsp/spo2_estimator.h"
+
+namespace
+{
+	// Curve of config::Oximetry (the Maxim reference design). The estimator only needs it as its calibration.
+	constexpr dsp::SpO2Estimator::calibration CURVE = {.a = -45.060, .b = 30.354, .c = 94.845};
+
+	constexpr double LEARNING_S   = 10.0; // The DC and the amplitude settle first. Estimates within aren't scored.
+	constexpr double RED_DC       = 120'000; // Counts
+	constexpr double INFRARED_DC  = 150'000;
+	constexpr double HRV          = 0.05;    // Beat to beat variation of the period
+	constexpr double MOTION_EVERY = 20;      // s between motion artifacts of 2 s
+	constexpr double PI           = 3.14159265358979323846;
+
+	constexpr double SATURATIONS[] = {70, 80, 90, 95, 99}; // in %. The curve peaks at 99.96 %.
+	constexpr double HEART_RATES[] = {40, 72, 120, 180};    // in bpm
+
+	struct options
+	{
+		double sampleRate = 100;
+		double noise      = 2;   // White noise in % of the AC
+		double perfusion  = 2;   // Infrared AC / DC in %
+		double wander     = 1;   // Baseline wander at 0.25 Hz (respiration) in % of the DC
+		bool   isMotion   = false;
+		double seconds    = 120;
+		int    repetitions = 1;
+	};
+
+	struct ppg
+	{
+		std::vector<int32_t> red;
+		std::vector<int32_t> infrared;
+	};
+
+	struct errors
+	{
+		std::size_t estimates      = 0; // Scored
+		double      saturationSum  = 0;
+		double      saturationMax  = 0;
+		double      pulseRateSum   = 0;
+		double      pulseRateMax   = 0;
+		double      absoluteSquare = 0; // Of SpO2, for the RMS
+	};
+
+	/**
+	 * \brief Solves a R^2 + b R + c = saturation for the R of the falling branch of the curve within (0, 3].
+	 */
+	double ratio_of(double saturation)
+	{
+		const double discriminant = CURVE.b * CURVE.b - 4 * CURVE.a * (CURVE.c - saturation);
+		const double root         = std::sqrt(std::max(0.0, discriminant));
+		const double first        = (-CURVE.b + root) / (2 * CURVE.a);
+		const double second       = (-CURVE.b - root) / (2 * CURVE.a);
+		return first > 0 && first <= 3 && (first > second || second > 3) ? first : second;
+	}
+
+	double pulse_shape(double phase)
+	{
+		auto gauss = [phase](double center, double width)
+		{
+			const double distance = (phase - center) / width;
+			return std::exp(-.5 * distance * distance);
+		};
+		return gauss(.25, .08) + .35 * gauss(.55, .07); // Systolic peak and dicrotic wave, as config::Synthetic
+	}
+
+	ppg generate(options const& option, double saturation, double heartRate)
+	{
+		std::mt19937                           random(0x2545F491);
+		std::normal_distribution<double>       gauss(0, 1);
+		std::uniform_real_distribution<double> uniform(-1, 1);
+
+		const double ratio       = ratio_of(saturation);
+		const double infraredAC  = option.perfusion / 100 * INFRARED_DC;
+		const double redAC       = ratio * option.perfusion / 100 * RED_DC;
+		const double meanPeriod  = 60 / heartRate;
+		const auto   samples     = static_cast<std::size_t>(option.sampleRate * option.seconds);
+		double       beatStart   = 0;
+		double       period      = meanPeriod;
+
+		ppg result;
+		result.red.reserve(samples);
+		result.infrared.reserve(samples);
+		for(std::size_t sample = 0; sample < samples; sample++)
+		{
+			const double time = sample / option.sampleRate;
+			if(time >= beatStart + period)
+			{
+				beatStart += period;
+				period     = meanPeriod * (1 + HRV * uniform(random));
+			}
+			const double pulse  = pulse_shape((time - beatStart) / period);
+			double       common = 1 + option.wander / 100 * std::sin(2 * PI * .25 * time);
+			if(option.isMotion && std::fmod(time, MOTION_EVERY) < 2)
+			{
+				common += 3 * option.perfusion / 100 * std::sin(2 * PI * 1.3 * time);
+			}
+			// The blood of the pulse absorbs light: The counts fall.
+			result.red.push_back(static_cast<int32_t>(std::lround(RED_DC * common - redAC * pulse + option.noise / 100 * redAC * gauss(random))));
+			result.infrared.push_back(static_cast<int32_t>(std::lround(INFRARED_DC * common - infraredAC * pulse + option.noise / 100 * infraredAC * gauss(random))));
+		}
+		return result;
+	}
+
+	std::vector<dsp::SpO2Estimator::estimate> estimate(ppg const& input, dsp::SpO2Estimator& estimator)
+	{
+		std::vector<dsp::SpO2Estimator::estimate> estimates;
+		estimator.Reset();
+		for(std::size_t sample = 0; sample < input.red.size(); sample++)
+		{
+			dsp::SpO2Estimator::estimate result{};
+			if(estimator.Process(input.red[sample], input.infrared[sample], result)) estimates.push_back(result);
+		}
+		return estimates;
+	}
+
+	errors score(std::vector<dsp::SpO2Estimator::estimate> const& estimates, double sampleRate, double saturation, double heartRate)
+	{
+		errors result;
+		for(auto const& estimate : estimates)
+		{
+			if(estimate.sample < LEARNING_S * sampleRate) continue;
+			const double saturationError = estimate.saturation / 100.0 - saturation;
+			const double pulseRateError  = 60 * sampleRate / estimate.period - heartRate;
+			result.estimates++;
+			result.saturationSum  += saturationError;
+			result.saturationMax   = std::max(result.saturationMax, std::fabs(saturationError));
+			result.absoluteSquare += saturationError * saturationError;
+			result.pulseRateSum   += pulseRateError;
+			result.pulseRateMax    = std::max(result.pulseRateMax, std::fabs(pulseRateError));
+		}
+		return result;
+	}
+
+	int usage(const char* program)
+	{
+		std::fprintf(stderr, "Usage: %s [--rate SPS] [--noise PERCENT] [--perfusion PERCENT] [--wander PERCENT] [--motion] [--seconds S] [--repeat N]\n", program);
+		return EXIT_FAILURE;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	options option;
+	for(int arg = 1; arg < argc; arg++)
+	{
+		if(!std::strcmp(argv[arg], "--rate") && arg + 1 < argc)
+		{
+			option.sampleRate = std::strtod(argv[++arg], nullptr);
+		}
+		else if(!std::strcmp(argv[arg], "--noise") && arg + 1 < argc)
+		{
+			option.noise = std::strtod(argv[++arg], nullptr);
+		}
+		else if(!std::strcmp(argv[arg], "--perfusion") && arg + 1 < argc)
+		{
+			option.perfusion = std::strtod(argv[++arg], nullptr);
+		}
+		else if(!std::strcmp(argv[arg], "--wander") && arg + 1 < argc)
+		{
+			option.wander = std::strtod(argv[++arg], nullptr);
+		}
+		else if(!std::strcmp(argv[arg], "--seconds") && arg + 1 < argc)
+		{
+			option.seconds = std::strtod(argv[++arg], nullptr);
+		}
+		else if(!std::strcmp(argv[arg], "--repeat") && arg + 1 < argc)
+		{
+			option.repetitions = std::max(1, std::atoi(argv[++arg]));
+		}
+		else if(!std::strcmp(argv[arg], "--motion"))
+		{
+			option.isMotion = true;
+		}
+		else
+		{
+			return usage(argv[0]);
+		}
+	}
+	if(option.seconds <= LEARNING_S || option.perfusion <= 0) return usage(argv[0]);
+
+	dsp::SpO2Estimator estimator(CURVE);
+	if(option.sampleRate != std::floor(option.sampleRate) || !estimator.SetSampleRate(static_cast<std::size_t>(option.sampleRate)))
+	{
+		std::fprintf(stderr, "The sample rate has to be a multiple of %zu SPS.\n", dsp::SpO2Estimator::ESTIMATION_RATE);
+		return EXIT_FAILURE;
+	}
+	std::printf("%g SPS, %gs per case, perfusion %g%%, noise %g%% of the AC, wander %g%% of the DC%s\n", option.sampleRate,
+				option.seconds, option.perfusion, option.noise, option.wander, option.isMotion ? ", motion" : "");
+	std::printf("SpO2 %%  HR bpm | Estimates | SpO2 error: mean    max | HR error: mean    max\n");
+
+	errors      overall;
+	double      best    = std::numeric_limits<double>::max();
+	std::size_t samples = 0;
+	for(double saturation : SATURATIONS)
+	{
+		for(double heartRate : HEART_RATES)
+		{
+			const ppg input = generate(option, saturation, heartRate);
+			std::vector<dsp::SpO2Estimator::estimate> estimates;
+			double caseBest = std::numeric_limits<double>::max();
+			for(int run = 0; run < option.repetitions; run++)
+			{
+				const auto start = std::chrono::steady_clock::now();
+				estimates = estimate(input, estimator);
+				const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+				caseBest = std::min(caseBest, elapsed.count() / input.red.size());
+			}
+			best     = std::min(best, caseBest);
+			samples += input.red.size();
+
+			const errors result = score(estimates, option.sampleRate, saturation, heartRate);
+			const double count  = std::max<std::size_t>(result.estimates, 1);
+			std::printf("%6g  %6g | %9zu | %+15.2f %6.2f | %+13.2f %6.2f\n", saturation, heartRate, result.estimates,
+						result.saturationSum / count, result.saturationMax, result.pulseRateSum / count, result.pulseRateMax);
+			overall.estimates      += result.estimates;
+			overall.saturationSum  += result.saturationSum;
+			overall.saturationMax   = std::max(overall.saturationMax, result.saturationMax);
+			overall.absoluteSquare += result.absoluteSquare;
+			overall.pulseRateSum   += result.pulseRateSum;
+			overall.pulseRateMax    = std::max(overall.pulseRateMax, result.pulseRateMax);
+		}
+	}
+
+	const double count = std::max<std::size_t>(overall.estimates, 1);
+	std::printf("Overall: %zu estimates after the first %gs, SpO2 bias %+.2f%%, RMS %.2f%%, max %.2f%%, HR bias %+.2f bpm, max %.2f bpm\n",
+				overall.estimates, LEARNING_S, overall.saturationSum / count, std::sqrt(overall.absoluteSquare / count),
+				overall.saturationMax, overall.pulseRateSum / count, overall.pulseRateMax);
+	std::printf("Cost: %.1f ns per sample (best case of %zu samples)\n", best, samples);
+	return EXIT_SUCCESS;
+}
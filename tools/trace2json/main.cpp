@@ -0,0 +1,219 @@
+/**
+ * trace2json: Converts a trace dump of the firmware (answer to BDF_TRACE) into the Chrome trace event format.
+ *
+ * Usage: trace2json DUMP [OUT.json]
+ *
+ * The output can be opened with chrome://tracing or https://ui.perfetto.dev. Every core is shown as one thread.
+ * Reads and sends are slices, all other events are instants.
+ */
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+	// Mirrors util::Trace of the firmware (main/util/trace.h).
+	enum class TraceEvent : uint8_t
+	{
+		IsrEntry,
+		ReadBegin,
+		ReadEnd,
+		RingWrite,
+		RecordReady,
+		SendBegin,
+		SendEnd,
+		TaskWake,
+	};
+
+	constexpr const char* SOURCE_NAMES[] =
+	{
+		"MAX30102",
+		"ADS1299",
+		"BHI160",
+		"MCP3561",
+		"SPIAcquisition",
+		"I2CAcquisition",
+		"SensorControl",
+		"Transmitter",
+	};
+
+	struct event
+	{
+		uint32_t time;
+		uint8_t  type;
+		uint8_t  source;
+		uint16_t value;
+	};
+	static_assert(sizeof(event) == 8);
+
+	constexpr char     DUMP_MAGIC[8] = {'E', 'D', 'U', 'T', 'R', 'A', 'C', 'E'};
+	constexpr uint32_t DUMP_VERSION  = 1;
+
+	struct dump
+	{
+		std::vector<std::vector<event>> cores;
+		std::vector<uint32_t>           overwritten;
+	};
+
+	bool read_u32(std::FILE* file, uint32_t& value)
+	{
+		return std::fread(&value, sizeof(value), 1, file) == 1;
+	}
+
+	/**
+	 * \brief Reads the dump header (magic, version, cores, events[cores], overwritten[cores]) and the events.
+	 */
+	bool read_dump(const char* path, dump& result)
+	{
+		std::FILE* file = std::fopen(path, "rb");
+		if(!file)
+		{
+			std::fprintf(stderr, "Unable to open '%s'.\n", path);
+			return false;
+		}
+
+		char     magic[sizeof(DUMP_MAGIC)];
+		uint32_t version = 0;
+		uint32_t cores   = 0;
+		bool     isValid = std::fread(magic, sizeof(magic), 1, file) == 1 && !std::memcmp(magic, DUMP_MAGIC, sizeof(magic))
+		                   && read_u32(file, version) && version == DUMP_VERSION
+		                   && read_u32(file, cores) && cores > 0 && cores <= 8;
+		std::vector<uint32_t> counts(cores);
+		result.overwritten.resize(cores);
+		for(uint32_t core = 0; isValid && core < cores; core++) isValid = read_u32(file, counts[core]);
+		for(uint32_t core = 0; isValid && core < cores; core++) isValid = read_u32(file, result.overwritten[core]);
+
+		result.cores.resize(cores);
+		for(uint32_t core = 0; isValid && core < cores; core++)
+		{
+			result.cores[core].resize(counts[core]);
+			isValid = std::fread(result.cores[core].data(), sizeof(event), counts[core], file) == counts[core];
+		}
+		std::fclose(file);
+		if(!isValid)
+		{
+			std::fprintf(stderr, "'%s' is no complete trace dump (version %u).\n", path, static_cast<unsigned>(DUMP_VERSION));
+		}
+		return isValid;
+	}
+
+	/**
+	 * \brief Extends the 32 bit timestamps of one core. Events are chronological, so a step back means a wrap.
+	 */
+	std::vector<uint64_t> unwrap(std::vector<event> const& events)
+	{
+		std::vector<uint64_t> times(events.size());
+		uint64_t epoch    = 0;
+		uint32_t previous = events.empty() ? 0 : events.front().time;
+		for(std::size_t index = 0; index < events.size(); index++)
+		{
+			if(events[index].time < previous && previous - events[index].time > UINT32_MAX / 2)
+			{
+				epoch += 1ull << 32;
+			}
+			previous     = events[index].time;
+			times[index] = epoch + events[index].time;
+		}
+		return times;
+	}
+
+	const char* source_name(uint8_t source)
+	{
+		return source < std::size(SOURCE_NAMES) ? SOURCE_NAMES[source] : "Unknown";
+	}
+
+	void write_event(std::FILE* out, bool& isFirst, event const& current, uint64_t time, std::size_t core)
+	{
+		const char* phase = "i";
+		const char* name  = nullptr;
+		switch(static_cast<TraceEvent>(current.type))
+		{
+		case TraceEvent::IsrEntry:    name = "Data ready"; break;
+		case TraceEvent::ReadBegin:   name = "Read";   phase = "B"; break;
+		case TraceEvent::ReadEnd:     name = "Read";   phase = "E"; break;
+		case TraceEvent::RingWrite:   name = "Ring write"; break;
+		case TraceEvent::RecordReady: name = "Record ready"; break;
+		case TraceEvent::SendBegin:   name = "Send";   phase = "B"; break;
+		case TraceEvent::SendEnd:     name = "Send";   phase = "E"; break;
+		case TraceEvent::TaskWake:    name = "Wake"; break;
+		default:                      name = "Unknown"; break;
+		}
+
+		std::fprintf(out, "%s\n{\"name\":\"%s %s\",\"cat\":\"%s\",\"ph\":\"%s\",\"ts\":%llu,\"pid\":0,\"tid\":%zu",
+					 isFirst ? "" : ",", source_name(current.source), name, source_name(current.source), phase,
+					 static_cast<unsigned long long>(time), core);
+		if(*phase == 'i')
+		{
+			std::fprintf(out, ",\"s\":\"t\"");
+		}
+		if(*phase != 'E')
+		{
+			std::fprintf(out, ",\"args\":{\"value\":%u}", static_cast<unsigned>(current.value));
+		}
+		std::fprintf(out, "}");
+		isFirst = false;
+	}
+
+	int usage(const char* program)
+	{
+		std::fprintf(stderr, "Usage: %s DUMP [OUT.json]\n", program);
+		return EXIT_FAILURE;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 2 || argc > 3) return usage(argv[0]);
+
+	dump trace;
+	if(!read_dump(argv[1], trace)) return EXIT_FAILURE;
+
+	std::FILE* out = argc == 3 ? std::fopen(argv[2], "w") : stdout;
+	if(!out)
+	{
+		std::fprintf(stderr, "Unable to create '%s'.\n", argv[2]);
+		return EXIT_FAILURE;
+	}
+
+	// All cores share esp_timer, so one origin keeps them aligned. A core, whose first event is from after a wrap,
+	// is moved into the epoch of the others.
+	std::vector<std::vector<uint64_t>> times;
+	uint64_t latestFirst = 0;
+	for(auto const& events : trace.cores)
+	{
+		times.push_back(unwrap(events));
+		if(!times.back().empty()) latestFirst = std::max(latestFirst, times.back().front());
+	}
+	uint64_t origin = UINT64_MAX;
+	for(auto& coreTimes : times)
+	{
+		if(coreTimes.empty()) continue;
+		if(latestFirst - coreTimes.front() > UINT32_MAX / 2)
+		{
+			for(uint64_t& time : coreTimes) time += 1ull << 32;
+		}
+		origin = std::min(origin, coreTimes.front());
+	}
+
+	bool isFirst = true;
+	std::fprintf(out, "{\"traceEvents\":[");
+	for(std::size_t core = 0; core < trace.cores.size(); core++)
+	{
+		std::fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%zu,\"args\":{\"name\":\"Core %zu\"}}",
+					 isFirst ? "" : ",", core, core);
+		isFirst = false;
+		for(std::size_t index = 0; index < trace.cores[core].size(); index++)
+		{
+			write_event(out, isFirst, trace.cores[core][index], times[core][index] - origin, core);
+		}
+		std::fprintf(stderr, "Core %zu: %zu events, %u overwritten\n", core, trace.cores[core].size(), static_cast<unsigned>(trace.overwritten[core]));
+	}
+	std::fprintf(out, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+	if(out != stdout) std::fclose(out);
+	return EXIT_SUCCESS;
+}